@@ -0,0 +1,143 @@
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "misc/headlessContext.hpp"
+#include "simulation/distributed/worker.hpp"
+
+/*
+    Runs the simulation split into ranksX*ranksY subdomains, each one simulated by its own process
+    Halo strips and migrating agents are exchanged every step through POSIX shared memory
+
+    Usage: GLSLSlimeDistributed <ranksX> <ranksY> <agents> <worldSize> <steps> [name=value ...]
+    where name is one of exportInterval, seed, sensorDistance, sensorAngle, turnSpeed, speed, diffuse, fade
+*/
+
+using namespace simulation::distributed;
+
+static int runRank(int rank, const decomposition& domain, const sharedLayout& layout, const settings& config, sharedMemory& shm){
+    sharedHeader* header = shm.at<sharedHeader>(layout.header());
+    try{
+        glfwInit();
+        auto window = headless::createContext();
+        {
+            worker w(rank, domain, layout, config, shm);
+            w.setup();
+            header->barrier.wait(domain.rankCount()); // Dont start timing until everyone has compiled their shaders
+            auto start = std::chrono::steady_clock::now();
+            int frame = 0;
+            for(int step = 0; step < config.steps; step++){
+                w.step(step);
+                if(config.exportInterval > 0 && step % config.exportInterval == 0){
+                    w.exportFrame(frame++);
+                }
+                if(rank == 0 && step % 100 == 99){
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    std::cout << "Step " << step+1 << "/" << config.steps << " (" << (step+1)/seconds << " steps/s)" << std::endl;
+                }
+            }
+            header->aliveAgents.fetch_add(w.countAliveAgents());
+        }
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }catch(const std::exception& e){
+        std::cout << "Rank " << rank << ": " << e.what() << std::endl;
+        header->barrier.abort();
+        return 1;
+    }
+    return 0;
+}
+
+static bool setOption(settings& config, const char* arg){
+    const char* eq = std::strchr(arg, '=');
+    if(eq == nullptr){
+        return false;
+    }
+    std::string name(arg, eq);
+    float value = std::atof(eq + 1);
+    if(name == "exportInterval"){ config.exportInterval = (int)value; }
+    else if(name == "seed"){ config.seed = (unsigned int)std::strtoul(eq + 1, nullptr, 10); }
+    else if(name == "sensorDistance"){ config.sensorDistance = value; }
+    else if(name == "sensorAngle"){ config.sensorAngle = value; }
+    else if(name == "turnSpeed"){ config.turnSpeed = value; }
+    else if(name == "speed"){ config.speed = value; }
+    else if(name == "diffuse"){ config.diffuse = value; }
+    else if(name == "fade"){ config.fade = value; }
+    else{ return false; }
+    return true;
+}
+
+int main(int argc, char** argv){
+    if(argc < 6){
+        std::cout << "Usage: " << argv[0] << " <ranksX> <ranksY> <agents> <worldSize> <steps> [name=value ...]" << std::endl;
+        return 1;
+    }
+    int ranksX = std::atoi(argv[1]);
+    int ranksY = std::atoi(argv[2]);
+    settings config;
+    config.agentCount = std::atoi(argv[3]);
+    int worldSize = std::atoi(argv[4]);
+    config.steps = std::atoi(argv[5]);
+    for(int i = 6; i < argc; i++){
+        if(!setOption(config, argv[i])){
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // Set up the shared memory before forking, so every rank inherits the same mapping
+    decomposition domain(ranksX, ranksY, worldSize, config.haloWidth());
+    sharedLayout layout(domain, config.agentCount / domain.rankCount() / 4 + 1024, config.exportInterval > 0);
+    sharedMemory shm;
+    shm.create("/glslslime_" + std::to_string(getpid()), layout.size());
+    sharedHeader* header = new (shm.at<void>(layout.header())) sharedHeader;
+    header->barrier.init();
+    header->droppedAgents.store(0);
+    header->aliveAgents.store(0);
+    std::cout << domain.rankCount() << " ranks, " << domain.tileWidth << "x" << domain.tileHeight << " texels each (+" << domain.halo << " halo), "
+              << layout.size() / (1024*1024) << " MiB shared memory" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<pid_t> children;
+    for(int rank = 0; rank < domain.rankCount(); rank++){
+        pid_t pid = fork();
+        if(pid == 0){
+            _exit(runRank(rank, domain, layout, config, shm)); // _exit so the child doesnt unlink the shared memory on the way out
+        }
+        if(pid < 0){
+            std::cout << "Error forking rank " << rank << std::endl;
+            header->barrier.abort();
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    bool failed = children.size() != (size_t)domain.rankCount();
+    for(size_t i = 0; i < children.size(); i++){
+        int status = 0;
+        pid_t pid = wait(&status);
+        if(pid > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)){
+            failed = true;
+            header->barrier.abort(); // Let the others give up instead of waiting forever at the barrier
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(failed){
+        std::cout << "Distributed run failed" << std::endl;
+        return 1;
+    }
+    std::cout << config.steps << " steps in " << seconds << "s (" << config.steps/seconds << " steps/s), "
+              << header->aliveAgents.load() << " agents alive, " << header->droppedAgents.load() << " dropped" << std::endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "simulation/encoding/frameWriter.hpp"
+
+/*
+    Compares the frame export paths on a synthetic frame, without needing a GPU
+    Usage: GLSLSlimeEncoderBenchmark [resolution] [repeats] [threads]
+
+    Every qoi result is decoded again and compared with the input, so this doubles as a check that the strip encoding is lossless
+*/
+
+// Trail-like test frame, smooth blobs with thin bright lines and a bit of noise, in the same 0-1 float RGBA as the simulation texture
+static std::vector<float> makeFrame(int res){
+    std::vector<float> frame((size_t)res * res * 4);
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> noise(0.0f, 0.02f);
+    for(int y = 0; y < res; y++){
+        for(int x = 0; x < res; x++){
+            float fx = (float)x / res, fy = (float)y / res;
+            float trail = 0.5f + 0.5f * std::sin(fx * 40.0f + std::sin(fy * 13.0f) * 3.0f) * std::cos(fy * 31.0f);
+            trail = trail * trail * trail + noise(gen);
+            float* p = &frame[((size_t)y * res + x) * 4];
+            p[0] = trail * 0.1f;
+            p[1] = trail * 0.6f * fx;
+            p[2] = trail * 0.9f;
+            p[3] = (trail > 1.0f)? 1.0f : trail;
+        }
+    }
+    return frame;
+}
+
+// Reference QOI decoder, straight from the spec
+static std::vector<uint8_t> decodeQOI(const std::vector<uint8_t>& data, int width, int height){
+    std::vector<uint8_t> out((size_t)width * height * 4);
+    uint8_t index[64][4] = {};
+    uint8_t px[4] = {0, 0, 0, 255};
+    size_t p = 14;
+    int run = 0;
+    for(size_t i = 0; i < out.size(); i += 4){
+        if(run > 0){
+            run--;
+        }else{
+            uint8_t b1 = data[p++];
+            if(b1 == 0xFE){
+                px[0] = data[p++]; px[1] = data[p++]; px[2] = data[p++];
+            }else if(b1 == 0xFF){
+                px[0] = data[p++]; px[1] = data[p++]; px[2] = data[p++]; px[3] = data[p++];
+            }else if((b1 & 0xC0) == 0x00){
+                for(int c = 0; c < 4; c++){ px[c] = index[b1][c]; }
+            }else if((b1 & 0xC0) == 0x40){
+                px[0] += ((b1 >> 4) & 3) - 2;
+                px[1] += ((b1 >> 2) & 3) - 2;
+                px[2] += (b1 & 3) - 2;
+            }else if((b1 & 0xC0) == 0x80){
+                uint8_t b2 = data[p++];
+                int dg = (b1 & 0x3F) - 32;
+                px[0] += dg - 8 + ((b2 >> 4) & 0x0F);
+                px[1] += dg;
+                px[2] += dg - 8 + (b2 & 0x0F);
+            }else{
+                run = b1 & 0x3F;
+            }
+            int h = (px[0]*3 + px[1]*5 + px[2]*7 + px[3]*11) % 64;
+            for(int c = 0; c < 4; c++){ index[h][c] = px[c]; }
+        }
+        for(int c = 0; c < 4; c++){ out[i + c] = px[c]; }
+    }
+    return out;
+}
+
+template<typename F> static double timeMs(int repeats, F f){
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < repeats; i++){
+        f();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main(int argc, char** argv){
+    int res = (argc > 1)? std::atoi(argv[1]) : 4096;
+    int repeats = (argc > 2)? std::atoi(argv[2]) : 3;
+    int threads = (argc > 3)? std::atoi(argv[3]) : encoding::defaultThreadCount();
+    std::cout << "Frame " << res << "x" << res << ", " << repeats << " repeats, " << threads << " threads" << std::endl;
+    std::vector<float> frame = makeFrame(res);
+    std::vector<uint8_t> rgba((size_t)res * res * 4);
+    double megapixels = (double)res * res / 1e6;
+
+    double scalar = timeMs(repeats, [&](){
+        for(size_t i = 0; i < rgba.size(); i++){
+            float v = frame[i] * 255.0f + 0.5f;
+            rgba[i] = !(v > 0.0f)? 0 : (v >= 255.0f)? 255 : (uint8_t)v;
+        }
+    });
+    double simd = timeMs(repeats, [&](){ encoding::floatToRGBA8(frame.data(), rgba.data(), (size_t)res * res); });
+    encoding::stripWorkers workers;
+    double simdThreaded = timeMs(repeats, [&](){ encoding::floatToRGBA8(frame.data(), rgba.data(), res, res, workers, threads); });
+    std::cout << "float -> 8 bit: scalar " << scalar << " ms, simd " << simd << " ms, simd+threads " << simdThreaded << " ms" << std::endl;
+
+    encoding::qoiEncoder qoi;
+    std::vector<uint8_t> encoded;
+    for(int t : {1, threads}){
+        qoi.setThreads(t);
+        double ms = timeMs(repeats, [&](){ qoi.encode(rgba.data(), res, res, encoded); });
+        bool lossless = decodeQOI(encoded, res, res) == rgba;
+        std::cout << "qoi, " << t << " thread(s): " << ms << " ms (" << megapixels / ms * 1000 << " MP/s), " << encoded.size() / 1e6 << " MB, "
+                  << (lossless ? "lossless" : "DECODE MISMATCH") << std::endl;
+        if(!lossless){
+            return 1;
+        }
+    }
+
+#if GLSLSLIME_HAVE_OPENCV
+    // What frame export used to do: scale to 8 bit, swap to BGRA and let opencv write a png (encoded to memory here so the disk isnt timed)
+    std::vector<uint8_t> png;
+    double opencv = timeMs(repeats, [&](){
+        cv::Mat img(res, res, CV_32FC4, frame.data());
+        cv::Mat bytes;
+        img.convertTo(bytes, CV_8UC4, 255.0);
+        cv::cvtColor(bytes, bytes, cv::COLOR_RGBA2BGRA);
+        cv::imencode(".png", bytes, png);
+    });
+    std::cout << "opencv png (old path): " << opencv << " ms (" << megapixels / opencv * 1000 << " MP/s), " << png.size() / 1e6 << " MB" << std::endl;
+#else
+    std::cout << "Built without opencv, skipping the png comparison" << std::endl;
+#endif
+    return 0;
+}
@@ -0,0 +1,233 @@
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "glslslime.h"
+#include "../misc/headlessContext.hpp"
+#include "../simulation/simulation.hpp"
+#include "../simulation/OpenGLComponents/asyncReadback.hpp"
+#include "../simulation/OpenGLComponents/shaderFiles.hpp"
+
+/*
+    Implementation of glslslime.h
+    Only the simulation's non-UI interface is used here (setup, applySettings, step, parameters, readbacks), no ImGui
+    frame is ever started and none of the window callbacks or globals are touched
+*/
+
+struct glslslime_sim{
+    GLFWwindow* context = nullptr;
+    std::string shaderRoot; // Shaders can be loaded after setup (e.g. on restart), so each simulation keeps its own
+    std::unique_ptr<simulation::main> sim;
+    openGLComponents::asyncReadback trailReadback; // One slot each, the slot in flight is what the caller has mapped
+    openGLComponents::asyncReadback agentReadback;
+};
+
+namespace{
+
+    thread_local std::string lastError;
+    std::atomic<int> openSimulations{0}; // GLFW is set up with the first simulation and shut down with the last
+
+    // Pointers handed out by the map functions stop being valid here
+    void unmap(glslslime_sim* s){
+        s->trailReadback.release();
+        s->agentReadback.release();
+    }
+
+    // Runs f with the simulation's context and shader root current on this thread, turning exceptions into failed + lastError
+    // The context is let go of afterwards, a context can only be current on one thread so the next call might be from another
+    template<typename R, typename F>
+    R guarded(glslslime_sim* s, R failed, F f){
+        try{
+            if(s == nullptr){
+                throw std::runtime_error("simulation is null");
+            }
+            glfwMakeContextCurrent(s->context);
+            openGLComponents::shaderRoot = s->shaderRoot;
+            R result = f();
+            glfwMakeContextCurrent(nullptr);
+            return result;
+        }catch(const std::exception& e){
+            glfwMakeContextCurrent(nullptr);
+            lastError = e.what();
+            return failed;
+        }
+    }
+
+    const simulation::main::parameter* findParameter(glslslime_sim* s, const char* name){
+        for(const simulation::main::parameter& p : s->sim->getParameters()){
+            if(std::string(name) == p.name){
+                return &p;
+            }
+        }
+        return nullptr;
+    }
+
+}
+
+extern "C" {
+
+glslslime_sim* glslslime_create(int agentCount, int resolution, const char* shaderRoot){
+    bool glfwStarted = false;
+    auto s = std::make_unique<glslslime_sim>();
+    try{
+        s->shaderRoot = (shaderRoot != nullptr)? shaderRoot : "";
+        openGLComponents::shaderRoot = s->shaderRoot;
+        if(!std::ifstream(openGLComponents::shaderFile("GLSL/agent.compute.glsl")).good()){
+            throw std::runtime_error("cant find GLSL/agent.compute.glsl in " + (openGLComponents::shaderRoot.empty()? std::string("the working directory") : openGLComponents::shaderRoot));
+        }
+        if(agentCount < 0 || resolution <= 0){
+            throw std::runtime_error("agentCount must be >= 0 and resolution > 0");
+        }
+        if(openSimulations == 0 && !glfwInit()){
+            throw std::runtime_error("Error initializing glfw");
+        }
+        openSimulations++;
+        glfwStarted = true;
+        s->context = headless::createContext(GL_DEBUG_LEVEL_CALLBACK);
+        s->sim = std::make_unique<simulation::main>(agentCount, resolution);
+        s->sim->setup();
+        glfwMakeContextCurrent(nullptr); // Free for whichever thread uses it
+        return s.release();
+    }catch(const std::exception& e){
+        lastError = e.what();
+        if(s->context != nullptr){
+            s->sim.reset();
+            glfwDestroyWindow(s->context);
+        }
+        if(glfwStarted && --openSimulations == 0){
+            glfwTerminate();
+        }
+        return nullptr;
+    }
+}
+
+void glslslime_destroy(glslslime_sim* sim){
+    if(sim == nullptr){
+        return;
+    }
+    glfwMakeContextCurrent(sim->context);
+    sim->sim.reset();
+    sim->trailReadback.destroy();
+    sim->agentReadback.destroy();
+    glfwMakeContextCurrent(nullptr);
+    glfwDestroyWindow(sim->context);
+    delete sim;
+    if(--openSimulations == 0){
+        glfwTerminate();
+    }
+}
+
+int glslslime_set_parameter(glslslime_sim* sim, const char* name, const double* values, int count){
+    return guarded(sim, -1, [&](){
+        if(name == nullptr || values == nullptr || count <= 0){
+            throw std::runtime_error("set_parameter needs a name and at least one value");
+        }
+        if(!sim->sim->setParameter(name, std::vector<double>(values, values + count))){
+            throw std::runtime_error(std::string("unknown parameter, wrong number of values or out of range: ") + name);
+        }
+        return 0;
+    });
+}
+
+int glslslime_get_parameter(glslslime_sim* sim, const char* name, double* values, int capacity){
+    return guarded(sim, -1, [&](){
+        const simulation::main::parameter* p = (name != nullptr)? findParameter(sim, name) : nullptr;
+        if(p == nullptr){
+            throw std::runtime_error(std::string("unknown parameter: ") + (name != nullptr? name : "(null)"));
+        }
+        std::vector<double> current = sim->sim->getParameter(*p);
+        for(int c = 0; c < (int)current.size() && c < capacity && values != nullptr; c++){
+            values[c] = current[c];
+        }
+        return (int)current.size();
+    });
+}
+
+int glslslime_restart(glslslime_sim* sim){
+    return guarded(sim, -1, [&](){
+        unmap(sim);
+        if(!sim->sim->restart()){
+            throw std::runtime_error("restart refused: " + sim->sim->getPreflightMessage());
+        }
+        return 0;
+    });
+}
+
+int glslslime_step(glslslime_sim* sim, int count){
+    return guarded(sim, -1, [&](){
+        unmap(sim);
+        for(int i = 0; i < count; i++){
+            sim->sim->applySettings();
+            sim->sim->step();
+        }
+        return 0;
+    });
+}
+
+long long glslslime_step_count(const glslslime_sim* sim){
+    return (sim != nullptr)? sim->sim->getStepCount() : -1;
+}
+
+const float* glslslime_map_trail(glslslime_sim* sim, int* width, int* height){
+    return guarded(sim, (const float*)nullptr, [&](){
+        int res = sim->sim->getResolution();
+        size_t bytes = 16ull * res * res;
+        sim->trailReadback.release();
+        if(sim->trailReadback.getCapacity() != bytes){ // Resolution changed since the last map
+            sim->trailReadback.init(bytes, 1);
+        }
+        sim->trailReadback.requestTexture(sim->sim->getTextureID(), 0, 0, 0, res, res, GL_RGBA, GL_FLOAT, bytes);
+        const void* data = sim->trailReadback.wait();
+        if(data == nullptr){
+            throw std::runtime_error("trail readback failed");
+        }
+        if(width != nullptr){ *width = res; }
+        if(height != nullptr){ *height = res; }
+        return static_cast<const float*>(data);
+    });
+}
+
+const float* glslslime_map_agents(glslslime_sim* sim, int* count){
+    return guarded(sim, (const float*)nullptr, [&](){
+        static const float none[4] = {};
+        int agents = sim->sim->getAgentCount();
+        if(count != nullptr){ *count = agents; }
+        if(agents == 0){
+            return none;
+        }
+        size_t bytes = 16ull * agents;
+        sim->agentReadback.release();
+        if(sim->agentReadback.getCapacity() != bytes){
+            sim->agentReadback.init(bytes, 1);
+        }
+        sim->agentReadback.requestBuffer(sim->sim->getAgentBufferID(), 0, bytes);
+        const void* data = sim->agentReadback.wait();
+        if(data == nullptr){
+            throw std::runtime_error("agent readback failed");
+        }
+        return static_cast<const float*>(data);
+    });
+}
+
+int glslslime_save_frame(glslslime_sim* sim, const char* path){
+    return guarded(sim, -1, [&](){
+        if(path == nullptr){
+            throw std::runtime_error("save_frame needs a path");
+        }
+        sim->sim->saveFrame(path);
+        return 0;
+    });
+}
+
+const char* glslslime_last_error(void){
+    return lastError.c_str();
+}
+
+}
@@ -0,0 +1,70 @@
+#ifndef GLSLSLIME_H
+#define GLSLSLIME_H
+
+/*
+    C API for embedding the simulation in other programs, built as the glslslime library target
+
+    Each simulation has its own hidden OpenGL 4.6 context (so no window and no UI), which the functions make current
+    on the calling thread. Use a simulation from one thread at a time (different simulations can be used from different
+    threads at once), and create/destroy them from the main thread since that is where GLFW wants windows made
+
+    Reading state back doesnt allocate or copy on the host: the GPU copies into a persistently mapped buffer and you get a
+    pointer straight into it. Those pointers stay valid until the next call that steps, restarts, maps the same kind of
+    data again or destroys the simulation
+
+    Functions that can fail return 0 on success (or a valid pointer), and -1 (or NULL) on failure with the reason in
+    glslslime_last_error()
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GLSLSLIME_API_VERSION 1
+
+typedef struct glslslime_sim glslslime_sim;
+
+/*
+    Creates a simulation with agentCount agents on a resolution*resolution texture
+    shaderRoot is the directory containing the GLSL folder (the build directory has one), NULL = the working directory
+*/
+glslslime_sim* glslslime_create(int agentCount, int resolution, const char* shaderRoot);
+void glslslime_destroy(glslslime_sim* sim);
+
+/*
+    Settings by name, the same names as the control socket (see simulation/control.hpp), colours have 3 values
+    agentCount, resolution and seed only take effect after glslslime_restart()
+    glslslime_get_parameter returns how many values the setting has (which may be more than capacity), or -1
+*/
+int glslslime_set_parameter(glslslime_sim* sim, const char* name, const double* values, int count);
+int glslslime_get_parameter(glslslime_sim* sim, const char* name, double* values, int capacity);
+int glslslime_restart(glslslime_sim* sim);
+
+int glslslime_step(glslslime_sim* sim, int count);
+long long glslslime_step_count(const glslslime_sim* sim);
+
+/*
+    The trail texture, width*height RGBA floats row by row from y = 0, the trail deposit agents sense is the alpha (4th) value
+*/
+const float* glslslime_map_trail(glslslime_sim* sim, int* width, int* height);
+
+/*
+    The agents, count*4 floats: x, y, angle and a 4th value which is negative for empty slots
+*/
+const float* glslslime_map_agents(glslslime_sim* sim, int* count);
+
+/*
+    Writes the trail as an image the same way the GUI exports frames, the format comes from the extension
+*/
+int glslslime_save_frame(glslslime_sim* sim, const char* path);
+
+/*
+    Why the last call on this thread failed
+*/
+const char* glslslime_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
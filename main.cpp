@@ -7,16 +7,99 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <iostream>
+#include <string>
+#include <cstdlib>
 #include <thread>
 
 #include "misc/debugMessageCallback.hpp"
+#include "misc/headlessContext.hpp"
+#include "misc/controlSocket.hpp"
 #include "simulation/simulation.hpp"
+#include "simulation/simulationThread.hpp"
+#include "simulation/volume.hpp"
+#include "simulation/control.hpp"
 
 #define N_AGENTS 100000
 #define TEXTURE_SIZE 1024
-#define DEBUG true
+#define GL_DEBUG_LEVEL GL_DEBUG_LEVEL_CALLBACK // Runtime level, capped by what was compiled in (see OpenGLComponents/debugging.hpp)
+
+/*
+    Command line options (all optional):
+        --agents <n>          starting agent count (default N_AGENTS)
+        --resolution <n>      starting texture size (default TEXTURE_SIZE)
+        --control <path>      listen for JSON commands on a unix socket at path, see simulation/control.hpp
+        --headless            no window or UI, the simulation only steps when told to over the control socket
+        --volume <n>          run the 3D simulation in an n^3 volume instead (see simulation/volume.hpp and GLSLSlimeVolume)
+        --threaded            step the simulation on its own thread, the window just shows the newest frame (see simulation/simulationThread.hpp)
+        --journal <path>      save the settings journal there on exit, for replaying the session with GLSLSlimeReplay
+*/
+int main(int argc, char** argv){
+    int agents = N_AGENTS;
+    int resolution = TEXTURE_SIZE;
+    std::string controlPath;
+    bool headlessMode = false;
+    int volumeSize = 0;
+    bool threaded = false;
+    std::string journalPath;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--agents" && hasValue){ agents = std::atoi(argv[++i]); }
+        else if(arg == "--resolution" && hasValue){ resolution = std::atoi(argv[++i]); }
+        else if(arg == "--control" && hasValue){ controlPath = argv[++i]; }
+        else if(arg == "--headless"){ headlessMode = true; }
+        else if(arg == "--volume" && hasValue){ volumeSize = std::atoi(argv[++i]); }
+        else if(arg == "--threaded"){ threaded = true; }
+        else if(arg == "--journal" && hasValue){ journalPath = argv[++i]; }
+        else{
+            std::cout << "Unknown option " << arg << std::endl;
+            std::cout << "Usage: " << argv[0] << " [--agents n] [--resolution n] [--control socketPath] [--headless] [--volume n] [--threaded] [--journal path]" << std::endl;
+            return 1;
+        }
+    }
+    if(volumeSize > 0 && (headlessMode || !controlPath.empty())){
+        std::cout << "--volume doesnt support the control socket, use GLSLSlimeVolume for headless 3D runs" << std::endl;
+        return 1;
+    }
+    if(volumeSize > 0 && !journalPath.empty()){
+        std::cout << "--journal only applies to the 2D simulation" << std::endl;
+        return 1;
+    }
+    if(threaded && (headlessMode || volumeSize > 0)){
+        std::cout << "--threaded only applies to the 2D simulation with a window" << std::endl;
+        return 1;
+    }
+    if(headlessMode && controlPath.empty()){
+        std::cout << "--headless needs --control, otherwise there is nothing to tell the simulation what to do" << std::endl;
+        return 1;
+    }
+
+    /*
+        ===== Headless control, a warm process that just runs commands from the control socket until told to quit
+    */
+    if(headlessMode){
+        glfwInit();
+        auto window = headless::createContext(GL_DEBUG_LEVEL);
+        {
+            simulation::main sim(agents, resolution);
+            sim.setup();
+            simulation::controlCommands commands(sim);
+            control::controlSocket socket;
+            socket.open(controlPath);
+            std::cout << "Listening for commands on " << controlPath << std::endl;
+            while(!commands.shouldQuit()){
+                socket.poll([&](const std::string& line){ return commands.handle(line); }, 50);
+                sim.applySettings();
+            }
+            if(!journalPath.empty() && !sim.saveJournal(journalPath)){
+                std::cout << sim.getJournal().getMessage() << std::endl;
+            }
+        }
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
 
-int main(){
     /*
         ===== GLFW/GLAD/IMGUI setup
     */
@@ -24,6 +107,9 @@ int main(){
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if(GLSLSLIME_GL_DEBUG_LEVEL >= GL_DEBUG_LEVEL_CALLBACK){
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    }
     auto window = glfwCreateWindow(simulation::winGlobals::windowStartWidth, simulation::winGlobals::windowStartHeight, "Simulation", nullptr, nullptr);
     if(!window){
         throw std::runtime_error("Error creating glfw window");
@@ -36,10 +122,10 @@ int main(){
     if(!gladLoaderLoadGL()){
         throw std::runtime_error("Error initializing glad");
     }
-    if(DEBUG){
-        GLCall(glEnable(GL_DEBUG_OUTPUT));
+    if(GLSLSLIME_GL_DEBUG_LEVEL >= GL_DEBUG_LEVEL_CALLBACK){
         GLCall(glDebugMessageCallback(debug::messageCallback, nullptr));
     }
+    debugging::setLevel(GL_DEBUG_LEVEL);
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
@@ -48,32 +134,87 @@ int main(){
     GLCall(glClearColor(0.1f, 0.1f, 0.1f, 1.0f));
 
     /*
-        ===== Simulation setup
+        ===== 3D mode, same frame loop with the volume instead of the 2D simulation
     */
-    simulation::main sim(N_AGENTS, TEXTURE_SIZE);
-    sim.setup();
+    if(volumeSize > 0){
+        simulation::volume volume(agents, volumeSize);
+        volume.setup();
+        while(!glfwWindowShouldClose(window)){
+            glfwPollEvents();
+            if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){ glfwSetWindowShouldClose(window, true); }
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
 
-    /*
-        ===== Main loop
-    */
-    while(!glfwWindowShouldClose(window)){
-        // ===== Process input and start a new imgui frame
-        glfwPollEvents();
-        if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){ glfwSetWindowShouldClose(window, true); }
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+            volume.update();
+            volume.step();
+            volume.render((float)simulation::winGlobals::newWidth/simulation::winGlobals::newHeight);
+
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            glfwSwapBuffers(window);
+            GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        }
+    }else if(threaded){
+        /*
+            ===== Threaded mode, the simulation steps on its own thread and this loop only draws the UI and the newest frame
+        */
+        simulation::simulationThread sim(window, agents, resolution, controlPath, GL_DEBUG_LEVEL, journalPath);
+        sim.start();
+        while(!glfwWindowShouldClose(window) && sim.running()){
+            glfwPollEvents();
+            if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){ glfwSetWindowShouldClose(window, true); }
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            sim.update();
+            sim.render();
+
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            glfwSwapBuffers(window);
+            GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        }
+        sim.stop();
+    }else{
+        /*
+            ===== Simulation setup
+        */
+        simulation::main sim(agents, resolution);
+        sim.setup();
+        simulation::controlCommands commands(sim);
+        control::controlSocket socket;
+        if(!controlPath.empty()){
+            socket.open(controlPath);
+        }
+
+        /*
+            ===== Main loop
+        */
+        while(!glfwWindowShouldClose(window) && !commands.shouldQuit()){
+            // ===== Process input and start a new imgui frame
+            glfwPollEvents();
+            if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){ glfwSetWindowShouldClose(window, true); }
+            socket.poll([&](const std::string& line){ return commands.handle(line); });
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
 
-        // ===== Draw imgui window, update+render simulation
-        sim.update(); // imgui, window, etc
-        sim.step(); // Runs compute shaders to update agents
-        sim.render(); // Draws quad with simulation texture
+            // ===== Draw imgui window, update+render simulation
+            sim.update(); // imgui, window, etc
+            sim.step(); // Runs compute shaders to update agents
+            sim.render(); // Draws quad with simulation texture
 
-        // ===== Render imgui and swap buffers
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glfwSwapBuffers(window);
-        GLCall(glClear(GL_COLOR_BUFFER_BIT));
+            // ===== Render imgui and swap buffers
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            glfwSwapBuffers(window);
+            GLCall(glClear(GL_COLOR_BUFFER_BIT));
+        }
+        if(!journalPath.empty() && !sim.saveJournal(journalPath)){
+            std::cout << sim.getJournal().getMessage() << std::endl;
+        }
     }
 
     /*
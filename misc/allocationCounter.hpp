@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+    Counts heap allocations made through operator new, so allocations in the main loop show up in the Info window
+    (steady state should be 0, anything else is a regression)
+
+    Built in with -DGLSLSLIME_COUNT_ALLOCATIONS=ON, which only the GLSLSlime executable gets. The replacement operator
+    new/delete below can only be compiled into one translation unit of a program, which is fine since GLSLSlime is just
+    main.cpp, and the library never gets it since it would replace the allocator of whatever links it
+    Only C++ allocations are counted, imgui/glfw/the driver use malloc directly, aligned new isnt replaced either
+*/
+#ifndef GLSLSLIME_COUNT_ALLOCATIONS
+#define GLSLSLIME_COUNT_ALLOCATIONS 0
+#endif
+
+namespace allocations{
+    inline constexpr bool counted = GLSLSLIME_COUNT_ALLOCATIONS != 0;
+    inline std::atomic<unsigned long long> count{0};
+    inline std::atomic<unsigned long long> bytes{0};
+
+    /*
+        Allocations between two calls of sample(), e.g. once per frame
+    */
+    struct frameCounter{
+        unsigned long long lastCount = 0;
+        unsigned long long lastBytes = 0;
+        unsigned long long frameCount = 0;
+        unsigned long long frameBytes = 0;
+        unsigned long long framesWithAllocations = 0;
+
+        void sample(){
+            unsigned long long c = count.load(std::memory_order_relaxed);
+            unsigned long long b = bytes.load(std::memory_order_relaxed);
+            this->frameCount = c - this->lastCount;
+            this->frameBytes = b - this->lastBytes;
+            this->lastCount = c;
+            this->lastBytes = b;
+            if(this->frameCount > 0){
+                this->framesWithAllocations++;
+            }
+        }
+    };
+}
+
+#if GLSLSLIME_COUNT_ALLOCATIONS
+// new[] and the nothrow versions call these, so they are counted too
+void* operator new(std::size_t size){
+    allocations::count.fetch_add(1, std::memory_order_relaxed);
+    allocations::bytes.fetch_add(size, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept{
+    std::free(p);
+}
+#endif
@@ -0,0 +1,172 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace control{
+
+    /*
+        Unix domain socket that takes one command per line and sends one reply line back for each
+        Everything is non-blocking so it can be polled from the render loop, and any number of clients can be connected at once
+        (commands from different clients are just handled in whatever order they arrive)
+    */
+    class controlSocket{
+        private:
+            struct client{
+                int fd;
+                std::string input;
+                std::string output;
+            };
+
+            static constexpr size_t maxLine = 1 << 20; // Clients sending more than this without a newline get disconnected
+
+            int listenFD = -1;
+            std::string path;
+            std::vector<client> clients;
+
+        #ifndef _WIN32
+            static void setNonBlocking(int fd){
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            }
+
+            void acceptClients(){
+                while(true){
+                    int fd = accept(this->listenFD, nullptr, nullptr);
+                    if(fd < 0){
+                        return;
+                    }
+                    setNonBlocking(fd);
+                    this->clients.push_back({fd, "", ""});
+                }
+            }
+
+            // Returns false if the client has gone away
+            bool flush(client& c){
+                while(!c.output.empty()){
+                    ssize_t sent = send(c.fd, c.output.data(), c.output.size(), MSG_NOSIGNAL);
+                    if(sent < 0){
+                        return errno == EAGAIN || errno == EWOULDBLOCK;
+                    }
+                    c.output.erase(0, sent);
+                }
+                return true;
+            }
+        #endif
+
+        public:
+            ~controlSocket(){
+                this->close();
+            }
+
+            void open(const std::string& path){
+            #ifdef _WIN32
+                throw std::runtime_error("The control socket is only supported on unix");
+            #else
+                this->close();
+                sockaddr_un address = {};
+                if(path.size() >= sizeof(address.sun_path)){
+                    throw std::runtime_error("Control socket path is too long: " + path);
+                }
+                address.sun_family = AF_UNIX;
+                std::strcpy(address.sun_path, path.c_str());
+                unlink(path.c_str()); // Left behind if the last process crashed
+                this->listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+                if(this->listenFD < 0 || bind(this->listenFD, (sockaddr*)&address, sizeof(address)) != 0 || listen(this->listenFD, 8) != 0){
+                    std::string error = std::strerror(errno);
+                    this->close();
+                    throw std::runtime_error("Could not open control socket " + path + ": " + error);
+                }
+                setNonBlocking(this->listenFD);
+                this->path = path;
+            #endif
+            }
+
+            void close(){
+            #ifndef _WIN32
+                for(client& c : this->clients){
+                    ::close(c.fd);
+                }
+                this->clients.clear();
+                if(this->listenFD >= 0){
+                    ::close(this->listenFD);
+                    unlink(this->path.c_str());
+                    this->listenFD = -1;
+                }
+            #endif
+            }
+
+            bool isOpen() const{
+                return this->listenFD >= 0;
+            }
+
+            /*
+                Accepts new clients and calls handler(line) for every complete line received, sending back whatever it returns
+                Waits up to timeoutMs for something to happen if there is nothing to do yet (0 = dont wait at all)
+            */
+            void poll(const std::function<std::string(const std::string&)>& handler, int timeoutMs=0){
+            #ifndef _WIN32
+                if(this->listenFD < 0){
+                    return;
+                }
+                if(timeoutMs > 0){
+                    std::vector<pollfd> fds;
+                    fds.push_back({this->listenFD, POLLIN, 0});
+                    for(client& c : this->clients){
+                        fds.push_back({c.fd, POLLIN, 0});
+                    }
+                    ::poll(fds.data(), fds.size(), timeoutMs);
+                }
+                this->acceptClients();
+                for(size_t i = 0; i < this->clients.size(); i++){
+                    client& c = this->clients[i];
+                    char buffer[4096];
+                    bool open = true;
+                    while(true){
+                        ssize_t received = recv(c.fd, buffer, sizeof(buffer), 0);
+                        if(received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)){
+                            open = false;
+                        }
+                        if(received <= 0){
+                            break;
+                        }
+                        c.input.append(buffer, received);
+                        if(c.input.size() > maxLine && c.input.find('\n') == std::string::npos){
+                            c.input.clear();
+                            open = false;
+                            break;
+                        }
+                    }
+                    size_t newline;
+                    while((newline = c.input.find('\n')) != std::string::npos){
+                        std::string line = c.input.substr(0, newline);
+                        c.input.erase(0, newline + 1);
+                        if(!line.empty() && line.back() == '\r'){
+                            line.pop_back();
+                        }
+                        if(!line.empty()){
+                            c.output += handler(line) + "\n";
+                        }
+                    }
+                    open = this->flush(c) && open;
+                    if(!open && c.output.empty()){
+                        ::close(c.fd);
+                        this->clients.erase(this->clients.begin() + i);
+                        i--;
+                    }
+                }
+            #endif
+            }
+    };
+
+}
@@ -1,3 +1,4 @@
+#pragma once
 #define GLFW_INCLUDE_NONE
 
 #include <iostream>
@@ -8,7 +9,7 @@
 
 namespace debug{
 
-void messageCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
+inline void messageCallback(GLenum source, GLenum type, GLuint id, GLenum severity,
                         GLsizei length, GLchar const *message,
                         void const *user_param){
     if (severity == GL_DEBUG_SEVERITY_NOTIFICATION){
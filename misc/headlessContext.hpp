@@ -0,0 +1,41 @@
+#pragma once
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+#include <stdexcept>
+
+#include "debugMessageCallback.hpp"
+#include "../simulation/OpenGLComponents/debugging.hpp"
+
+namespace headless{
+
+    /*
+        Creates an invisible window just to get an OpenGL 4.6 context for running the compute shaders without any UI
+        glfwInit() must have been called already, the context is made current on the calling thread
+    */
+    inline GLFWwindow* createContext(int debugLevel=GL_DEBUG_LEVEL_CALLBACK, GLFWwindow* shareWith=nullptr){
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        if(GLSLSLIME_GL_DEBUG_LEVEL >= GL_DEBUG_LEVEL_CALLBACK){
+            glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+        }
+        auto window = glfwCreateWindow(1, 1, "GLSLSlime (headless)", nullptr, shareWith);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE); // Dont leave the hint set for any windows created afterwards
+        if(!window){
+            throw std::runtime_error("Error creating headless glfw window");
+        }
+        glfwMakeContextCurrent(window);
+        if(!gladLoaderLoadGL()){
+            throw std::runtime_error("Error initializing glad");
+        }
+        if(GLSLSLIME_GL_DEBUG_LEVEL >= GL_DEBUG_LEVEL_CALLBACK){
+            GLCall(glDebugMessageCallback(debug::messageCallback, nullptr));
+        }
+        debugging::setLevel(debugLevel);
+        return window;
+    }
+
+}
@@ -0,0 +1,276 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace json{
+
+    /*
+        Just enough JSON for the control socket, parses one line at a time into a value tree
+        Numbers are always doubles, and the parser throws std::runtime_error on anything it doesnt understand
+    */
+    struct value{
+        enum kind{ NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+        kind type = NUL;
+        bool boolean = false;
+        double number = 0;
+        std::string string;
+        std::vector<value> array;
+        std::map<std::string, value> object;
+
+        bool has(const std::string& key) const{
+            return this->type == OBJECT && this->object.count(key) != 0;
+        }
+
+        const value& operator[](const std::string& key) const{
+            static const value null;
+            auto it = this->object.find(key);
+            return (it == this->object.end())? null : it->second;
+        }
+
+        double getNumber(const std::string& key, double fallback) const{
+            const value& v = (*this)[key];
+            return (v.type == NUMBER)? v.number : (v.type == BOOLEAN)? v.boolean : fallback;
+        }
+
+        std::string getString(const std::string& key, const std::string& fallback="") const{
+            const value& v = (*this)[key];
+            return (v.type == STRING)? v.string : fallback;
+        }
+    };
+
+    class parser{
+        private:
+            const std::string& text;
+            size_t pos = 0;
+
+            void skipWhitespace(){
+                while(this->pos < this->text.size() && (this->text[this->pos] == ' ' || this->text[this->pos] == '\t' || this->text[this->pos] == '\r' || this->text[this->pos] == '\n')){
+                    this->pos++;
+                }
+            }
+
+            [[noreturn]] void fail(const char* what){
+                throw std::runtime_error(std::string("JSON: ") + what + " at character " + std::to_string(this->pos));
+            }
+
+            void expect(char c){
+                this->skipWhitespace();
+                if(this->pos >= this->text.size() || this->text[this->pos] != c){
+                    this->fail((std::string("expected '") + c + "'").c_str());
+                }
+                this->pos++;
+            }
+
+            bool literal(const char* word){
+                size_t length = std::char_traits<char>::length(word);
+                if(this->text.compare(this->pos, length, word) == 0){
+                    this->pos += length;
+                    return true;
+                }
+                return false;
+            }
+
+            std::string parseString(){
+                this->expect('"');
+                std::string out;
+                while(this->pos < this->text.size() && this->text[this->pos] != '"'){
+                    char c = this->text[this->pos++];
+                    if(c != '\\'){
+                        out += c;
+                        continue;
+                    }
+                    if(this->pos >= this->text.size()){
+                        break;
+                    }
+                    char e = this->text[this->pos++];
+                    switch(e){
+                        case 'n': out += '\n'; break;
+                        case 't': out += '\t'; break;
+                        case 'r': out += '\r'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'u':{ // Only ASCII escapes are kept, anything else becomes '?'
+                            unsigned long code = std::strtoul(this->text.substr(this->pos, 4).c_str(), nullptr, 16);
+                            out += (code < 128)? (char)code : '?';
+                            this->pos += 4;
+                            break;
+                        }
+                        default: out += e; break; // \" \\ \/
+                    }
+                }
+                this->expect('"');
+                return out;
+            }
+
+            value parseValue(int depth){
+                if(depth > 32){
+                    this->fail("nested too deeply");
+                }
+                this->skipWhitespace();
+                if(this->pos >= this->text.size()){
+                    this->fail("unexpected end");
+                }
+                value v;
+                char c = this->text[this->pos];
+                if(c == '{'){
+                    v.type = value::OBJECT;
+                    this->pos++;
+                    this->skipWhitespace();
+                    if(this->pos < this->text.size() && this->text[this->pos] == '}'){
+                        this->pos++;
+                        return v;
+                    }
+                    do{
+                        std::string key = this->parseString();
+                        this->expect(':');
+                        v.object[key] = this->parseValue(depth + 1);
+                        this->skipWhitespace();
+                    }while(this->pos < this->text.size() && this->text[this->pos] == ',' && ++this->pos);
+                    this->expect('}');
+                }else if(c == '['){
+                    v.type = value::ARRAY;
+                    this->pos++;
+                    this->skipWhitespace();
+                    if(this->pos < this->text.size() && this->text[this->pos] == ']'){
+                        this->pos++;
+                        return v;
+                    }
+                    do{
+                        v.array.push_back(this->parseValue(depth + 1));
+                        this->skipWhitespace();
+                    }while(this->pos < this->text.size() && this->text[this->pos] == ',' && ++this->pos);
+                    this->expect(']');
+                }else if(c == '"'){
+                    v.type = value::STRING;
+                    v.string = this->parseString();
+                }else if(this->literal("true")){
+                    v.type = value::BOOLEAN;
+                    v.boolean = true;
+                }else if(this->literal("false")){
+                    v.type = value::BOOLEAN;
+                }else if(this->literal("null")){
+                    v.type = value::NUL;
+                }else{
+                    const char* start = this->text.c_str() + this->pos;
+                    char* end;
+                    v.type = value::NUMBER;
+                    v.number = std::strtod(start, &end);
+                    if(end == start){
+                        this->fail("unexpected character");
+                    }
+                    if(!std::isfinite(v.number)){ // strtod takes inf/nan (and overflows to inf), JSON doesnt
+                        this->fail("number out of range");
+                    }
+                    this->pos += end - start;
+                }
+                return v;
+            }
+
+        public:
+            parser(const std::string& text) : text(text){}
+
+            value parse(){
+                value v = this->parseValue(0);
+                this->skipWhitespace();
+                if(this->pos != this->text.size()){
+                    this->fail("trailing characters");
+                }
+                return v;
+            }
+    };
+
+    inline value parse(const std::string& text){
+        return parser(text).parse();
+    }
+
+    /*
+        Helpers for writing replies, they just build up the text directly
+    */
+    inline std::string quote(const std::string& s){
+        std::string out = "\"";
+        for(char c : s){
+            switch(c){
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if((unsigned char)c < 0x20){
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        out += escaped;
+                    }else{
+                        out += c;
+                    }
+            }
+        }
+        return out + "\"";
+    }
+
+    inline std::string number(double x){
+        if(!std::isfinite(x)){
+            return "null"; // JSON has no nan/inf
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", x);
+        return buffer;
+    }
+
+    /*
+        Builds a flat JSON object one field at a time
+    */
+    class objectWriter{
+        private:
+            std::string text = "{";
+
+            void key(const std::string& name){
+                if(this->text.size() > 1){
+                    this->text += ",";
+                }
+                this->text += quote(name) + ":";
+            }
+
+        public:
+            template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+            objectWriter& add(const std::string& name, T x){
+                this->key(name);
+                this->text += number((double)x);
+                return *this;
+            }
+
+            objectWriter& add(const std::string& name, bool x){
+                this->key(name);
+                this->text += x ? "true" : "false";
+                return *this;
+            }
+
+            objectWriter& add(const std::string& name, const std::string& x){
+                this->key(name);
+                this->text += quote(x);
+                return *this;
+            }
+
+            objectWriter& add(const std::string& name, const char* x){
+                return this->add(name, std::string(x));
+            }
+
+            // Value that is already JSON (an array or nested object)
+            objectWriter& addRaw(const std::string& name, const std::string& json){
+                this->key(name);
+                this->text += json;
+                return *this;
+            }
+
+            std::string str() const{
+                return this->text + "}";
+            }
+    };
+
+}
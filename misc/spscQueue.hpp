@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace threading{
+
+    /*
+        Fixed size queue for passing messages from exactly one thread to exactly one other thread without locking
+        push() only ever touches head and pop() only ever touches tail, each side just reads the other one's index,
+        so neither side can block the other. Capacity must be a power of two, one slot is always left empty
+    */
+    template<typename T, size_t capacity>
+    class spscQueue{
+        static_assert((capacity & (capacity - 1)) == 0, "spscQueue capacity must be a power of two");
+
+        private:
+            T items[capacity];
+            alignas(64) std::atomic<size_t> head{0}; // Next slot to write, only changed by the producer
+            alignas(64) std::atomic<size_t> tail{0}; // Next slot to read, only changed by the consumer
+
+        public:
+            // Producer only, returns false if the queue is full
+            bool push(const T& item){
+                size_t h = this->head.load(std::memory_order_relaxed);
+                size_t next = (h + 1) & (capacity - 1);
+                if(next == this->tail.load(std::memory_order_acquire)){
+                    return false;
+                }
+                this->items[h] = item;
+                this->head.store(next, std::memory_order_release);
+                return true;
+            }
+
+            // Consumer only, returns false if there was nothing to take
+            bool pop(T& item){
+                size_t t = this->tail.load(std::memory_order_relaxed);
+                if(t == this->head.load(std::memory_order_acquire)){
+                    return false;
+                }
+                item = this->items[t];
+                this->tail.store((t + 1) & (capacity - 1), std::memory_order_release);
+                return true;
+            }
+
+            bool empty() const{
+                return this->tail.load(std::memory_order_acquire) == this->head.load(std::memory_order_acquire);
+            }
+    };
+
+}
@@ -0,0 +1,86 @@
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "misc/headlessContext.hpp"
+#include "simulation/replay.hpp"
+
+/*
+    Replays a settings journal saved by GLSLSlime (--journal, the Journal section of the UI or the journal control command)
+    without a window and as fast as possible, see simulation/replay.hpp
+
+    Usage: GLSLSlimeReplay <journal> [options]
+        --resolution <n>      replay at this texture size, lengths in texels are scaled to match (default as journalled)
+        --agents <n>          replay with this many agents (default as journalled)
+        --every <n>           export a frame every n steps (default 0 = only the last step of each restart)
+        --segment <n>         only replay the nth restart, 0 = the start of the session (default all of them)
+        --out <prefix>        frames are written to prefix_<n>.<format> (default replayFrame)
+        --format <ext>        frame format (default the same as the UI, see encoding::availableFormats())
+        --region <r>          whole, view (the journalled view) or x,y,w,h in texels (default whole)
+        --size <w>x<h>        exported frame size, 0 for either keeps the aspect of the region (default one pixel per texel)
+*/
+int main(int argc, char** argv){
+    if(argc < 2){
+        std::cout << "Usage: " << argv[0] << " <journal> [--resolution n] [--agents n] [--every n] [--segment n] [--out prefix] [--format ext] [--region whole|view|x,y,w,h] [--size wxh]" << std::endl;
+        return 1;
+    }
+    simulation::replay::options options;
+    for(int i = 2; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--resolution" && hasValue){ options.resolution = std::atoi(argv[++i]); }
+        else if(arg == "--agents" && hasValue){ options.agents = std::atoi(argv[++i]); }
+        else if(arg == "--every" && hasValue){ options.every = std::atoi(argv[++i]); }
+        else if(arg == "--segment" && hasValue){ options.segment = std::atoi(argv[++i]); }
+        else if(arg == "--out" && hasValue){ options.prefix = argv[++i]; }
+        else if(arg == "--format" && hasValue){ options.format = argv[++i]; }
+        else if(arg == "--region" && hasValue){
+            std::string region = argv[++i];
+            if(region == "whole"){
+                options.region = simulation::frameExport::REGION_WHOLE;
+            }else if(region == "view"){
+                options.region = simulation::frameExport::REGION_VIEW;
+            }else if(std::sscanf(region.c_str(), "%f,%f,%f,%f", &options.custom[0], &options.custom[1], &options.custom[2], &options.custom[3]) == 4){
+                options.region = simulation::frameExport::REGION_CUSTOM;
+            }else{
+                std::cout << "--region must be whole, view or x,y,w,h" << std::endl;
+                return 1;
+            }
+        }
+        else if(arg == "--size" && hasValue){
+            if(std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2){
+                std::cout << "--size must be <width>x<height>" << std::endl;
+                return 1;
+            }
+        }
+        else{
+            std::cout << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    glfwInit();
+    auto window = headless::createContext();
+    int result = 0;
+    try{
+        simulation::replay replay(argv[1], options);
+        auto start = std::chrono::steady_clock::now();
+        replay.run();
+        glFinish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << replay.getStepsRun() << " steps in " << seconds << "s (" << replay.getStepsRun() / seconds << " steps/s), "
+                  << replay.getFramesWritten() << " frames written" << std::endl;
+    }catch(const std::exception& e){
+        std::cout << e.what() << std::endl;
+        result = 1;
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+}
@@ -15,6 +15,27 @@ uniform vec3 sensorColour;
 uniform vec3 mainAgentColour;
 uniform vec3 agentYDirectionColour;
 uniform vec3 agentXDirectionColour;
+uniform int domainMode; // 0 = the texture is the whole world and wraps around, 1 = the texture is one subdomain of a distributed run
+uniform ivec4 domainInterior; // Texels [x, z) * [y, w) are owned by this subdomain, everything else is halo (domainMode 1 only)
+uniform int useMaps; // 1 = the obstacle mask and food map below are bound and should be sampled
+uniform float foodAttraction;
+uniform float obstacleAvoidance;
+uniform int filteredSensing; // 1 = sense through senseMap with filtering instead of loading single texels from the image
+uniform float sensorLod; // Level of senseMap to sample, log2 of the sensor footprint in texels
+uniform int useForwardSensor; // 1 = also sense straight ahead, and keep going straight if that is the strongest
+uniform int traceMode; // 0 = off, 1 = every traceStride-th agent from traceFirst, 2 = the agents in tracedAgents
+uniform uint traceFirst;
+uniform uint traceStride;
+uniform uint traceCount; // Agents being traced, so records per step
+uniform uint traceStep; // Step number written into the records
+uniform uint traceRow; // Which step of the trace ring this step writes to
+uniform int useNeighbours; // 1 = neighbourData was filled in by agentGrid.compute.glsl this step
+uniform float repulsion; // How hard agents steer away from their neighbours
+uniform float crowdingLimit; // Above this many neighbours agents deposit proportionally less trail, 0 = no limit
+
+layout(binding = 2) uniform usampler2D obstacleMask; // 1 bit per texel, 32 texels are packed along x into each uint
+layout(binding = 3) uniform sampler2D foodMap;
+layout(binding = 4) uniform sampler2D senseMap; // Trail deposit written by diffuseFade.compute.glsl before this pass, so it never sees this step's deposits
 
 
 layout (std140, binding=2) buffer agentData{
@@ -23,50 +44,171 @@ layout (std140, binding=2) buffer agentData{
     // y = y position
     // z = angle
     // w = unused (i love when shaders force me to use 4 floats because otherwise memory layout goes funky)
+    //     except that negative means the slot is empty (agent has migrated to another subdomain)
+};
+
+// Agents which leave the interior of a subdomain are moved here so the host can pass them on to the neighbouring process
+layout (std430, binding=3) buffer emigrantData{
+    uint emigrantCount;
+    uint emigrantPadding[3];
+    vec4 eData[]; // x, y, angle, slot the agent was removed from
+};
+
+// Sampled agents write what they did each step into a ring of steps, which the host drains (see recording/agentTracer.hpp)
+struct traceRecord{
+    uint step;
+    uint agent; // Top bit set when the slot is empty (agent migrated), the rest of the record is then zero
+    vec2 position;
+    float angle;
+    float leftSensor;
+    float rightSensor;
+    float forwardSensor; // 0 unless useForwardSensor is on
+};
+
+layout (std430, binding=9) writeonly buffer agentTrace{
+    traceRecord traceRing[]; // traceCount records per step, in the same order as the traced agents
+};
+
+layout (std430, binding=10) readonly buffer tracedAgentList{
+    uint tracedAgents[]; // Sorted, traceMode 2 only
+};
+
+layout (std430, binding=15) readonly buffer neighbourData{
+    vec2 neighbours[]; // x = steering away from neighbours, y = neighbours within the radius (see agentGrid.compute.glsl)
 };
 
+// Index of this agent among the traced agents, or -1 if it isnt traced
+int traceIndex(uint agentID){
+    if(traceMode == 1){
+        if(agentID < traceFirst || (agentID - traceFirst) % traceStride != 0u){
+            return -1;
+        }
+        uint index = (agentID - traceFirst) / traceStride;
+        return (index < traceCount)? int(index) : -1;
+    }
+    if(traceMode == 2){
+        uint low = 0u, high = traceCount;
+        while(low < high){
+            uint middle = (low + high) / 2u;
+            if(tracedAgents[middle] < agentID){ low = middle + 1u; }else{ high = middle; }
+        }
+        return (low < traceCount && tracedAgents[low] == agentID)? int(low) : -1;
+    }
+    return -1;
+}
+
+void writeTrace(int index, uint agent, vec3 state, vec3 sensors){
+    traceRing[traceRow * traceCount + uint(index)] = traceRecord(traceStep, agent, state.xy, state.z, sensors.x, sensors.y, sensors.z);
+}
+
 // Loops the position around to the other side of the texture if it goes out of bounds
+// In a subdomain the wrapping is done by the halo exchange instead, so positions are just kept on the texture
 void loopBounds(inout vec2 pos){
+    if(domainMode == 1){
+        pos = clamp(pos, vec2(0.0f), vec2(imageSize(img) - 1));
+        return;
+    }
     if(pos[0] >= size){ pos[0] -= size; }
     if(pos[1] >= size){ pos[1] -= size; }
     if(pos[0] <= 0){ pos[0] += size; }
     if(pos[1] <= 0){ pos[1] += size; }
 }
 
-// Returns the pixel coordinates of a pixel at a certain angle and distance from the agent at agentID
-ivec2 getPixelCoords(float angle, float dist, uint agentID){
+// Returns the location at a certain angle and distance from the agent at agentID
+vec2 getSensorLocation(float angle, float dist, uint agentID){
     vec2 location = vec2(aData[agentID].x, aData[agentID].y) + vec2(cos(angle), sin(angle))*dist;
     loopBounds(location);
-    return ivec2(int(location[0]), int(location[1]));
+    return location;
+}
+
+bool isObstacle(ivec2 coords){
+    uint bits = texelFetch(obstacleMask, ivec2(coords.x >> 5, coords.y), 0).r;
+    return ((bits >> (coords.x & 31)) & 1u) != 0u;
+}
+
+// What a sensor sees at some location, the trail plus whatever the world maps add
+float sense(vec2 location){
+    ivec2 coords = ivec2(location);
+    float value;
+    if(filteredSensing == 1){
+        value = textureLod(senseMap, location / size, sensorLod).r;
+    }else{
+        value = imageLoad(img, coords).w; // Uses alpha channel
+    }
+    if(useMaps == 1){
+        value = isObstacle(coords) ? -obstacleAvoidance : value + texelFetch(foodMap, coords, 0).r*foodAttraction;
+    }
+    return value;
 }
 
 void main(){
     // Get agent variables
     uint agentID = gl_GlobalInvocationID.x;
-    if(agentID >= size*size){
+    if(agentID >= aData.length()){
+        return;
+    }
+    int traced = traceIndex(agentID);
+    if(aData[agentID].w < 0.0f){
+        if(traced >= 0){
+            writeTrace(traced, agentID | 0x80000000u, vec3(0.0f), vec3(0.0f));
+        }
         return;
     }
     
-    ivec2 pixelCoords_left = getPixelCoords(aData[agentID].z+sensorAngle, sensorDistance, agentID);
-    ivec2 pixelCoords_right = getPixelCoords(aData[agentID].z-sensorAngle, sensorDistance, agentID);
-    float leftSensor = imageLoad(img, pixelCoords_left).w; // Uses alpha channel
-    float rightSensor = imageLoad(img, pixelCoords_right).w;
+    vec2 location_left = getSensorLocation(aData[agentID].z+sensorAngle, sensorDistance, agentID);
+    vec2 location_right = getSensorLocation(aData[agentID].z-sensorAngle, sensorDistance, agentID);
+    float leftSensor = sense(location_left);
+    float rightSensor = sense(location_right);
+    float turn = leftSensor*turnSpeed - rightSensor*turnSpeed;
+    vec2 neighbourInfo = (useNeighbours == 1)? neighbours[agentID] : vec2(0.0f);
+    float forwardSensor = 0.0f;
+    if(useForwardSensor == 1){
+        vec2 location_forward = getSensorLocation(aData[agentID].z, sensorDistance, agentID);
+        forwardSensor = sense(location_forward);
+        if(forwardSensor > leftSensor && forwardSensor > rightSensor){
+            turn = 0.0f;
+        }
+        if(drawSensors == 1){
+            imageStore(img, ivec2(location_forward), vec4(sensorColour, forwardSensor));
+        }
+    }
     if(drawSensors == 1){
-        imageStore(img, pixelCoords_left, vec4(sensorColour, leftSensor));
-        imageStore(img, pixelCoords_right, vec4(sensorColour, rightSensor));
+        imageStore(img, ivec2(location_left), vec4(sensorColour, leftSensor));
+        imageStore(img, ivec2(location_right), vec4(sensorColour, rightSensor));
     }
 
+    turn += neighbourInfo.x * repulsion;
+
     // Update angle of agent
-    aData[agentID].z += leftSensor*turnSpeed - rightSensor*turnSpeed;
+    aData[agentID].z += turn;
     aData[agentID].z = mod(aData[agentID].z, 6.28318530718f); // Ensure angle doesnt go up and up until floating point errors cause problems
 
     // Update location of agent
     vec2 direction = vec2(cos(aData[agentID].z), sin(aData[agentID].z))*speed;
     vec2 newpos = vec2(aData[agentID].x, aData[agentID].y) + (direction);
+    if(domainMode == 1 && (newpos.x < domainInterior.x || newpos.y < domainInterior.y || newpos.x >= domainInterior.z || newpos.y >= domainInterior.w)){
+        uint index = atomicAdd(emigrantCount, 1);
+        if(index < eData.length()){
+            eData[index] = vec4(newpos, aData[agentID].z, float(agentID));
+            aData[agentID].w = -1.0f;
+            if(traced >= 0){
+                writeTrace(traced, agentID | 0x80000000u, vec3(0.0f), vec3(0.0f));
+            }
+            return;
+        }
+        newpos = clamp(newpos, vec2(domainInterior.xy), vec2(domainInterior.zw) - 0.001f); // No room to migrate this step, so stay put
+    }
     loopBounds(newpos);
+    if(useMaps == 1 && isObstacle(ivec2(newpos))){ // Bounce off obstacles by turning around and staying put for this step
+        newpos = aData[agentID].xy;
+        aData[agentID].z = mod(aData[agentID].z + 3.14159265359f, 6.28318530718f);
+    }
 
     // Set agent position
     aData[agentID].xy = newpos;
+    if(traced >= 0){
+        writeTrace(traced, agentID, vec3(newpos, aData[agentID].z), vec3(leftSensor, rightSensor, forwardSensor));
+    }
 
     // Draw a pixel at the agents location
     vec3 colour = ((((direction.x/speed)+1)*agentXDirectionColour + // Multiply the X direction by the X direction colour
@@ -74,5 +216,6 @@ void main(){
                   mainAgentColour)) // Add in the "main" agent colour to the mix 
                   /1.5f;
 
-    imageStore(img, ivec2(int(aData[agentID].x), int(aData[agentID].y)), vec4(colour, 1.0f));
+    float deposit = (crowdingLimit > 0.0f && neighbourInfo.y > crowdingLimit)? crowdingLimit / neighbourInfo.y : 1.0f;
+    imageStore(img, ivec2(int(aData[agentID].x), int(aData[agentID].y)), vec4(colour, deposit));
 }
@@ -0,0 +1,159 @@
+#version 460 core
+
+// Uniform grid of agents for finding neighbours, rebuilt before every agent pass by a counting sort (see agentGrid.hpp)
+//     pass 0: every agent counts itself into its cell, the count it got back is its slot within the cell
+//     pass 1: each group turns GROUP_SIZE cell counts into an exclusive prefix sum, and writes its total to blockSums
+//     pass 2: a single group turns blockSums into an exclusive prefix sum
+//     pass 3: each group adds its block's offset, cellStart[c] is now the first sorted agent of cell c and cellStart[c+1] the end
+//     pass 4: every agent copies itself to cellStart[cell] + slot, so agents in the same cell are next to each other
+//     pass 5: every sorted agent looks through the 3x3 cells around it and writes what its neighbours are doing to neighbourData
+// The query walks the sorted copy rather than the agent buffer, so neighbouring invocations read neighbouring memory
+
+#define GROUP_SIZE 256
+
+layout(local_size_x = GROUP_SIZE) in;
+
+uniform int pass;
+uniform uint agentCount;
+uniform uint cellCount; // cellsPerAxis^2, the cell buffers have one more entry for the end of the last cell
+uniform int cellsPerAxis;
+uniform float cellSize; // Texels, never less than radius so the 3x3 cells cover every neighbour
+uniform float size; // Of the (wrapping) world in texels
+uniform float radius;
+uniform uint maxChecks; // Candidates looked at per agent before giving up, so crowded cells cant blow up the cost
+
+layout (std140, binding=0) readonly buffer agentData{
+    vec4 aData[]; // Same layout as agent.compute.glsl, negative w means the slot is empty
+};
+
+layout (std430, binding=11) buffer gridCells{
+    uint cellStart[];
+};
+
+layout (std430, binding=12) buffer gridBlockSums{
+    uint blockSums[];
+};
+
+layout (std430, binding=13) buffer gridAgentSlots{
+    uint agentSlot[]; // Position within its cell, or 0xFFFFFFFF for empty slots
+};
+
+layout (std430, binding=14) buffer gridSortedAgents{
+    vec4 sortedAgents[]; // x, y, angle, agent index (as uint bits)
+};
+
+layout (std430, binding=15) writeonly buffer neighbourData{
+    vec2 neighbours[]; // Per agent: x = steering away from neighbours (+ is to the left), y = neighbours within radius
+};
+
+shared uint scan[GROUP_SIZE];
+
+uint cellOf(vec2 position){
+    ivec2 cell = clamp(ivec2(position / cellSize), ivec2(0), ivec2(cellsPerAxis - 1));
+    return uint(cell.y * cellsPerAxis + cell.x);
+}
+
+// Exclusive prefix sum of value across the group, returns this invocation's part and leaves the group total in scan[GROUP_SIZE-1]
+uint groupScan(uint value){
+    uint local = gl_LocalInvocationID.x;
+    scan[local] = value;
+    barrier();
+    for(uint offset = 1u; offset < GROUP_SIZE; offset *= 2u){
+        uint add = (local >= offset)? scan[local - offset] : 0u;
+        barrier();
+        scan[local] += add;
+        barrier();
+    }
+    return scan[local] - value;
+}
+
+void main(){
+    uint id = gl_GlobalInvocationID.x;
+
+    if(pass == 0){
+        if(id >= agentCount){
+            return;
+        }
+        vec4 agent = aData[id];
+        agentSlot[id] = (agent.w < 0.0f)? 0xFFFFFFFFu : atomicAdd(cellStart[cellOf(agent.xy)], 1u);
+        return;
+    }
+
+    if(pass == 1){
+        uint value = (id <= cellCount)? cellStart[id] : 0u;
+        uint exclusive = groupScan(value);
+        if(id <= cellCount){
+            cellStart[id] = exclusive;
+        }
+        if(gl_LocalInvocationID.x == GROUP_SIZE - 1u){
+            blockSums[gl_WorkGroupID.x] = scan[GROUP_SIZE - 1u];
+        }
+        return;
+    }
+
+    if(pass == 2){ // One group, walks through the block sums GROUP_SIZE at a time
+        uint blocks = (cellCount + GROUP_SIZE) / GROUP_SIZE; // cellCount + 1 entries
+        uint carry = 0u;
+        for(uint first = 0u; first < blocks; first += GROUP_SIZE){
+            uint index = first + gl_LocalInvocationID.x;
+            uint value = (index < blocks)? blockSums[index] : 0u;
+            uint exclusive = groupScan(value);
+            if(index < blocks){
+                blockSums[index] = carry + exclusive;
+            }
+            carry += scan[GROUP_SIZE - 1u];
+            barrier(); // Everyone has read the total before the next chunk overwrites it
+        }
+        return;
+    }
+
+    if(pass == 3){
+        if(id <= cellCount){
+            cellStart[id] += blockSums[gl_WorkGroupID.x];
+        }
+        return;
+    }
+
+    if(pass == 4){
+        if(id >= agentCount || agentSlot[id] == 0xFFFFFFFFu){
+            return;
+        }
+        vec4 agent = aData[id];
+        sortedAgents[cellStart[cellOf(agent.xy)] + agentSlot[id]] = vec4(agent.xyz, uintBitsToFloat(id));
+        return;
+    }
+
+    // pass 5
+    if(id >= cellStart[cellCount]){ // Number of agents that are actually in the grid
+        return;
+    }
+    vec4 self = sortedAgents[id];
+    ivec2 home = clamp(ivec2(self.xy / cellSize), ivec2(0), ivec2(cellsPerAxis - 1));
+    int span = min(cellsPerAxis, 3); // Small grids would visit the same cell twice otherwise
+    int first = (span == 3)? -1 : 0;
+    vec2 push = vec2(0.0f);
+    float found = 0.0f;
+    uint checked = 0u;
+    for(int dy = first; dy < first + span; dy++){
+        for(int dx = first; dx < first + span; dx++){
+            ivec2 cell = (home + ivec2(dx, dy) + cellsPerAxis) % cellsPerAxis;
+            uint c = uint(cell.y * cellsPerAxis + cell.x);
+            uint end = cellStart[c + 1u];
+            for(uint j = cellStart[c]; j < end && checked < maxChecks; j++){
+                checked++;
+                vec4 other = sortedAgents[j];
+                vec2 d = other.xy - self.xy;
+                d -= size * round(d / size); // Closest way round the wrapping world
+                float distance = length(d);
+                if(j == id || distance >= radius || distance <= 0.0f){
+                    continue;
+                }
+                push -= (d / distance) * (1.0f - distance / radius);
+                found += 1.0f;
+            }
+        }
+    }
+    vec2 heading = vec2(cos(self.z), sin(self.z));
+    float steer = heading.x * push.y - heading.y * push.x;
+    neighbours[floatBitsToUint(self.w)] = vec2(steer, found);
+}
@@ -8,6 +8,14 @@ layout(rgba32f, binding = 0) uniform image2D img;
 uniform float diffuse;
 uniform float fade;
 uniform int size;
+uniform int useMaps; // 1 = the obstacle mask and food map below are bound
+uniform float foodDeposit; // Trail added every step per unit of food
+uniform int writeSenseMap; // 1 = also copy the deposit into senseMap for the agents to sample (filtered sensing)
+
+layout(r16f, binding = 1) uniform writeonly image2D senseMap;
+
+layout(binding = 2) uniform usampler2D obstacleMask; // Same packing as in agent.compute.glsl
+layout(binding = 3) uniform sampler2D foodMap;
 
 shared vec4 block[GROUP_SIZE+2][GROUP_SIZE+2];
 
@@ -62,6 +70,19 @@ void main(){
     float new = diffuse;
     newPixel = (imageLoad(img, pixel_coords)*original + newPixel*new);
 
+    // Obstacles soak up any trail that diffuses into them, food keeps topping the trail up
+    if(useMaps == 1){
+        uint bits = texelFetch(obstacleMask, ivec2(pixel_coords.x >> 5, pixel_coords.y), 0).r;
+        if(((bits >> (pixel_coords.x & 31)) & 1u) != 0u){
+            newPixel = vec4(0.0f);
+        }else{
+            newPixel.w += texelFetch(foodMap, pixel_coords, 0).r*foodDeposit;
+        }
+    }
+
     // Store new pixel value back into image
     imageStore(img, pixel_coords, newPixel);
+    if(writeSenseMap == 1){
+        imageStore(senseMap, pixel_coords, vec4(newPixel.w));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 460
+
+// Builds one level of the display pyramid: every output texel is the average of the 2x2 texels below it
+// The source is either the full resolution simulation texture or the previous (RGBA8) level of the pyramid
+
+#define GROUP_SIZE 8
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+layout(rgba8, binding = 7) uniform writeonly image2D destination;
+
+uniform sampler2D source;
+uniform int sourceLevel;
+
+void main(){
+    ivec2 pixel_coords = ivec2(gl_GlobalInvocationID.xy);
+    if(any(greaterThanEqual(pixel_coords, imageSize(destination)))){
+        return;
+    }
+    ivec2 sourceCoords = pixel_coords * 2;
+    vec4 sum = texelFetch(source, sourceCoords, sourceLevel);
+    sum += texelFetch(source, sourceCoords + ivec2(1, 0), sourceLevel);
+    sum += texelFetch(source, sourceCoords + ivec2(0, 1), sourceLevel);
+    sum += texelFetch(source, sourceCoords + ivec2(1, 1), sourceLevel);
+    imageStore(destination, pixel_coords, clamp(sum * 0.25f, 0.0f, 1.0f));
+}
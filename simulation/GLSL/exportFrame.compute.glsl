@@ -0,0 +1,52 @@
+#version 460 core
+
+// Crops the simulation texture and scales it to the size of the exported frame, writing 8 bit colour (or half floats
+// for frames published to shared memory, see framePublisher.hpp) so only the pixels that end up being used are read back
+// Every output pixel averages a grid of samples spread over the texels it covers (nearest texel when scaling up)
+
+#define GROUP_SIZE 16
+#define MAX_TAPS 16 // Per axis, past this the samples are spread out rather than covering every texel
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+layout(binding = 7) uniform writeonly image2D destination; // No format, so it can be RGBA8 or RGBA16F
+
+uniform sampler2D source;
+uniform vec2 cropOrigin; // In texels, can be outside the texture
+uniform vec2 cropSize;
+uniform int repeat; // 1 = wrap around outside the texture like the display does, 0 = black
+uniform int clampOutput; // 1 for 8 bit destinations, half floats keep deposits above 1
+
+vec4 fetch(vec2 position){
+    ivec2 size = textureSize(source, 0);
+    if(repeat == 1){
+        position = mod(position, vec2(size)); // Not %, that is undefined for negative numbers
+    }
+    ivec2 texel = ivec2(floor(position));
+    if(repeat == 1){
+        texel = min(texel, size - 1); // mod can round up to exactly size
+    }
+    if(any(lessThan(texel, ivec2(0))) || any(greaterThanEqual(texel, size))){
+        return vec4(0.0f);
+    }
+    return texelFetch(source, texel, 0);
+}
+
+void main(){
+    ivec2 pixel_coords = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 outputSize = imageSize(destination);
+    if(any(greaterThanEqual(pixel_coords, outputSize))){
+        return;
+    }
+    vec2 footprint = cropSize / vec2(outputSize);
+    vec2 start = cropOrigin + vec2(pixel_coords) * footprint;
+    ivec2 taps = clamp(ivec2(ceil(footprint)), ivec2(1), ivec2(MAX_TAPS));
+    vec2 spacing = footprint / vec2(taps);
+    vec4 sum = vec4(0.0f);
+    for(int y = 0; y < taps.y; y++){
+        for(int x = 0; x < taps.x; x++){
+            sum += fetch(start + (vec2(x, y) + 0.5f) * spacing);
+        }
+    }
+    vec4 colour = sum / float(taps.x * taps.y);
+    imageStore(destination, pixel_coords, (clampOutput == 1)? clamp(colour, 0.0f, 1.0f) : colour);
+}
@@ -3,7 +3,13 @@ out vec4 FragColor;
 in vec2 v_texCoord;
 
 uniform sampler2D textureSampler;
+uniform sampler2D pyramidSampler; // RGBA8 downsampled copy of textureSampler, level 0 is half resolution
+uniform int displayLevel; // 0 = full resolution, n = pyramid level n-1
 
 void main(){
-    FragColor = texture(textureSampler, v_texCoord);
+    if(displayLevel == 0){
+        FragColor = texture(textureSampler, v_texCoord);
+    }else{
+        FragColor = textureLod(pyramidSampler, v_texCoord, float(displayLevel - 1));
+    }
 }
@@ -0,0 +1,41 @@
+#version 460
+
+// Packs the deposit channel of the trail texture into 16 bit values for the trail recorder, two texels per uint
+// Texels are taken in row order, so texel i ends up in the low half of packedTexels[i/2] when i is even and the high half when it is odd
+
+#define GROUP_SIZE 256
+
+layout(local_size_x = GROUP_SIZE) in;
+layout(rgba32f, binding = 0) uniform readonly image2D img;
+
+uniform int size;
+uniform float maxDeposit; // Maps to 65535, anything above is clipped
+
+layout (std430, binding=8) buffer quantizedTrail{
+    uint clippedTexels; // How many texels were above maxDeposit, so the scale can be fixed for the next recording
+    uint packedTexels[];
+};
+
+uint quantize(uint texel, inout uint clipped){
+    ivec2 coords = ivec2(texel % uint(size), texel / uint(size));
+    float deposit = imageLoad(img, coords).w / maxDeposit;
+    if(deposit > 1.0f){
+        clipped++;
+    }
+    return uint(round(clamp(deposit, 0.0f, 1.0f) * 65535.0f));
+}
+
+void main(){
+    uint texelCount = uint(size) * uint(size);
+    uint first = gl_GlobalInvocationID.x * 2u;
+    if(first >= texelCount){
+        return;
+    }
+    uint clipped = 0u;
+    uint low = quantize(first, clipped);
+    uint high = (first + 1u < texelCount)? quantize(first + 1u, clipped) : 0u;
+    packedTexels[gl_GlobalInvocationID.x] = low | (high << 16);
+    if(clipped != 0u){
+        atomicAdd(clippedTexels, clipped);
+    }
+}
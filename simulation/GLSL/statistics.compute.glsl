@@ -0,0 +1,155 @@
+#version 460
+
+// Reduces the trail texture and agent buffer down to a handful of statistics, in three passes:
+//     pass 0: every work group sums up a 64x64 block of the texture (deposit, coverage, histogram)
+//     pass 1: every work group sums up GROUP_SIZE agents (heading, deposit under the agents)
+//     pass 2: a single work group adds up the partial sums from the first two passes
+// Counts are done with integer atomics, float sums go through the partials buffer so the result is deterministic
+
+#define GROUP_SIZE 256
+#define GROUP_WIDTH 16
+#define BLOCKS_PER_GROUP 4 // Each work group covers (GROUP_WIDTH*BLOCKS_PER_GROUP)^2 texels
+#define HISTOGRAM_BINS 16
+
+layout(local_size_x = GROUP_SIZE) in;
+layout(rgba32f, binding = 0) uniform readonly image2D img;
+
+uniform int pass;
+uniform int size;
+uniform float coverageThreshold; // Texels with more deposit than this count as covered
+uniform float histogramMax; // Deposit values are binned over [0, histogramMax], anything above goes in the last bin
+uniform uint agentPartialOffset; // Where the agent partials start in the partials buffer
+uniform uint trailGroups;
+uniform uint agentGroups;
+
+layout (std140, binding=2) readonly buffer agentData{
+    vec4 aData[]; // x, y, angle, unused (negative = empty slot)
+};
+
+layout (std430, binding=6) buffer statisticsResult{
+    uint texelCount;
+    uint coveredTexels;
+    uint agentCount;
+    uint agentsOnTrail;
+    float totalDeposit;
+    float headingX; // Sum of the agents' unit direction vectors
+    float headingY;
+    float depositUnderAgents; // Sum of the deposit at every agent's position
+    uint histogram[HISTOGRAM_BINS];
+};
+
+layout (std430, binding=7) buffer statisticsPartials{
+    vec4 partials[];
+};
+
+shared vec4 sums[GROUP_SIZE];
+shared uint localCounts[HISTOGRAM_BINS + 2]; // Histogram, then the two counters for the current pass
+
+void reduce(uint local){
+    barrier();
+    for(uint stride = GROUP_SIZE/2; stride > 0; stride /= 2){
+        if(local < stride){
+            sums[local] += sums[local + stride];
+        }
+        barrier();
+    }
+}
+
+void trailPass(uint local){
+    uint groupsX = (size + GROUP_WIDTH*BLOCKS_PER_GROUP - 1) / (GROUP_WIDTH*BLOCKS_PER_GROUP);
+    uint group = gl_WorkGroupID.x;
+    ivec2 groupOrigin = ivec2(group % groupsX, group / groupsX) * GROUP_WIDTH * BLOCKS_PER_GROUP;
+    ivec2 thread = ivec2(local % GROUP_WIDTH, local / GROUP_WIDTH);
+
+    float sum = 0.0f;
+    uint covered = 0;
+    uint counted = 0;
+    for(int by = 0; by < BLOCKS_PER_GROUP; by++){
+        for(int bx = 0; bx < BLOCKS_PER_GROUP; bx++){
+            ivec2 coords = groupOrigin + ivec2(bx, by)*GROUP_WIDTH + thread; // Neighbouring threads read neighbouring texels
+            if(coords.x >= size || coords.y >= size){
+                continue;
+            }
+            float deposit = imageLoad(img, coords).w;
+            sum += deposit;
+            covered += (deposit > coverageThreshold)? 1 : 0;
+            counted++;
+            int bin = clamp(int(deposit / histogramMax * HISTOGRAM_BINS), 0, HISTOGRAM_BINS - 1);
+            atomicAdd(localCounts[bin], 1);
+        }
+    }
+    atomicAdd(localCounts[HISTOGRAM_BINS], covered);
+    atomicAdd(localCounts[HISTOGRAM_BINS + 1], counted);
+    sums[local] = vec4(sum, 0.0f, 0.0f, 0.0f);
+    reduce(local);
+
+    if(local == 0){
+        partials[group] = sums[0];
+        atomicAdd(coveredTexels, localCounts[HISTOGRAM_BINS]);
+        atomicAdd(texelCount, localCounts[HISTOGRAM_BINS + 1]);
+    }
+    if(local < HISTOGRAM_BINS){
+        atomicAdd(histogram[local], localCounts[local]);
+    }
+}
+
+void agentPass(uint local){
+    uint agentID = gl_GlobalInvocationID.x;
+    vec4 contribution = vec4(0.0f);
+    if(agentID < aData.length() && aData[agentID].w >= 0.0f){
+        vec4 agent = aData[agentID];
+        float deposit = imageLoad(img, ivec2(agent.xy)).w;
+        contribution = vec4(cos(agent.z), sin(agent.z), deposit, 0.0f);
+        atomicAdd(localCounts[HISTOGRAM_BINS], 1);
+        atomicAdd(localCounts[HISTOGRAM_BINS + 1], (deposit > coverageThreshold)? 1 : 0);
+    }
+    sums[local] = contribution;
+    reduce(local);
+
+    if(local == 0){
+        partials[agentPartialOffset + gl_WorkGroupID.x] = sums[0];
+        atomicAdd(agentCount, localCounts[HISTOGRAM_BINS]);
+        atomicAdd(agentsOnTrail, localCounts[HISTOGRAM_BINS + 1]);
+    }
+}
+
+void finalPass(uint local){
+    vec4 trail = vec4(0.0f);
+    for(uint i = local; i < trailGroups; i += GROUP_SIZE){
+        trail += partials[i];
+    }
+    sums[local] = trail;
+    reduce(local);
+    if(local == 0){
+        totalDeposit = sums[0].x;
+    }
+    barrier();
+
+    vec4 agents = vec4(0.0f);
+    for(uint i = local; i < agentGroups; i += GROUP_SIZE){
+        agents += partials[agentPartialOffset + i];
+    }
+    sums[local] = agents;
+    reduce(local);
+    if(local == 0){
+        headingX = sums[0].x;
+        headingY = sums[0].y;
+        depositUnderAgents = sums[0].z;
+    }
+}
+
+void main(){
+    uint local = gl_LocalInvocationIndex;
+    if(local < HISTOGRAM_BINS + 2){
+        localCounts[local] = 0;
+    }
+    barrier();
+
+    if(pass == 0){
+        trailPass(local);
+    }else if(pass == 1){
+        agentPass(local);
+    }else{
+        finalPass(local);
+    }
+}
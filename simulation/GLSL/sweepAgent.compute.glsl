@@ -0,0 +1,84 @@
+#version 460 core
+
+// Same as agent.compute.glsl, but every agent belongs to one of many independent simulations (one per layer of img)
+// and the settings come from that simulation's parameter record instead of uniforms
+
+#define GROUP_SIZE 1024
+
+layout(local_size_x = GROUP_SIZE) in;
+layout(rgba32f, binding = 0) uniform image2DArray img;
+
+uniform int size;
+uniform vec3 mainAgentColour;
+uniform vec3 agentYDirectionColour;
+uniform vec3 agentXDirectionColour;
+
+layout (std140, binding=2) buffer agentData{
+    vec4 aData[]; // Agent Data
+    // x = x position
+    // y = y position
+    // z = angle
+    // w = which instance (layer) the agent belongs to
+};
+
+struct instanceParameters{
+    float sensorDistance;
+    float sensorAngle;
+    float turnSpeed;
+    float speed;
+    float diffuse;
+    float fade;
+    float padding[2];
+};
+
+layout (std430, binding=4) readonly buffer parameterData{
+    instanceParameters params[];
+};
+
+// Loops the position around to the other side of the texture if it goes out of bounds
+void loopBounds(inout vec2 pos){
+    if(pos[0] >= size){ pos[0] -= size; }
+    if(pos[1] >= size){ pos[1] -= size; }
+    if(pos[0] <= 0){ pos[0] += size; }
+    if(pos[1] <= 0){ pos[1] += size; }
+}
+
+// Returns the pixel coordinates of a pixel at a certain angle and distance from the agent at agentID
+ivec3 getPixelCoords(float angle, float dist, uint agentID, int layer){
+    vec2 location = vec2(aData[agentID].x, aData[agentID].y) + vec2(cos(angle), sin(angle))*dist;
+    loopBounds(location);
+    return ivec3(int(location[0]), int(location[1]), layer);
+}
+
+void main(){
+    // Get agent variables
+    uint agentID = gl_GlobalInvocationID.x;
+    if(agentID >= aData.length()){
+        return;
+    }
+    int layer = int(aData[agentID].w);
+    instanceParameters p = params[layer];
+
+    ivec3 pixelCoords_left = getPixelCoords(aData[agentID].z+p.sensorAngle, p.sensorDistance, agentID, layer);
+    ivec3 pixelCoords_right = getPixelCoords(aData[agentID].z-p.sensorAngle, p.sensorDistance, agentID, layer);
+    float leftSensor = imageLoad(img, pixelCoords_left).w; // Uses alpha channel
+    float rightSensor = imageLoad(img, pixelCoords_right).w;
+
+    // Update angle of agent
+    aData[agentID].z += leftSensor*p.turnSpeed - rightSensor*p.turnSpeed;
+    aData[agentID].z = mod(aData[agentID].z, 6.28318530718f);
+
+    // Update location of agent
+    vec2 direction = vec2(cos(aData[agentID].z), sin(aData[agentID].z))*p.speed;
+    vec2 newpos = vec2(aData[agentID].x, aData[agentID].y) + (direction);
+    loopBounds(newpos);
+    aData[agentID].xy = newpos;
+
+    // Draw a pixel at the agents location
+    vec3 colour = ((((direction.x/p.speed)+1)*agentXDirectionColour +
+                  (((direction.y/p.speed)+1)*agentYDirectionColour) +
+                  mainAgentColour))
+                  /1.5f;
+
+    imageStore(img, ivec3(int(aData[agentID].x), int(aData[agentID].y), layer), vec4(colour, 1.0f));
+}
@@ -0,0 +1,70 @@
+#version 460
+
+// Same as diffuseFade.compute.glsl, but for every layer of a texture array at once (z work group = layer)
+// with the diffuse/fade settings taken from that layer's parameter record
+
+#define GROUP_SIZE 32
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+layout(rgba32f, binding = 0) uniform image2DArray img;
+
+struct instanceParameters{
+    float sensorDistance;
+    float sensorAngle;
+    float turnSpeed;
+    float speed;
+    float diffuse;
+    float fade;
+    float padding[2];
+};
+
+layout (std430, binding=4) readonly buffer parameterData{
+    instanceParameters params[];
+};
+
+shared vec4 block[GROUP_SIZE+2][GROUP_SIZE+2];
+
+vec4 load(ivec2 coords, int layer){
+    return imageLoad(img, ivec3(coords, layer));
+}
+
+void main(){
+    ivec2 pixel_coords = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 local_coords = ivec2(gl_LocalInvocationID.xy);
+    int layer = int(gl_WorkGroupID.z);
+
+    // Load block of pixels into shared memory
+    block[local_coords.x+1][local_coords.y+1] = load(pixel_coords, layer);
+
+    // If at edge of local work group, load the edge pixels into shared memory
+    if (local_coords.x == 0) {
+        block[0][local_coords.y+1] = load(pixel_coords + ivec2(-1,0), layer);
+    }
+    if (local_coords.x == GROUP_SIZE-1) {
+        block[GROUP_SIZE+1][local_coords.y+1] = load(pixel_coords + ivec2(1,0), layer);
+    }
+    if (local_coords.y == 0) {
+        block[local_coords.x+1][0] = load(pixel_coords + ivec2(0,-1), layer);
+    }
+    if (local_coords.y == GROUP_SIZE-1) {
+        block[local_coords.x+1][GROUP_SIZE+1] = load(pixel_coords + ivec2(0,1), layer);
+    }
+
+    // Synchronize threads to ensure all pixels are loaded into shared memory
+    barrier();
+
+    // Average of current pixel and its 4 neighbours (corners arent needed for the 5 point stencil)
+    vec4 newPixel = vec4(0.0f);
+    newPixel += block[local_coords.x+1][local_coords.y+1];
+    newPixel += block[local_coords.x+1+1][local_coords.y+1];
+    newPixel += block[local_coords.x+1-1][local_coords.y+1];
+    newPixel += block[local_coords.x+1][local_coords.y+1+1];
+    newPixel += block[local_coords.x+1][local_coords.y+1-1];
+    newPixel /= 5.0f;
+
+    float original = 1.0f - params[layer].diffuse - params[layer].fade;
+    float new = params[layer].diffuse;
+    newPixel = (block[local_coords.x+1][local_coords.y+1]*original + newPixel*new);
+
+    imageStore(img, ivec3(pixel_coords, layer), newPixel);
+}
@@ -0,0 +1,38 @@
+#version 460
+
+// Per work group partial sums of the deposit (alpha) channel for every layer of the sweep texture array
+// The host adds up the partials, which is cheap since there are only (size/GROUP_SIZE)^2 per layer
+
+#define GROUP_SIZE 32
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+layout(rgba32f, binding = 0) uniform readonly image2DArray img;
+
+uniform float coverageThreshold;
+
+layout (std430, binding=5) writeonly buffer metricData{
+    vec2 partials[]; // x = summed deposit, y = number of texels above coverageThreshold, [layer][group]
+};
+
+shared vec2 sums[GROUP_SIZE*GROUP_SIZE];
+
+void main(){
+    uint local = gl_LocalInvocationIndex;
+    float deposit = imageLoad(img, ivec3(gl_GlobalInvocationID.xy, gl_WorkGroupID.z)).w;
+    sums[local] = vec2(deposit, (deposit > coverageThreshold)? 1.0f : 0.0f);
+    barrier();
+
+    // Tree reduction in shared memory
+    for(uint stride = (GROUP_SIZE*GROUP_SIZE)/2; stride > 0; stride /= 2){
+        if(local < stride){
+            sums[local] += sums[local + stride];
+        }
+        barrier();
+    }
+
+    if(local == 0){
+        uint groupsPerLayer = gl_NumWorkGroups.x * gl_NumWorkGroups.y;
+        uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+        partials[gl_WorkGroupID.z * groupsPerLayer + group] = sums[0];
+    }
+}
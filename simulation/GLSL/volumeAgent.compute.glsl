@@ -0,0 +1,121 @@
+#version 460 core
+
+// Agents for the 3D mode, they sense in a cone (straight ahead plus four sensors around it), turn towards the strongest
+// and deposit into the brick-sparse trail volume (see volumeDiffuse.compute.glsl for the layout)
+
+#define GROUP_SIZE 256
+#define BRICK 8
+#define BRICK_VOXELS 512
+
+layout(local_size_x = GROUP_SIZE) in;
+
+uniform int size; // Voxels along each axis, a multiple of BRICK
+uniform float sensorDistance;
+uniform float sensorAngle; // Angle between the forward sensor and the ring of sensors around it
+uniform float turnSpeed;
+uniform float speed;
+uniform uint frame; // Seeds the random roll of the sensor ring
+
+struct agent{
+    vec4 position; // xyz, w unused
+    vec4 direction; // xyz (unit length), w unused
+};
+
+layout (std430, binding=0) buffer volumeAgents{
+    agent agents[];
+};
+
+layout (std430, binding=1) buffer brickTable{
+    uint table[]; // Per brick of the volume, pool slot + 1, or 0 when the brick isnt allocated
+};
+
+layout (std430, binding=2) buffer brickPoolCurrent{
+    float pool[]; // BRICK_VOXELS floats per slot, x fastest
+};
+
+layout (std430, binding=7) buffer brickInfo{
+    uvec2 info[]; // Per brick, x = something wants it allocated, y = largest value after the last diffuse (float bits)
+};
+
+uint hash(uint x){
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+ivec3 wrap(vec3 position){
+    return ivec3(mod(floor(position), float(size)));
+}
+
+uint brickIndex(ivec3 voxel){
+    int bricks = size / BRICK;
+    ivec3 b = voxel / BRICK;
+    return uint(b.x + bricks * (b.y + bricks * b.z));
+}
+
+uint voxelOffset(ivec3 voxel){
+    ivec3 l = voxel % BRICK;
+    return uint(l.x + BRICK * (l.y + BRICK * l.z));
+}
+
+float sense(vec3 position){
+    ivec3 voxel = wrap(position);
+    uint entry = table[brickIndex(voxel)];
+    return (entry == 0u)? 0.0f : pool[(entry - 1u) * BRICK_VOXELS + voxelOffset(voxel)];
+}
+
+void main(){
+    uint agentID = gl_GlobalInvocationID.x;
+    if(agentID >= agents.length()){
+        return;
+    }
+    vec3 position = agents[agentID].position.xyz;
+    vec3 forward = agents[agentID].direction.xyz;
+
+    // Two directions at right angles to forward, rolled by a random angle every step so the ring has no favourite axes
+    vec3 helper = (abs(forward.y) < 0.99f)? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f);
+    vec3 u = normalize(cross(forward, helper));
+    vec3 v = cross(forward, u);
+    float roll = float(hash(agentID ^ hash(frame)) & 0xFFFFu) / 65535.0f * 6.28318530718f;
+    vec3 side = cos(roll)*u + sin(roll)*v;
+    vec3 up = cos(roll)*v - sin(roll)*u;
+
+    float c = cos(sensorAngle);
+    float s = sin(sensorAngle);
+    float ahead = sense(position + forward*sensorDistance);
+    float left = sense(position + (forward*c + side*s)*sensorDistance);
+    float right = sense(position + (forward*c - side*s)*sensorDistance);
+    float above = sense(position + (forward*c + up*s)*sensorDistance);
+    float below = sense(position + (forward*c - up*s)*sensorDistance);
+
+    // Same turning rule as the 2D agents along both axes of the ring, unless straight ahead is the strongest
+    vec2 turn = vec2(left - right, above - below) * turnSpeed;
+    if(ahead > max(max(left, right), max(above, below))){
+        turn = vec2(0.0f);
+    }
+    float angle = length(turn);
+    if(angle > 0.0f){
+        vec3 axis = (side*turn.x + up*turn.y) / angle;
+        forward = normalize(forward*cos(angle) + axis*sin(angle));
+    }
+
+    position = mod(position + forward*speed, float(size));
+    agents[agentID].position.xyz = position;
+    agents[agentID].direction.xyz = forward;
+
+    // Deposit, if the brick isnt there yet it gets allocated before the next step
+    ivec3 voxel = wrap(position);
+    uint brick = brickIndex(voxel);
+    uint entry = table[brick];
+    if(entry != 0u){
+        pool[(entry - 1u) * BRICK_VOXELS + voxelOffset(voxel)] = 1.0f;
+    }
+    info[brick].x = 1u;
+    uint next = brickIndex(wrap(position + forward*speed)); // Where the next deposit will be, so it is ready in time
+    if(next != brick){
+        info[next].x = 1u;
+    }
+}
@@ -0,0 +1,80 @@
+#version 460 core
+
+// Allocates and frees the bricks of the 3D trail volume after every step, one invocation per brick of the volume
+//     pass 0: bricks that nothing asked for and whose trail has faded below releaseThreshold go back on the free list
+//     pass 1: bricks that were asked for get a slot from the free list (and are cleared), then every allocated brick
+//             is added to activeList for the next diffuse dispatch, and the requests are reset
+// Freeing and allocating are separate passes so the free list is only ever pushed to or popped from within one pass
+
+#define GROUP_SIZE 256
+#define BRICK_VOXELS 512
+
+layout(local_size_x = GROUP_SIZE) in;
+
+uniform int pass;
+uniform uint brickCount; // Bricks in the whole volume
+uniform float releaseThreshold;
+
+layout (std430, binding=1) buffer brickTable{
+    uint table[];
+};
+
+layout (std430, binding=2) buffer brickPoolCurrent{
+    float pool[];
+};
+
+layout (std430, binding=4) buffer brickState{
+    uint dispatchX; // Indirect dispatch arguments for volumeDiffuse.compute.glsl, x is the number of allocated bricks
+    uint dispatchY;
+    uint dispatchZ;
+    int freeCount; // Slots on the free list
+    uint overflow; // Set when a brick couldnt be allocated because the pool was full, the host then grows the pool
+};
+
+layout (std430, binding=5) buffer freeSlots{
+    uint freeList[];
+};
+
+layout (std430, binding=6) buffer activeBricks{
+    uint activeList[];
+};
+
+layout (std430, binding=7) buffer brickInfo{
+    uvec2 info[];
+};
+
+void main(){
+    uint brick = gl_GlobalInvocationID.x;
+    if(brick >= brickCount){
+        return;
+    }
+    uint entry = table[brick];
+    uvec2 brickInfo = info[brick];
+
+    if(pass == 0){
+        if(entry != 0u && brickInfo.x == 0u && uintBitsToFloat(brickInfo.y) < releaseThreshold){
+            table[brick] = 0u;
+            freeList[atomicAdd(freeCount, 1)] = entry - 1u;
+        }
+        return;
+    }
+
+    if(entry == 0u && brickInfo.x != 0u){
+        int top = atomicAdd(freeCount, -1);
+        if(top <= 0){
+            atomicAdd(freeCount, 1); // Nothing left, nobody is pushing during this pass so putting it back is safe
+            overflow = 1u;
+        }else{
+            uint slot = freeList[top - 1];
+            for(uint i = 0u; i < BRICK_VOXELS; i++){
+                pool[slot * BRICK_VOXELS + i] = 0.0f;
+            }
+            entry = slot + 1u;
+            table[brick] = entry;
+        }
+    }
+    if(entry != 0u){
+        activeList[atomicAdd(dispatchX, 1u)] = brick;
+    }
+    info[brick] = uvec2(0u);
+}
@@ -0,0 +1,116 @@
+#version 460 core
+
+// Diffuses and fades the 3D trail volume with a 7-point stencil
+// The volume is stored as 8x8x8 bricks: brickTable maps every brick of the volume to a slot in the brick pool, and only
+// bricks with something in them have a slot. One work group handles one allocated brick (from activeList, so this is
+// dispatched indirectly with however many bricks are allocated), reading brickPoolCurrent and writing brickPoolNext
+// Voxels in bricks that arent allocated count as 0, so a brick whose faces have trail on them asks for its neighbours
+// to be allocated for the next step
+
+#define BRICK 8
+#define BRICK_VOXELS 512
+
+layout(local_size_x = BRICK, local_size_y = BRICK, local_size_z = BRICK) in;
+
+uniform int size;
+uniform float diffuse;
+uniform float fade;
+uniform float spreadThreshold; // Trail on a face above this allocates the brick on the other side
+
+layout (std430, binding=1) buffer brickTable{
+    uint table[];
+};
+
+layout (std430, binding=2) buffer brickPoolCurrent{
+    float pool[];
+};
+
+layout (std430, binding=3) buffer brickPoolNext{
+    float poolNext[];
+};
+
+layout (std430, binding=6) buffer activeBricks{
+    uint activeList[]; // Volume brick indices of every allocated brick, built by volumeBricks.compute.glsl
+};
+
+layout (std430, binding=7) buffer brickInfo{
+    uvec2 info[];
+};
+
+shared float block[BRICK+2][BRICK+2][BRICK+2];
+shared uint hotFaces[6];
+shared uint blockMax;
+
+int bricksPerAxis(){
+    return size / BRICK;
+}
+
+uint brickIndex(ivec3 brick){
+    int bricks = bricksPerAxis();
+    brick = (brick + bricks) % bricks; // The volume wraps around like the 2D texture does
+    return uint(brick.x + bricks * (brick.y + bricks * brick.z));
+}
+
+float loadVoxel(ivec3 voxel){
+    voxel = (voxel + size) % size;
+    uint entry = table[brickIndex(voxel / BRICK)];
+    if(entry == 0u){
+        return 0.0f;
+    }
+    ivec3 l = voxel % BRICK;
+    return pool[(entry - 1u) * BRICK_VOXELS + uint(l.x + BRICK * (l.y + BRICK * l.z))];
+}
+
+void main(){
+    uint brick = activeList[gl_WorkGroupID.x];
+    int bricks = bricksPerAxis();
+    ivec3 brickCoords = ivec3(brick % uint(bricks), (brick / uint(bricks)) % uint(bricks), brick / uint(bricks * bricks));
+    uint slot = table[brick] - 1u;
+    ivec3 l = ivec3(gl_LocalInvocationID);
+    ivec3 voxel = brickCoords * BRICK + l;
+    uint offset = slot * BRICK_VOXELS + uint(l.x + BRICK * (l.y + BRICK * l.z));
+
+    if(gl_LocalInvocationIndex == 0u){
+        blockMax = 0u;
+    }
+    if(gl_LocalInvocationIndex < 6u){
+        hotFaces[gl_LocalInvocationIndex] = 0u;
+    }
+
+    // Own voxel, plus the voxel across the face for threads on a face of the brick
+    float centre = pool[offset];
+    block[l.x+1][l.y+1][l.z+1] = centre;
+    if(l.x == 0){ block[0][l.y+1][l.z+1] = loadVoxel(voxel + ivec3(-1, 0, 0)); }
+    if(l.x == BRICK-1){ block[BRICK+1][l.y+1][l.z+1] = loadVoxel(voxel + ivec3(1, 0, 0)); }
+    if(l.y == 0){ block[l.x+1][0][l.z+1] = loadVoxel(voxel + ivec3(0, -1, 0)); }
+    if(l.y == BRICK-1){ block[l.x+1][BRICK+1][l.z+1] = loadVoxel(voxel + ivec3(0, 1, 0)); }
+    if(l.z == 0){ block[l.x+1][l.y+1][0] = loadVoxel(voxel + ivec3(0, 0, -1)); }
+    if(l.z == BRICK-1){ block[l.x+1][l.y+1][BRICK+1] = loadVoxel(voxel + ivec3(0, 0, 1)); }
+    barrier();
+
+    ivec3 b = l + 1;
+    float average = (centre + block[b.x-1][b.y][b.z] + block[b.x+1][b.y][b.z] + block[b.x][b.y-1][b.z] +
+                     block[b.x][b.y+1][b.z] + block[b.x][b.y][b.z-1] + block[b.x][b.y][b.z+1]) / 7.0f;
+    float value = centre*(1.0f - diffuse - fade) + average*diffuse;
+    value = max(value, 0.0f);
+    poolNext[offset] = value;
+
+    atomicMax(blockMax, floatBitsToUint(value)); // Positive floats sort the same as their bits
+    if(value > spreadThreshold){
+        if(l.x == 0){ hotFaces[0] = 1u; }
+        if(l.x == BRICK-1){ hotFaces[1] = 1u; }
+        if(l.y == 0){ hotFaces[2] = 1u; }
+        if(l.y == BRICK-1){ hotFaces[3] = 1u; }
+        if(l.z == 0){ hotFaces[4] = 1u; }
+        if(l.z == BRICK-1){ hotFaces[5] = 1u; }
+    }
+    barrier();
+
+    if(gl_LocalInvocationIndex == 0u){
+        info[brick].y = blockMax;
+    }
+    if(gl_LocalInvocationIndex < 6u && hotFaces[gl_LocalInvocationIndex] != 0u){
+        const ivec3 directions[6] = ivec3[6](ivec3(-1, 0, 0), ivec3(1, 0, 0), ivec3(0, -1, 0), ivec3(0, 1, 0), ivec3(0, 0, -1), ivec3(0, 0, 1));
+        info[brickIndex(brickCoords + directions[gl_LocalInvocationIndex])].x = 1u;
+    }
+}
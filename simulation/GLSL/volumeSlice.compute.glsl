@@ -0,0 +1,69 @@
+#version 460 core
+
+// Renders a view of the 3D trail volume into a 2D texture, for the preview and for exporting
+//     mode 0: one slice through the volume at a right angle to the axis
+//     mode 1: maximum along the axis (a raymarch straight through the volume), skipping bricks that arent allocated
+
+#define GROUP_SIZE 16
+#define BRICK 8
+#define BRICK_VOXELS 512
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+layout(rgba32f, binding = 0) uniform writeonly image2D img;
+
+uniform int size;
+uniform int axis; // 0 = x, 1 = y, 2 = z
+uniform int slice;
+uniform int mode;
+uniform vec3 colour;
+uniform float brightness;
+
+layout (std430, binding=1) buffer brickTable{
+    uint table[];
+};
+
+layout (std430, binding=2) buffer brickPoolCurrent{
+    float pool[];
+};
+
+// Volume voxel for a texel of the output image at depth d along the axis
+ivec3 toVoxel(ivec2 texel, int d){
+    if(axis == 0){ return ivec3(d, texel.x, texel.y); }
+    if(axis == 1){ return ivec3(texel.x, d, texel.y); }
+    return ivec3(texel.x, texel.y, d);
+}
+
+uint brickEntry(ivec3 voxel){
+    int bricks = size / BRICK;
+    ivec3 b = voxel / BRICK;
+    return table[b.x + bricks * (b.y + bricks * b.z)];
+}
+
+float loadVoxel(uint entry, ivec3 voxel){
+    ivec3 l = voxel % BRICK;
+    return pool[(entry - 1u) * BRICK_VOXELS + uint(l.x + BRICK * (l.y + BRICK * l.z))];
+}
+
+void main(){
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if(texel.x >= size || texel.y >= size){
+        return;
+    }
+    float value = 0.0f;
+    if(mode == 0){
+        ivec3 voxel = toVoxel(texel, clamp(slice, 0, size - 1));
+        uint entry = brickEntry(voxel);
+        value = (entry == 0u)? 0.0f : loadVoxel(entry, voxel);
+    }else{
+        for(int d = 0; d < size; d += BRICK){
+            uint entry = brickEntry(toVoxel(texel, d));
+            if(entry == 0u){
+                continue;
+            }
+            for(int i = 0; i < BRICK; i++){
+                value = max(value, loadVoxel(entry, toVoxel(texel, d + i)));
+            }
+        }
+    }
+    imageStore(img, texel, vec4(colour * min(value * brightness, 1.0f), value));
+}
@@ -2,11 +2,13 @@
 #include <glad/gl.h>
 
 #include "debugging.hpp"
+#include "memoryTracker.hpp"
 
 namespace openGLComponents{
     class SSBO{
         private:
-            unsigned int ID;
+            unsigned int ID = 0;
+            long long bytes = 0;
         
         public:
             /*
@@ -16,26 +18,49 @@ namespace openGLComponents{
             */
             template<typename T>
             void generate(std::vector<T>& data){
-                if(this->ID != 0){
-                    GLCall(glDeleteBuffers(1, &this->ID));
-                    this->ID = 0;
-                }
+                this->destroy();
                 GLCall(glGenBuffers(1, &this->ID));
                 GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->ID));
                 GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * data.size(), data.data(), GL_DYNAMIC_COPY));
+                this->bytes = sizeof(T) * data.size();
+                memory::allocate(memory::BUFFER, this->bytes);
+            }
+
+            /*
+                Create a new SSBO of this many bytes, all zero, without needing a vector of zeros on the CPU first
+            */
+            void generateZeroed(size_t bytes){
+                this->destroy();
+                GLCall(glGenBuffers(1, &this->ID));
+                GLCall(glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->ID));
+                GLCall(glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY));
+                GLCall(glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr)); // No data clears to 0
+                this->bytes = (long long)bytes;
+                memory::allocate(memory::BUFFER, this->bytes);
+            }
+
+            unsigned int getID() const{
+                return this->ID;
             }
 
             void bind(unsigned int shaderID, const char name[], unsigned int bindingPoint) const{
                 unsigned int block_index = glGetProgramResourceIndex(shaderID, GL_SHADER_STORAGE_BLOCK, name);
-                glShaderStorageBlockBinding(shaderID, block_index, 0);
+                glShaderStorageBlockBinding(shaderID, block_index, bindingPoint);
                 glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, this->ID);
             }
 
-            ~SSBO(){
+            void destroy(){
                 if(this->ID != 0){
                     GLCall(glDeleteBuffers(1, &this->ID));
+                    memory::release(memory::BUFFER, this->bytes);
+                    this->ID = 0;
+                    this->bytes = 0;
                 }
             }
 
+            ~SSBO(){
+                this->destroy();
+            }
+
     };
 }
@@ -23,6 +23,10 @@ namespace openGLComponents{
                 GLCall(glBindVertexArray(this->ID));
             }
 
+            unsigned int getID() const{
+                return this->ID;
+            }
+
             void addBuffer(VBO& vbo, const VBOLayout& layout){
                 this->bind();
                 vbo.bind();
@@ -3,25 +3,35 @@
 #include <vector>
 
 #include "debugging.hpp"
+#include "memoryTracker.hpp"
 
 namespace openGLComponents{
     class VBO{
         private:
-            unsigned int ID;
+            unsigned int ID = 0;
+            long long bytes = 0;
 
         public:
             ~VBO(){
-                GLCall(glDeleteBuffers(1, &this->ID));
+                if(this->ID != 0){
+                    GLCall(glDeleteBuffers(1, &this->ID));
+                    memory::release(memory::BUFFER, this->bytes);
+                }
             }
             template<typename T>
-            void generate(std::vector<T> data, unsigned int size){
+            void generate(const std::vector<T>& data, unsigned int size){
                 GLCall(glGenBuffers(1, &this->ID));
                 GLCall(glBindBuffer(GL_ARRAY_BUFFER, this->ID)); // Bind the buffer to the GL_ARRAY_BUFFER target
-                GLCall(glBufferData(GL_ARRAY_BUFFER, size, &data[0], GL_STATIC_DRAW)); // Copy the data to the buffer
+                GLCall(glBufferData(GL_ARRAY_BUFFER, size, data.data(), GL_STATIC_DRAW)); // Copy the data to the buffer
+                this->bytes = size;
+                memory::allocate(memory::BUFFER, this->bytes);
             }
             void bind(){
                 GLCall(glBindBuffer(GL_ARRAY_BUFFER, this->ID));
             }
+            unsigned int getID() const{
+                return this->ID;
+            }
     };
 
     /*
@@ -68,7 +78,7 @@ namespace openGLComponents{
                 this->push(GL_UNSIGNED_BYTE, count, GL_TRUE);
             }
 
-            inline const std::vector<VBOElement> getElements() const { return this->elements; }
+            inline const std::vector<VBOElement>& getElements() const { return this->elements; }
 
             inline unsigned int getStride() const { return this->stride; }
     };
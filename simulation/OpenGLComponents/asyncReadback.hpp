@@ -0,0 +1,165 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <glad/gl.h>
+
+#include "debugging.hpp"
+#include "memoryTracker.hpp"
+
+namespace openGLComponents{
+
+    /*
+        Ring of persistently mapped buffers for reading data back from the GPU without stalling
+        A request copies the data into the next free buffer and drops a fence behind it, poll() then hands back
+        the oldest request once the GPU has actually finished it (usually a few frames later)
+
+        If every buffer is still in flight the request is refused rather than waited on, so the caller
+        should just try again later (or make the ring bigger).
+    */
+    class asyncReadback{
+        private:
+            struct slot{
+                unsigned int buffer = 0;
+                void* mapped = nullptr;
+                GLsync fence = nullptr;
+                long long tag = 0;
+                size_t bytes = 0;
+            };
+
+            std::vector<slot> slots;
+            size_t capacity = 0;
+            int head = 0; // Next slot to write to
+            int tail = 0; // Oldest slot in flight
+            int inFlight = 0;
+
+            slot* begin(size_t bytes, long long tag){
+                if(this->full() || bytes > this->capacity){
+                    return nullptr;
+                }
+                slot& s = this->slots[this->head];
+                s.tag = tag;
+                s.bytes = bytes;
+                return &s;
+            }
+
+            void end(slot& s){
+                s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                this->head = (this->head + 1) % this->slots.size();
+                this->inFlight++;
+            }
+
+        public:
+            ~asyncReadback(){
+                this->destroy();
+            }
+
+            void init(size_t bytes, int slotCount=3){
+                this->destroy();
+                this->capacity = bytes;
+                this->slots.resize(slotCount);
+                for(slot& s : this->slots){
+                    GLCall(glCreateBuffers(1, &s.buffer));
+                    GLCall(glNamedBufferStorage(s.buffer, bytes, nullptr, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_CLIENT_STORAGE_BIT));
+                    s.mapped = glMapNamedBufferRange(s.buffer, 0, bytes, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+                }
+                memory::allocate(memory::READBACK, (long long)bytes * slotCount);
+            }
+
+            void destroy(){
+                for(slot& s : this->slots){
+                    if(s.fence != nullptr){
+                        glDeleteSync(s.fence);
+                    }
+                    if(s.buffer != 0){
+                        GLCall(glUnmapNamedBuffer(s.buffer));
+                        GLCall(glDeleteBuffers(1, &s.buffer));
+                    }
+                }
+                memory::release(memory::READBACK, (long long)this->capacity * this->slots.size());
+                this->slots.clear();
+                this->capacity = 0;
+                this->head = 0;
+                this->tail = 0;
+                this->inFlight = 0;
+            }
+
+            bool full() const{
+                return this->inFlight >= (int)this->slots.size();
+            }
+
+            size_t getCapacity() const{
+                return this->capacity;
+            }
+
+            /*
+                Copies bytes from a buffer object (e.g. an SSBO written by a compute shader)
+            */
+            bool requestBuffer(unsigned int source, size_t offset, size_t bytes, long long tag=0){
+                slot* s = this->begin(bytes, tag);
+                if(s == nullptr){
+                    return false;
+                }
+                GLCall(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+                GLCall(glCopyNamedBufferSubData(source, s->buffer, offset, 0, bytes));
+                this->end(*s);
+                return true;
+            }
+
+            /*
+                Copies a region of a texture level, like glGetTextureSubImage but into the readback buffer
+            */
+            bool requestTexture(unsigned int texture, int level, int x, int y, int w, int h, GLenum format, GLenum type, size_t bytes, long long tag=0){
+                slot* s = this->begin(bytes, tag);
+                if(s == nullptr){
+                    return false;
+                }
+                GLCall(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT));
+                GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, s->buffer));
+                GLCall(glGetTextureSubImage(texture, level, x, y, 0, w, h, 1, format, type, bytes, nullptr));
+                GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+                this->end(*s);
+                return true;
+            }
+
+            /*
+                Returns the data of the oldest request if the GPU has finished it, otherwise nullptr (never blocks)
+                The pointer stays valid until release() is called
+            */
+            const void* poll(long long* tag=nullptr, size_t* bytes=nullptr){
+                if(this->inFlight == 0){
+                    return nullptr;
+                }
+                slot& s = this->slots[this->tail];
+                GLenum status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+                if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED){
+                    return nullptr;
+                }
+                if(tag != nullptr){ *tag = s.tag; }
+                if(bytes != nullptr){ *bytes = s.bytes; }
+                return s.mapped;
+            }
+
+            /*
+                Blocks until the oldest request is finished, only meant for shutting down/flushing
+            */
+            const void* wait(long long* tag=nullptr, size_t* bytes=nullptr){
+                if(this->inFlight == 0){
+                    return nullptr;
+                }
+                glClientWaitSync(this->slots[this->tail].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+                return this->poll(tag, bytes);
+            }
+
+            void release(){
+                if(this->inFlight == 0){
+                    return;
+                }
+                slot& s = this->slots[this->tail];
+                glDeleteSync(s.fence);
+                s.fence = nullptr;
+                this->tail = (this->tail + 1) % this->slots.size();
+                this->inFlight--;
+            }
+    };
+
+}
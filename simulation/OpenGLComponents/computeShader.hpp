@@ -6,19 +6,20 @@
 #include <glad/gl.h>
 
 #include "debugging.hpp"
+#include "shaderFiles.hpp"
 
 namespace openGLComponents{
 
 class computeShader{
     private:
-        unsigned int ID;
+        unsigned int ID = 0;
 
     public:
         void createShaderFromDisk(const char* cShaderPath){
             std::string cShaderCodeStr;
             std::ifstream cShaderFile;
             try{
-                cShaderFile.open(cShaderPath);
+                cShaderFile.open(shaderFile(cShaderPath));
                 std::stringstream cShaderStream;
                 cShaderStream << cShaderFile.rdbuf();
                 cShaderFile.close();
@@ -69,52 +70,57 @@ class computeShader{
         unsigned int getID(){
             return this->ID;
         }
-    
-        void setUniform4f(const std::string& name, float x, float y, float z, float w){
+
+        // Names are plain C strings so setting a uniform never allocates (a std::string would for names over 15 characters)
+        void setUniform4f(const char* name, float x, float y, float z, float w){
             this->use();
-            glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+            glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
         }
-        void setUniform3f(const std::string& name, float x, float y, float z){
+        void setUniform3f(const char* name, float x, float y, float z){
             this->use();
-            glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+            glUniform3f(glGetUniformLocation(ID, name), x, y, z);
         }
-        void setUniform2f(const std::string& name, float x, float y){
+        void setUniform2f(const char* name, float x, float y){
             this->use();
-            glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+            glUniform2f(glGetUniformLocation(ID, name), x, y);
         }
-        void setUniform1f(const std::string& name, float x){
+        void setUniform1f(const char* name, float x){
             this->use();
-            glUniform1f(glGetUniformLocation(ID, name.c_str()), x);
+            glUniform1f(glGetUniformLocation(ID, name), x);
         }
 
-        void setUniform4i(const std::string& name, int x, int y, int z, int w){
+        void setUniform4i(const char* name, int x, int y, int z, int w){
+            this->use();
+            glUniform4i(glGetUniformLocation(ID, name), x, y, z, w);
+        }
+        void setUniform3i(const char* name, int x, int y, int z){
             this->use();
-            glUniform4i(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+            glUniform3i(glGetUniformLocation(ID, name), x, y, z);
         }
-        void setUniform3i(const std::string& name, int x, int y, int z){
+        void setUniform2i(const char* name, int x, int y){
             this->use();
-            glUniform3i(glGetUniformLocation(ID, name.c_str()), x, y, z);
+            glUniform2i(glGetUniformLocation(ID, name), x, y);
         }
-        void setUniform2i(const std::string& name, int x, int y){
+        void setUniform1i(const char* name, int x){
             this->use();
-            glUniform2i(glGetUniformLocation(ID, name.c_str()), x, y);
+            glUniform1i(glGetUniformLocation(ID, name), x);
         }
-        void setUniform1i(const std::string& name, int x){
+        void setUniform1ui(const char* name, unsigned int x){
             this->use();
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), x);
+            glUniform1ui(glGetUniformLocation(ID, name), x);
         }
         
-        void setUniformMat4fv(const std::string& name, const float* matrix){
+        void setUniformMat4fv(const char* name, const float* matrix){
             this->use();
-            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+            glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, matrix);
         }
-        void setUniformMat3fv(const std::string& name, const float* matrix){
+        void setUniformMat3fv(const char* name, const float* matrix){
             this->use();
-            glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+            glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, matrix);
         }
-        void setUniformMat2fv(const std::string& name, const float* matrix){
+        void setUniformMat2fv(const char* name, const float* matrix){
             this->use();
-            glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+            glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, matrix);
         }
 };
 
@@ -2,18 +2,106 @@
 #include <iostream>
 #include <glad/gl.h>
 
-// Debugging macro
-#define GLCall(x) GLClearError(); x; GLLogCall(#x, __FILE__, __LINE__)
+/*
+    GL debugging levels
+    0 = off, GLCall is just the call and debug groups/labels compile away entirely
+    1 = callback only, errors are reported by the driver through glDebugMessageCallback and the pipeline is annotated
+    2 = full, every GLCall is also wrapped in glGetError checks (this forces a sync on a lot of drivers, so its slow)
+
+    GLSLSLIME_GL_DEBUG_LEVEL is the highest level compiled in (set through cmake), debugging::level is the level actually
+    used at runtime and can only be lowered from what was compiled in.
+*/
+#define GL_DEBUG_LEVEL_OFF 0
+#define GL_DEBUG_LEVEL_CALLBACK 1
+#define GL_DEBUG_LEVEL_FULL 2
+
+#ifndef GLSLSLIME_GL_DEBUG_LEVEL
+#define GLSLSLIME_GL_DEBUG_LEVEL GL_DEBUG_LEVEL_CALLBACK
+#endif
+
+namespace debugging{
+    inline int level = GLSLSLIME_GL_DEBUG_LEVEL;
+
+    /*
+        Sets the runtime level and enables/disables debug output to match
+        The message callback itself still has to be installed once by whoever creates the context
+    */
+    inline void setLevel(int newLevel){
+        level = (newLevel > GLSLSLIME_GL_DEBUG_LEVEL)? GLSLSLIME_GL_DEBUG_LEVEL : newLevel;
+        level = (level < GL_DEBUG_LEVEL_OFF)? GL_DEBUG_LEVEL_OFF : level;
+        if(level >= GL_DEBUG_LEVEL_CALLBACK){
+            glEnable(GL_DEBUG_OUTPUT);
+        }else{
+            glDisable(GL_DEBUG_OUTPUT);
+        }
+        if(level >= GL_DEBUG_LEVEL_FULL){
+            glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS); // Makes the callback fire inside the offending call, so the stack trace is useful
+        }else{
+            glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        }
+    }
+
+    /*
+        Pushes a debug group for as long as the object is alive, so whatever is called within its scope shows up
+        grouped together in renderdoc/nsight/etc captures
+    */
+    class scopedGroup{
+        private:
+            bool pushed = false;
+
+        public:
+            scopedGroup(const char* name){
+                if(level >= GL_DEBUG_LEVEL_CALLBACK){
+                    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+                    this->pushed = true;
+                }
+            }
+
+            ~scopedGroup(){
+                if(this->pushed){
+                    glPopDebugGroup();
+                }
+            }
+    };
+
+    inline void label(GLenum identifier, unsigned int name, const char* text){
+        if(level >= GL_DEBUG_LEVEL_CALLBACK){
+            glObjectLabel(identifier, name, -1, text);
+        }
+    }
+}
 
 // Debugging functions
-static bool GLLogCall(const char* function, const char* file, int line) {
+inline bool GLLogCall(const char* function, const char* file, int line) {
     while (GLenum error = glGetError()) {
-        std::cout << "[OpenGL Error] (0x" << std::hex << error << ") " << function << " " << file << ":" << line << std::endl;
+        std::cout << "[OpenGL Error] (0x" << std::hex << error << std::dec << ") " << function << " " << file << ":" << line << std::endl;
         return false;
     }
     return true;
 }
 
-static void GLClearError() {
+inline void GLClearError() {
     while (glGetError() != GL_NO_ERROR);
 }
+
+// Debugging macros
+#define GL_DEBUG_CONCAT_INNER(a, b) a##b
+#define GL_DEBUG_CONCAT(a, b) GL_DEBUG_CONCAT_INNER(a, b)
+
+#if GLSLSLIME_GL_DEBUG_LEVEL >= GL_DEBUG_LEVEL_FULL
+#define GLCall(x) do{ \
+        if(debugging::level >= GL_DEBUG_LEVEL_FULL){ GLClearError(); } \
+        x; \
+        if(debugging::level >= GL_DEBUG_LEVEL_FULL){ GLLogCall(#x, __FILE__, __LINE__); } \
+    }while(0)
+#else
+#define GLCall(x) do{ x; }while(0)
+#endif
+
+#if GLSLSLIME_GL_DEBUG_LEVEL >= GL_DEBUG_LEVEL_CALLBACK
+#define GLDebugGroup(name) debugging::scopedGroup GL_DEBUG_CONCAT(glDebugGroup_, __LINE__)(name)
+#define GLObjectLabel(identifier, name, text) debugging::label(identifier, name, text)
+#else
+#define GLDebugGroup(name) do{}while(0)
+#define GLObjectLabel(identifier, name, text) do{}while(0)
+#endif
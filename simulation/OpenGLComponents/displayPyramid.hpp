@@ -0,0 +1,131 @@
+#pragma once
+#include <glad/gl.h>
+
+#include "computeShader.hpp"
+#include "debugging.hpp"
+#include "memoryTracker.hpp"
+
+#define DS_GROUPSIZE 8 // ! Must be the same as the group size in downsample.compute.glsl
+
+namespace openGLComponents{
+
+    /*
+        Reduced precision (RGBA8) mip pyramid of the simulation texture, only used for displaying it zoomed out
+        Pyramid level i is half the size of level i-1, and level 0 is half the size of the simulation texture
+        (the simulation texture itself is used when no downsampling is needed)
+    */
+    class displayPyramid{
+        private:
+            unsigned int ID = 0;
+            unsigned int res = 0;
+            int levels = 0;
+            int builtLevels = 0; // How many levels are up to date with the simulation texture
+            bool texRepeat = true;
+            long long bytes = 0;
+
+            static const int sourceUnit = 6; // Texture unit used to sample the level being downsampled
+            static const int destinationUnit = 7; // Image unit, must match downsample.compute.glsl
+
+        public:
+            ~displayPyramid(){
+                this->destroy();
+            }
+
+            void init(unsigned int res){
+                this->destroy();
+                this->res = res;
+                this->levels = 0;
+                for(unsigned int size = res/2; size >= 1; size /= 2){
+                    this->levels++;
+                }
+                if(this->levels == 0){
+                    return;
+                }
+                GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &this->ID));
+                GLCall(glTextureStorage2D(this->ID, this->levels, GL_RGBA8, res/2, res/2));
+                this->bytes = bytesFor(res);
+                memory::allocate(memory::TEXTURE, this->bytes);
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+                this->setRepeat(this->texRepeat);
+                this->builtLevels = 0;
+            }
+
+            void destroy(){
+                if(this->ID != 0){
+                    GLCall(glDeleteTextures(1, &this->ID));
+                    memory::release(memory::TEXTURE, this->bytes);
+                    this->ID = 0;
+                }
+                this->levels = 0;
+                this->builtLevels = 0;
+            }
+
+            // Size of every level together, for a simulation texture of res*res
+            static long long bytesFor(unsigned int res){
+                long long total = 0;
+                for(unsigned int size = res/2; size >= 1; size /= 2){
+                    total += 4LL * size * size;
+                }
+                return total;
+            }
+
+            void setRepeat(bool repeat){
+                this->texRepeat = repeat;
+                if(this->ID != 0){
+                    GLCall(glTextureParameteri(this->ID, GL_TEXTURE_WRAP_S, repeat ? GL_REPEAT : GL_CLAMP_TO_BORDER));
+                    GLCall(glTextureParameteri(this->ID, GL_TEXTURE_WRAP_T, repeat ? GL_REPEAT : GL_CLAMP_TO_BORDER));
+                }
+            }
+
+            /*
+                The simulation texture has changed, so every level has to be rebuilt before it is shown again
+            */
+            void invalidate(){
+                this->builtLevels = 0;
+            }
+
+            /*
+                Makes sure pyramid levels [0, count) are up to date, only doing the passes that are actually missing
+                sourceTexture is the RGBA32F simulation texture
+            */
+            void build(computeShader& downsampleShader, unsigned int sourceTexture, int count){
+                count = (count > this->levels)? this->levels : count;
+                if(count <= this->builtLevels){
+                    return;
+                }
+                GLDebugGroup("Build display pyramid");
+                GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT)); // Simulation texture was written as an image
+                downsampleShader.use();
+                downsampleShader.setUniform1i("source", sourceUnit);
+                for(int level = this->builtLevels; level < count; level++){
+                    if(level == 0){
+                        GLCall(glBindTextureUnit(sourceUnit, sourceTexture));
+                        downsampleShader.setUniform1i("sourceLevel", 0);
+                    }else{
+                        GLCall(glBindTextureUnit(sourceUnit, this->ID));
+                        downsampleShader.setUniform1i("sourceLevel", level - 1);
+                    }
+                    GLCall(glBindImageTexture(destinationUnit, this->ID, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8));
+                    unsigned int size = this->res >> (level + 1);
+                    downsampleShader.execute((size+DS_GROUPSIZE-1)/DS_GROUPSIZE, (size+DS_GROUPSIZE-1)/DS_GROUPSIZE, 1);
+                    GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+                }
+                GLCall(glBindTextureUnit(sourceUnit, 0));
+                this->builtLevels = count;
+            }
+
+            void bind(unsigned int unit){
+                GLCall(glBindTextureUnit(unit, this->ID));
+            }
+
+            int getLevels() const{
+                return this->levels;
+            }
+
+            unsigned int getID() const{
+                return this->ID;
+            }
+    };
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <atomic>
+#include <glad/gl.h>
+
+#include "debugging.hpp"
+#include "memoryTracker.hpp"
+
+namespace openGLComponents{
+
+    /*
+        Triple buffered RGBA8 copies of the simulation texture, for handing finished frames from the simulation thread
+        to the render thread when they have separate (shared) contexts
+
+        The producer always owns one slot (back) and the consumer another (front), the third (middle) is swapped with
+        either of them through a single atomic, so neither thread ever waits on the other. Fences go both ways, and
+        both waits happen on the GPU rather than the CPU: each copy has a fence behind it which the consumer's context
+        waits on before drawing it, and a slot the consumer gives up has a fence behind its last draw which the
+        producer's context waits on before copying into it again.
+        Slots are mipmapped so they can be shown zoomed out without aliasing, and are remade by whoever owns them if the
+        resolution changes
+    */
+    class frameHandoff{
+        private:
+            struct slot{
+                unsigned int texture = 0;
+                unsigned int res = 0;
+                GLsync fence = nullptr; // Behind the copy into it, set by the producer
+                GLsync drawn = nullptr; // Behind the last draw of it, set by the consumer when it gives the slot up
+                long long step = 0;
+                long long bytes = 0;
+            };
+
+            static const unsigned int freshBit = 4; // Set in middle when it holds a frame the consumer hasnt taken yet
+
+            slot slots[3];
+            std::atomic<unsigned int> middle{1};
+            unsigned int back = 0; // Producer only
+            unsigned int front = 2; // Consumer only
+            unsigned int readFramebuffer = 0; // Producer only
+            unsigned int drawFramebuffer = 0;
+
+            static int levelsFor(unsigned int res){
+                int levels = 1;
+                while((res >> levels) > 0){
+                    levels++;
+                }
+                return levels;
+            }
+
+            void remake(slot& s, unsigned int res){
+                this->release(s);
+                GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &s.texture));
+                GLCall(glTextureStorage2D(s.texture, levelsFor(res), GL_RGBA8, res, res));
+                GLCall(glTextureParameteri(s.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+                GLCall(glTextureParameteri(s.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+                GLCall(glTextureParameteri(s.texture, GL_TEXTURE_WRAP_S, GL_REPEAT));
+                GLCall(glTextureParameteri(s.texture, GL_TEXTURE_WRAP_T, GL_REPEAT));
+                GLObjectLabel(GL_TEXTURE, s.texture, "Frame handoff texture");
+                s.res = res;
+                s.bytes = 4LL * res * res * 4 / 3; // With the mip chain
+                memory::allocate(memory::TEXTURE, s.bytes);
+            }
+
+            void release(slot& s){
+                if(s.fence != nullptr){
+                    glDeleteSync(s.fence);
+                    s.fence = nullptr;
+                }
+                if(s.drawn != nullptr){
+                    glDeleteSync(s.drawn);
+                    s.drawn = nullptr;
+                }
+                if(s.texture != 0){
+                    GLCall(glDeleteTextures(1, &s.texture));
+                    memory::release(memory::TEXTURE, s.bytes);
+                    s.texture = 0;
+                }
+                s.res = 0;
+            }
+
+        public:
+            /*
+                Textures are shared between the contexts so it doesnt matter which one this is called from, as long as
+                neither thread is using the handoff any more
+            */
+            void destroy(){
+                for(slot& s : this->slots){
+                    this->release(s);
+                }
+                if(this->readFramebuffer != 0){
+                    GLCall(glDeleteFramebuffers(1, &this->readFramebuffer));
+                    GLCall(glDeleteFramebuffers(1, &this->drawFramebuffer));
+                    this->readFramebuffer = 0;
+                    this->drawFramebuffer = 0;
+                }
+            }
+
+            /*
+                Producer: true if the consumer has taken the last published frame, so publishing another isnt wasted
+            */
+            bool wanted() const{
+                return (this->middle.load(std::memory_order_acquire) & freshBit) == 0;
+            }
+
+            /*
+                Producer: copies the RGBA32F simulation texture (res*res) into the back slot and swaps it into the middle
+                Framebuffers are per context, so they belong to the producer's context
+            */
+            void publish(unsigned int sourceTexture, unsigned int res, long long step){
+                GLDebugGroup("Publish frame");
+                slot& s = this->slots[this->back];
+                if(s.drawn != nullptr){ // The render context might still be drawing it
+                    glWaitSync(s.drawn, 0, GL_TIMEOUT_IGNORED);
+                    glDeleteSync(s.drawn);
+                    s.drawn = nullptr;
+                }
+                if(s.res != res){
+                    this->remake(s, res);
+                }
+                if(s.fence != nullptr){ // The consumer never took this one
+                    glDeleteSync(s.fence);
+                    s.fence = nullptr;
+                }
+                if(this->readFramebuffer == 0){
+                    GLCall(glCreateFramebuffers(1, &this->readFramebuffer));
+                    GLCall(glCreateFramebuffers(1, &this->drawFramebuffer));
+                }
+                GLCall(glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT)); // Simulation texture was written as an image
+                GLCall(glNamedFramebufferTexture(this->readFramebuffer, GL_COLOR_ATTACHMENT0, sourceTexture, 0));
+                GLCall(glNamedFramebufferTexture(this->drawFramebuffer, GL_COLOR_ATTACHMENT0, s.texture, 0));
+                GLCall(glBlitNamedFramebuffer(this->readFramebuffer, this->drawFramebuffer, 0, 0, res, res, 0, 0, res, res, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+                GLCall(glGenerateTextureMipmap(s.texture));
+                s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                s.step = step;
+                GLCall(glFlush()); // The fence has to reach the GPU before another context can wait on it
+                this->back = this->middle.exchange(this->back | freshBit, std::memory_order_acq_rel) & ~freshBit;
+            }
+
+            /*
+                Consumer: swaps in the newest published frame if there is one, then returns the texture to draw (0 before the first frame)
+                Call it before drawing, the fence for the slot given up goes behind everything already drawn with it
+            */
+            unsigned int acquire(){
+                if((this->middle.load(std::memory_order_acquire) & freshBit) != 0){
+                    slot& old = this->slots[this->front];
+                    if(old.texture != 0){
+                        if(old.drawn != nullptr){
+                            glDeleteSync(old.drawn);
+                        }
+                        old.drawn = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                        GLCall(glFlush()); // The producer's context waits on it
+                    }
+                    this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & ~freshBit;
+                    slot& s = this->slots[this->front];
+                    if(s.fence != nullptr){
+                        glWaitSync(s.fence, 0, GL_TIMEOUT_IGNORED);
+                        glDeleteSync(s.fence);
+                        s.fence = nullptr;
+                    }
+                }
+                return this->slots[this->front].texture;
+            }
+
+            // Consumer: step number of the frame acquire() last returned
+            long long frontStep() const{
+                return this->slots[this->front].step;
+            }
+    };
+
+}
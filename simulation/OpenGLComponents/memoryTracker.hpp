@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <glad/gl.h>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#endif
+
+// Not every glad build includes these vendor extensions, the values come from the extension specs
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+    #define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#endif
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+    #define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+    #define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+namespace openGLComponents{
+
+    /*
+        Keeps count of how much memory the openGLComponents classes have asked the driver for, and asks the driver/OS how much there is
+        The counts are what was requested, drivers will usually round things up a little and add their own overhead on top
+    */
+    namespace memory{
+        enum category{
+            TEXTURE,
+            BUFFER,
+            READBACK, // Client side (host visible) buffers used for reading data back
+            CATEGORY_COUNT
+        };
+
+        inline std::atomic<long long> allocated[CATEGORY_COUNT] = {};
+
+        inline void allocate(category c, long long bytes){
+            allocated[c] += bytes;
+        }
+
+        inline void release(category c, long long bytes){
+            allocated[c] -= bytes;
+        }
+
+        inline long long get(category c){
+            return allocated[c];
+        }
+
+        // Everything that lives on the device (readback buffers are counted as host memory)
+        inline long long deviceTotal(){
+            return allocated[TEXTURE] + allocated[BUFFER];
+        }
+
+        inline bool hasExtension(const char* name){
+            int count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for(int i = 0; i < count; i++){
+                const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if(extension != nullptr && std::strcmp(extension, name) == 0){
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /*
+            Device memory as reported by the driver, -1 means the driver doesnt say
+            (only NVIDIA and AMD expose this, everything else just gets the GL limits checked)
+        */
+        struct deviceInfo{
+            long long totalBytes = -1;
+            long long availableBytes = -1;
+            const char* source = "unknown";
+        };
+
+        inline deviceInfo queryDevice(){
+            static const int vendor = hasExtension("GL_NVX_gpu_memory_info") ? 1 : hasExtension("GL_ATI_meminfo") ? 2 : 0;
+            deviceInfo info;
+            if(vendor == 1){
+                int kb = 0;
+                glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &kb);
+                info.totalBytes = kb * 1024LL;
+                glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &kb);
+                info.availableBytes = kb * 1024LL;
+                info.source = "GL_NVX_gpu_memory_info";
+            }else if(vendor == 2){
+                int kb[4] = {}; // Total free, largest free block, total free auxiliary, largest free auxiliary block
+                glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, kb);
+                info.availableBytes = kb[0] * 1024LL;
+                info.source = "GL_ATI_meminfo";
+            }
+            return info;
+        }
+
+        /*
+            Physical memory the OS says is available without swapping, -1 if unknown
+        */
+        inline long long hostAvailable(){
+        #if defined(_WIN32)
+            MEMORYSTATUSEX status;
+            status.dwLength = sizeof(status);
+            if(GlobalMemoryStatusEx(&status)){
+                return status.ullAvailPhys;
+            }
+            return -1;
+        #else
+            FILE* meminfo = std::fopen("/proc/meminfo", "r"); // The Memory section calls this every frame, an ifstream and strings allocated every time
+            if(meminfo == nullptr){
+                return -1;
+            }
+            char line[256];
+            long long kb = -1;
+            while(std::fgets(line, sizeof(line), meminfo) != nullptr){
+                if(std::sscanf(line, "MemAvailable: %lld", &kb) == 1){
+                    break;
+                }
+            }
+            std::fclose(meminfo);
+            return (kb < 0)? -1 : kb * 1024;
+        #endif
+        }
+
+        inline double toMB(long long bytes){
+            return bytes / (1024.0 * 1024.0);
+        }
+    }
+
+}
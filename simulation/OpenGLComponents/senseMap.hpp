@@ -0,0 +1,97 @@
+#pragma once
+#include <cmath>
+#include <glad/gl.h>
+
+#include "debugging.hpp"
+#include "memoryTracker.hpp"
+
+namespace openGLComponents{
+
+    /*
+        Read-only copy of the trail deposit (just the alpha channel, as R16F) that agents sense through a sampler
+        Level 0 is written by the diffuse pass, the other levels are generated from it so a wide sensor can be a single
+        filtered fetch from a coarser level instead of lots of single texel loads
+    */
+    class senseMap{
+        private:
+            unsigned int ID = 0;
+            unsigned int res = 0;
+            int levels = 0;
+            long long bytes = 0;
+
+        public:
+            ~senseMap(){
+                this->destroy();
+            }
+
+            static int levelsFor(unsigned int res){
+                int levels = 1;
+                while((res >> levels) >= 1){
+                    levels++;
+                }
+                return levels;
+            }
+
+            static long long bytesFor(unsigned int res){
+                long long total = 0;
+                for(unsigned int size = res; size >= 1; size /= 2){
+                    total += 2LL * size * size;
+                }
+                return total;
+            }
+
+            void init(unsigned int res){
+                this->destroy();
+                this->res = res;
+                this->levels = levelsFor(res);
+                GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &this->ID));
+                GLCall(glTextureStorage2D(this->ID, this->levels, GL_R16F, res, res));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_WRAP_S, GL_REPEAT)); // Agents wrap around the world, so sensing does too
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_WRAP_T, GL_REPEAT));
+                GLCall(glClearTexImage(this->ID, 0, GL_RED, GL_FLOAT, NULL));
+                this->bytes = bytesFor(res);
+                memory::allocate(memory::TEXTURE, this->bytes);
+            }
+
+            void destroy(){
+                if(this->ID != 0){
+                    GLCall(glDeleteTextures(1, &this->ID));
+                    memory::release(memory::TEXTURE, this->bytes);
+                    this->ID = 0;
+                }
+                this->levels = 0;
+            }
+
+            // Level 0, for the diffuse pass to write to
+            void bindImage(unsigned int unit){
+                GLCall(glBindImageTexture(unit, this->ID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F));
+            }
+
+            void bindSampler(unsigned int unit){
+                GLCall(glBindTextureUnit(unit, this->ID));
+            }
+
+            /*
+                Rebuilds levels 1 to maxLevel from level 0, nothing is done when only level 0 is needed
+            */
+            void generateLevels(int maxLevel){
+                maxLevel = (maxLevel >= this->levels)? this->levels - 1 : maxLevel;
+                if(maxLevel <= 0){
+                    return;
+                }
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MAX_LEVEL, maxLevel)); // Stops glGenerateTextureMipmap from doing levels that wont be sampled
+                GLCall(glGenerateTextureMipmap(this->ID));
+            }
+
+            unsigned int getID() const{
+                return this->ID;
+            }
+
+            unsigned int getRes() const{
+                return this->res;
+            }
+    };
+
+}
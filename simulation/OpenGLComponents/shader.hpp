@@ -5,11 +5,13 @@
 #include <iostream>
 #include <glad/gl.h>
 
+#include "shaderFiles.hpp"
+
 namespace openGLComponents{
 
 class shader{
     private:
-        unsigned int ID;
+        unsigned int ID = 0;
 
         unsigned int compileShader(unsigned int type, const std::string& source){
             // Create and compile a shader:
@@ -64,8 +66,8 @@ class shader{
             fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
             try{
                 // Open files
-                vShaderFile.open(vertexPath);
-                fShaderFile.open(fragmentPath);
+                vShaderFile.open(shaderFile(vertexPath));
+                fShaderFile.open(shaderFile(fragmentPath));
                 std::stringstream vShaderStream, fShaderStream; // Create string streams to store the contents of the files
                 // Read file's buffer contents into streams:
                 vShaderStream << vShaderFile.rdbuf();
@@ -89,51 +91,55 @@ class shader{
             GLCall(glUseProgram(this->ID));
         }
 
-        void setUniform4f(const std::string& name, float x, float y, float z, float w){
+        unsigned int getID(){
+            return this->ID;
+        }
+
+        void setUniform4f(const char* name, float x, float y, float z, float w){
             this->use();
-            glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+            glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
         }
-        void setUniform3f(const std::string& name, float x, float y, float z){
+        void setUniform3f(const char* name, float x, float y, float z){
             this->use();
-            glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+            glUniform3f(glGetUniformLocation(ID, name), x, y, z);
         }
-        void setUniform2f(const std::string& name, float x, float y){
+        void setUniform2f(const char* name, float x, float y){
             this->use();
-            glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+            glUniform2f(glGetUniformLocation(ID, name), x, y);
         }
-        void setUniform1f(const std::string& name, float x){
+        void setUniform1f(const char* name, float x){
             this->use();
-            glUniform1f(glGetUniformLocation(ID, name.c_str()), x);
+            glUniform1f(glGetUniformLocation(ID, name), x);
         }
 
-        void setUniform4i(const std::string& name, int x, int y, int z, int w){
+        void setUniform4i(const char* name, int x, int y, int z, int w){
             this->use();
-            glUniform4i(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+            glUniform4i(glGetUniformLocation(ID, name), x, y, z, w);
         }
-        void setUniform3i(const std::string& name, int x, int y, int z){
+        void setUniform3i(const char* name, int x, int y, int z){
             this->use();
-            glUniform3i(glGetUniformLocation(ID, name.c_str()), x, y, z);
+            glUniform3i(glGetUniformLocation(ID, name), x, y, z);
         }
-        void setUniform2i(const std::string& name, int x, int y){
+        void setUniform2i(const char* name, int x, int y){
             this->use();
-            glUniform2i(glGetUniformLocation(ID, name.c_str()), x, y);
+            glUniform2i(glGetUniformLocation(ID, name), x, y);
         }
-        void setUniform1i(const std::string& name, int x){
+        void setUniform1i(const char* name, int x){
             this->use();
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), x);
+            glUniform1i(glGetUniformLocation(ID, name), x);
         }
         
-        void setUniformMat4fv(const std::string& name, const float* matrix){
+        void setUniformMat4fv(const char* name, const float* matrix){
             this->use();
-            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+            glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, matrix);
         }
-        void setUniformMat3fv(const std::string& name, const float* matrix){
+        void setUniformMat3fv(const char* name, const float* matrix){
             this->use();
-            glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+            glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, matrix);
         }
-        void setUniformMat2fv(const std::string& name, const float* matrix){
+        void setUniformMat2fv(const char* name, const float* matrix){
             this->use();
-            glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, matrix);
+            glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, matrix);
         }
 };  
 
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+namespace openGLComponents{
+
+    /*
+        Directory that the "GLSL/..." shader paths are relative to, empty = the working directory
+        Only needs setting when the shaders arent next to wherever the process runs from (see library/glslslime.h)
+        Per thread, since library simulations on different threads can each have their own root
+    */
+    inline thread_local std::string shaderRoot;
+
+    inline std::string shaderFile(const char* path){
+        if(shaderRoot.empty() || path[0] == '/'){
+            return path;
+        }
+        return (shaderRoot.back() == '/')? shaderRoot + path : shaderRoot + "/" + path;
+    }
+
+}
@@ -1,6 +1,9 @@
+#pragma once
 #include <glad/gl.h>
+#include <vector>
 
 #include "debugging.hpp"
+#include "memoryTracker.hpp"
 
 namespace openGLComponents{
 
@@ -12,12 +15,13 @@ namespace openGLComponents{
     */
     class simulationTexture{
         private:
-            unsigned int* textures;
-            unsigned int res;
+            unsigned int texture = 0;
+            unsigned int width = 0;
+            unsigned int height = 0;
             bool texRepeat = true;
 
             // Le copypasta from the old version
-            void makeTextures(unsigned int* textures, unsigned int n, unsigned int res){
+            void makeTextures(unsigned int* textures, unsigned int n, unsigned int width, unsigned int height){
                 glGenTextures(n, textures);
                 for (int i = 0; i < n; i++) {
                     GLCall(glActiveTexture(GL_TEXTURE0 + i));
@@ -26,7 +30,7 @@ namespace openGLComponents{
                     GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->texRepeat ? GL_REPEAT : GL_CLAMP_TO_BORDER));
                     GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
                     GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
-                    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, res, res, 0, GL_RGBA, GL_FLOAT, NULL));
+                    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL));
                 }
             }
             void activebindtex(unsigned int tex, unsigned int texid, unsigned int unit){
@@ -37,47 +41,62 @@ namespace openGLComponents{
 
         public:
             void init(unsigned int res){
-                this->textures = new unsigned int[1];
-                this->makeTextures(this->textures, 1, res);
-                this->res = res;
+                this->init(res, res);
+            }
+
+            // Non-square textures are only used for the subdomains of a distributed run
+            void init(unsigned int width, unsigned int height){
+                this->makeTextures(&this->texture, 1, width, height);
+                this->width = width;
+                this->height = height;
+                memory::allocate(memory::TEXTURE, 16LL * width * height);
             }
 
             void clear(){
-                GLCall(glClearTexImage(this->textures[0], 0, GL_RGBA, GL_FLOAT, NULL));
+                GLCall(glClearTexImage(this->texture, 0, GL_RGBA, GL_FLOAT, NULL));
             }
 
             void destroy(){
-                GLCall(glDeleteTextures(1, this->textures));
-                delete[] this->textures;
+                if(this->texture == 0){
+                    return;
+                }
+                GLCall(glDeleteTextures(1, &this->texture));
+                this->texture = 0;
+                memory::release(memory::TEXTURE, 16LL * this->width * this->height);
             }
             
             void bind(){
-                this->activebindtex(this->textures[0], 0, 0);
+                this->activebindtex(this->texture, 0, 0);
+            }
+
+            unsigned int getID() const{
+                return this->texture;
             }
 
             void update(float* data){
                 GLCall(glActiveTexture(GL_TEXTURE0));
-                GLCall(glBindTexture(GL_TEXTURE_2D, this->textures[0]));
-                GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, this->res, this->res, GL_RGBA, GL_FLOAT, data));
+                GLCall(glBindTexture(GL_TEXTURE_2D, this->texture));
+                GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, this->width, this->height, GL_RGBA, GL_FLOAT, data));
             }
             
             /*
-                !!! allocates memory which must be freed manually later on
-                I will probably rewrite this a bit later
-
-                Returns a pointer to the pixels of the texture
+                Reads the pixels of the texture back into pixels (RGBA floats), which only grows if it is too small,
+                so reading back every frame into the same vector doesnt allocate
+                Stalls until the GPU is done, exports use frameExport's asyncReadback instead
             */
-            float* getTexImage(){
-                this->bind();
-                float* pixels = new float[this->res * this->res * 4];
-                GLCall(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels));
-                return pixels;
+            void getTexImage(std::vector<float>& pixels){
+                pixels.resize((size_t)this->width * this->height * 4);
+                GLCall(glGetTextureImage(this->texture, 0, GL_RGBA, GL_FLOAT, (GLsizei)(pixels.size() * sizeof(float)), pixels.data()));
+            }
+
+            bool getRepeat() const{
+                return this->texRepeat;
             }
 
             void toggleRepeat(){
                 this->texRepeat = !this->texRepeat;
                 GLCall(glActiveTexture(GL_TEXTURE0));
-                GLCall(glBindTexture(GL_TEXTURE_2D, this->textures[0]));
+                GLCall(glBindTexture(GL_TEXTURE_2D, this->texture));
                 GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->texRepeat ? GL_REPEAT : GL_CLAMP_TO_BORDER));
                 GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->texRepeat ? GL_REPEAT : GL_CLAMP_TO_BORDER));
             }
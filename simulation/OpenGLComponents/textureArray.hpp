@@ -0,0 +1,75 @@
+#pragma once
+#include <glad/gl.h>
+
+#include "debugging.hpp"
+#include "memoryTracker.hpp"
+
+namespace openGLComponents{
+
+    /*
+        RGBA32F 2D texture array, one layer per simulation instance
+        Used by the parameter sweep to step lots of small simulations with one dispatch
+    */
+    class textureArray{
+        private:
+            unsigned int ID = 0;
+            unsigned int res = 0;
+            unsigned int layers = 0;
+
+        public:
+            ~textureArray(){
+                this->destroy();
+            }
+
+            void init(unsigned int res, unsigned int layers){
+                this->destroy();
+                this->res = res;
+                this->layers = layers;
+                GLCall(glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &this->ID));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_WRAP_S, GL_REPEAT));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_WRAP_T, GL_REPEAT));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+                GLCall(glTextureParameteri(this->ID, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+                GLCall(glTextureStorage3D(this->ID, 1, GL_RGBA32F, res, res, layers));
+                memory::allocate(memory::TEXTURE, 16LL * res * res * layers);
+            }
+
+            void destroy(){
+                if(this->ID != 0){
+                    GLCall(glDeleteTextures(1, &this->ID));
+                    memory::release(memory::TEXTURE, 16LL * this->res * this->res * this->layers);
+                    this->ID = 0;
+                }
+            }
+
+            void clear(){
+                GLCall(glClearTexImage(this->ID, 0, GL_RGBA, GL_FLOAT, NULL));
+            }
+
+            // Binds every layer at once, so the shaders see it as an image2DArray
+            void bind(unsigned int unit=0){
+                GLCall(glBindTextureUnit(unit, this->ID));
+                GLCall(glBindImageTexture(unit, this->ID, 0, GL_TRUE, 0, GL_READ_WRITE, GL_RGBA32F));
+            }
+
+            /*
+                Copies one layer into pixels, which must have room for res*res*4 floats
+            */
+            void getLayerImage(unsigned int layer, float* pixels){
+                GLCall(glGetTextureSubImage(this->ID, 0, 0, 0, layer, this->res, this->res, 1, GL_RGBA, GL_FLOAT, sizeof(float) * 4 * this->res * this->res, pixels));
+            }
+
+            unsigned int getID() const{
+                return this->ID;
+            }
+
+            unsigned int getRes() const{
+                return this->res;
+            }
+
+            unsigned int getLayers() const{
+                return this->layers;
+            }
+    };
+
+}
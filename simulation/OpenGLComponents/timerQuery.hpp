@@ -0,0 +1,79 @@
+#pragma once
+#include <glad/gl.h>
+
+#include "debugging.hpp"
+
+namespace openGLComponents{
+
+    /*
+        Measures how long the GPU spends between begin() and end() using timestamp queries
+        Results are picked up a few frames later when they are available, so measuring never stalls the pipeline
+        The reported time is a smoothed average since single frames are pretty noisy
+    */
+    class timerQuery{
+        private:
+            static const int ringSize = 4;
+            unsigned int queries[ringSize][2] = {};
+            bool pending[ringSize] = {};
+            int next = 0;
+            double averageMs = 0;
+            double lastMs = 0;
+            bool begun = false;
+
+        public:
+            ~timerQuery(){
+                if(this->queries[0][0] != 0){
+                    GLCall(glDeleteQueries(ringSize*2, &this->queries[0][0]));
+                }
+            }
+
+            void begin(){
+                if(this->queries[0][0] == 0){
+                    GLCall(glGenQueries(ringSize*2, &this->queries[0][0]));
+                }
+                this->poll();
+                this->begun = !this->pending[this->next]; // Skip this measurement if the slot hasnt been read yet
+                if(this->begun){
+                    GLCall(glQueryCounter(this->queries[this->next][0], GL_TIMESTAMP));
+                }
+            }
+
+            void end(){
+                if(!this->begun){
+                    return;
+                }
+                GLCall(glQueryCounter(this->queries[this->next][1], GL_TIMESTAMP));
+                this->pending[this->next] = true;
+                this->next = (this->next + 1) % ringSize;
+                this->begun = false;
+            }
+
+            void poll(){
+                for(int i = 0; i < ringSize; i++){
+                    if(!this->pending[i]){
+                        continue;
+                    }
+                    int available = 0;
+                    GLCall(glGetQueryObjectiv(this->queries[i][1], GL_QUERY_RESULT_AVAILABLE, &available));
+                    if(!available){
+                        continue;
+                    }
+                    GLuint64 start = 0, end = 0;
+                    GLCall(glGetQueryObjectui64v(this->queries[i][0], GL_QUERY_RESULT, &start));
+                    GLCall(glGetQueryObjectui64v(this->queries[i][1], GL_QUERY_RESULT, &end));
+                    this->lastMs = (end - start) / 1000000.0;
+                    this->averageMs = (this->averageMs == 0)? this->lastMs : this->averageMs*0.95 + this->lastMs*0.05;
+                    this->pending[i] = false;
+                }
+            }
+
+            double getAverageMs() const{
+                return this->averageMs;
+            }
+
+            double getLastMs() const{
+                return this->lastMs;
+            }
+    };
+
+}
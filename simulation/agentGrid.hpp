@@ -0,0 +1,158 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/SSBO.hpp"
+#include "OpenGLComponents/timerQuery.hpp"
+#include "OpenGLComponents/debugging.hpp"
+
+#define AGR_GROUPSIZE 256 // ! Must be the same as the group size in agentGrid.compute.glsl
+
+namespace simulation{
+
+/*
+    Uniform grid over the simulation texture which the agents are counting sorted into every step, so each agent
+    can look at the agents near it without looking at all of them (see agentGrid.compute.glsl for the passes)
+    Cells are at least as big as the interaction radius, so only the 3x3 cells around an agent need checking, and the
+    number of candidates checked is capped so the cost per agent is bounded however crowded it gets
+
+    Buffers are only created while the grid is being used, and are remade when the agent count or cell count changes
+*/
+class agentGrid{
+private:
+    openGLComponents::computeShader shader;
+    openGLComponents::SSBO cellSSBO; // cellCount+1 cell starts
+    openGLComponents::SSBO blockSSBO; // Prefix sums of blocks of cells
+    openGLComponents::SSBO slotSSBO; // Per agent position within its cell
+    openGLComponents::SSBO sortedSSBO; // Agents sorted by cell
+    openGLComponents::SSBO neighbourSSBO; // Per agent result of the query, read by agent.compute.glsl
+    openGLComponents::timerQuery buildTimer;
+    openGLComponents::timerQuery queryTimer;
+    unsigned int agentCount = 0;
+    int cellsPerAxis = 0;
+    bool created = false;
+
+    static int cellsFor(int res, float radius){
+        return std::max(1, (int)(res / std::max(radius, 1.0f)));
+    }
+
+    static unsigned int blocksFor(long long cells){
+        return (unsigned int)((cells + 1 + AGR_GROUPSIZE - 1) / AGR_GROUPSIZE);
+    }
+
+    void resize(unsigned int agents, int cells){
+        if(this->created && agents == this->agentCount && cells == this->cellsPerAxis){
+            return;
+        }
+        long long cellCount = (long long)cells * cells;
+        std::vector<uint32_t> cellStarts(cellCount + 1, 0);
+        this->cellSSBO.generate(cellStarts);
+        std::vector<uint32_t> blockSums(blocksFor(cellCount), 0);
+        this->blockSSBO.generate(blockSums);
+        std::vector<uint32_t> slots(std::max(agents, 1u), 0);
+        this->slotSSBO.generate(slots);
+        std::vector<float> sorted(4 * (size_t)std::max(agents, 1u), 0.0f);
+        this->sortedSSBO.generate(sorted);
+        std::vector<float> neighbours(2 * (size_t)std::max(agents, 1u), 0.0f);
+        this->neighbourSSBO.generate(neighbours);
+        GLObjectLabel(GL_BUFFER, this->cellSSBO.getID(), "Agent grid cells SSBO");
+        GLObjectLabel(GL_BUFFER, this->sortedSSBO.getID(), "Agent grid sorted agents SSBO");
+        GLObjectLabel(GL_BUFFER, this->neighbourSSBO.getID(), "Agent grid neighbours SSBO");
+        this->agentCount = agents;
+        this->cellsPerAxis = cells;
+        this->created = true;
+    }
+
+    void execute(int pass, unsigned int groups){
+        this->shader.setUniform1i("pass", pass);
+        this->shader.execute(groups, 1, 1);
+        GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    }
+
+public:
+    void setup(){
+        this->shader.createShaderFromDisk("GLSL/agentGrid.compute.glsl");
+        GLObjectLabel(GL_PROGRAM, this->shader.getID(), "Agent grid compute shader");
+    }
+
+    /*
+        Device memory the grid needs for a given agent count, resolution and radius
+    */
+    static long long bytesFor(long long agents, int res, float radius){
+        long long cells = (long long)cellsFor(res, radius) * cellsFor(res, radius);
+        return 4 * (cells + 1) + 4LL * blocksFor(cells) + (4 + 16 + 8) * agents;
+    }
+
+    /*
+        Sorts the agents into the grid and runs the neighbour query, the agent pass afterwards reads the result from binding 15
+        agents is the agent SSBO, which is bound to binding 0 like for the agent shader
+    */
+    void build(openGLComponents::SSBO& agents, unsigned int agentCount, int res, float radius, int maxChecks){
+        int cells = cellsFor(res, radius);
+        this->resize(agentCount, cells);
+        long long cellCount = (long long)cells * cells;
+        unsigned int agentGroups = (agentCount + AGR_GROUPSIZE - 1) / AGR_GROUPSIZE;
+        unsigned int cellGroups = blocksFor(cellCount);
+
+        GLDebugGroup("Agent grid");
+        agents.bind(this->shader.getID(), "agentData", 0);
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, this->cellSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, this->blockSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, this->slotSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 14, this->sortedSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, this->neighbourSSBO.getID()));
+        this->shader.use();
+        this->shader.setUniform1ui("agentCount", agentCount);
+        this->shader.setUniform1ui("cellCount", (unsigned int)cellCount);
+        this->shader.setUniform1i("cellsPerAxis", cells);
+        this->shader.setUniform1f("cellSize", (float)res / cells);
+        this->shader.setUniform1f("size", (float)res);
+        this->shader.setUniform1f("radius", radius);
+        this->shader.setUniform1ui("maxChecks", (unsigned int)std::max(maxChecks, 1));
+
+        this->buildTimer.begin();
+        GLCall(glClearNamedBufferData(this->cellSSBO.getID(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+        GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        this->execute(0, agentGroups);
+        this->execute(1, cellGroups);
+        this->execute(2, 1);
+        this->execute(3, cellGroups);
+        this->execute(4, agentGroups);
+        this->buildTimer.end();
+        this->queryTimer.begin();
+        this->execute(5, agentGroups); // Every agent could be in the grid, the shader checks the real count
+        this->queryTimer.end();
+    }
+
+    /*
+        Frees the buffers, build() makes them again when needed
+    */
+    void release(){
+        if(!this->created){
+            return;
+        }
+        this->cellSSBO.destroy();
+        this->blockSSBO.destroy();
+        this->slotSSBO.destroy();
+        this->sortedSSBO.destroy();
+        this->neighbourSSBO.destroy();
+        this->created = false;
+    }
+
+    double getBuildMs() const{
+        return this->buildTimer.getAverageMs();
+    }
+
+    double getQueryMs() const{
+        return this->queryTimer.getAverageMs();
+    }
+
+    int getCellsPerAxis() const{
+        return this->cellsPerAxis;
+    }
+};
+
+}
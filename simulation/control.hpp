@@ -0,0 +1,281 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "simulation.hpp"
+#include "../misc/json.hpp"
+
+namespace simulation{
+
+/*
+    Handles the line-delimited JSON commands sent over the control socket (see misc/controlSocket.hpp)
+    Every command is an object with a "cmd" field, and gets exactly one reply line back: {"ok":true,...} or {"ok":false,"error":"..."}
+    If the command has an "id" field it is copied into the reply so clients can match them up
+
+        {"cmd":"ping"}
+        {"cmd":"get"}                                   all parameters, or {"cmd":"get","name":"speed"} for just one
+        {"cmd":"set","name":"speed","value":2}          colours take a list, e.g. "value":[1,0,0]
+        {"cmd":"set","params":{"speed":2,"fade":0.05}}  several at once
+        {"cmd":"restart","agents":100000,"resolution":2048,"seed":1}   all three are optional
+        {"cmd":"step","count":500}
+        {"cmd":"frame","path":"out.png"}
+        {"cmd":"frame","path":"out.qoi","region":[0,0,512,512],"width":256}   crop in texels and/or output size, both are kept for later frames
+        {"cmd":"frame","path":"out.qoi","region":"whole","width":0,"height":0} back to the whole texture, one pixel per texel
+        {"cmd":"stats"}                                 measures now and waits for the result
+        {"cmd":"save"}                                  flushes the statistics csv so everything so far is on disk
+        {"cmd":"record","path":"run.slrec","interval":10,"maxDeposit":1}   starts a trail recording (all optional)
+        {"cmd":"record","stop":true}                    finishes the recording and writes its index
+        {"cmd":"trace","path":"run.sltrace","first":0,"stride":1000,"count":256}   traces every Nth agent (all optional)
+        {"cmd":"trace","ids":[5,17,90]}                 traces just these agents
+        {"cmd":"trace","stop":true}                     writes out what is left of the trace and closes it
+        {"cmd":"publish","name":"/glslslime","format":"rgba16f","downscale":4,"rate":30}   live trail to shared memory (all optional)
+        {"cmd":"publish","stop":true}
+        {"cmd":"journal","path":"run.sljournal"}        saves the settings journal of the session so far (path optional), see GLSLSlimeReplay
+        {"cmd":"quit"}
+*/
+class controlCommands{
+private:
+    simulation::main& sim;
+    bool quitRequested = false;
+
+    static std::vector<double> toValues(const json::value& v){
+        std::vector<double> values;
+        if(v.type == json::value::ARRAY){
+            for(const json::value& element : v.array){
+                values.push_back((element.type == json::value::BOOLEAN)? element.boolean : element.number);
+            }
+        }else{
+            values.push_back((v.type == json::value::BOOLEAN)? v.boolean : v.number);
+        }
+        return values;
+    }
+
+    static std::string toJSON(const std::vector<double>& values){
+        if(values.size() == 1){
+            return json::number(values[0]);
+        }
+        std::string out = "[";
+        for(size_t i = 0; i < values.size(); i++){
+            out += (i > 0 ? "," : "") + json::number(values[i]);
+        }
+        return out + "]";
+    }
+
+    void set(const std::string& name, const json::value& v){
+        if(v.type != json::value::NUMBER && v.type != json::value::BOOLEAN && v.type != json::value::ARRAY){
+            throw std::runtime_error("value for " + name + " must be a number, bool or list");
+        }
+        if(!this->sim.setParameter(name, toValues(v))){
+            throw std::runtime_error("unknown parameter, wrong number of values or out of range: " + name);
+        }
+    }
+
+    void run(const json::value& command, json::objectWriter& reply){
+        std::string cmd = command.getString("cmd");
+        if(cmd == "ping"){
+            return;
+        }
+        if(cmd == "get"){
+            std::string name = command.getString("name");
+            json::objectWriter params;
+            for(const simulation::main::parameter& p : this->sim.getParameters()){
+                if(name.empty() || name == p.name){
+                    params.addRaw(p.name, toJSON(this->sim.getParameter(p)));
+                }
+            }
+            reply.addRaw("params", params.str());
+            return;
+        }
+        if(cmd == "set"){
+            if(command.has("params")){
+                for(const auto& entry : command["params"].object){
+                    this->set(entry.first, entry.second);
+                }
+            }else{
+                this->set(command.getString("name"), command["value"]);
+            }
+            this->sim.applySettings();
+            return;
+        }
+        if(cmd == "restart"){
+            if(command.has("agents")){ this->set("agentCount", command["agents"]); }
+            if(command.has("resolution")){ this->set("resolution", command["resolution"]); }
+            if(command.has("seed")){ this->set("seed", command["seed"]); }
+            bool restarted = this->sim.restart();
+            this->sim.applySettings();
+            if(!this->sim.getPreflightMessage().empty()){
+                reply.add("message", this->sim.getPreflightMessage());
+            }
+            if(!restarted){
+                throw std::runtime_error("restart refused: " + this->sim.getPreflightMessage());
+            }
+            return;
+        }
+        if(cmd == "step"){
+            long long count = (long long)command.getNumber("count", 1);
+            for(long long i = 0; i < count; i++){
+                this->sim.step();
+            }
+            this->sim.applySettings(); // Picks up any statistics that finished along the way
+            reply.add("steps", this->sim.getStepCount());
+            return;
+        }
+        if(cmd == "frame"){
+            std::string path = command.getString("path");
+            if(path.empty()){
+                throw std::runtime_error("frame needs a path");
+            }
+            simulation::frameExport& exporter = this->sim.getExporter();
+            if(command.getString("region") == "whole"){
+                exporter.setRegion(simulation::frameExport::REGION_WHOLE);
+            }else if(command.has("region")){
+                std::vector<double> r = toValues(command["region"]);
+                if(r.size() != 4){
+                    throw std::runtime_error("region must be [x, y, width, height] or \"whole\"");
+                }
+                exporter.setCustomRegion(r[0], r[1], r[2], r[3]);
+            }
+            if(command.has("width") || command.has("height")){
+                exporter.setOutputSize((int)command.getNumber("width", 0), (int)command.getNumber("height", 0));
+            }
+            this->sim.saveFrame(path);
+            reply.add("path", path);
+            return;
+        }
+        if(cmd == "stats"){
+            const simulation::statistics::result& r = this->sim.measureStatistics();
+            float agents = (r.agentCount > 0)? r.agentCount : 1;
+            float texels = (r.texelCount > 0)? r.texelCount : 1;
+            reply.add("step", this->sim.getStepCount());
+            reply.add("totalDeposit", r.totalDeposit);
+            reply.add("coverage", r.coveredTexels / texels);
+            reply.add("meanHeadingX", r.headingX / agents);
+            reply.add("meanHeadingY", r.headingY / agents);
+            reply.add("meanDepositUnderAgents", r.depositUnderAgents / agents);
+            reply.add("agentsOnTrail", r.agentsOnTrail / agents);
+            return;
+        }
+        if(cmd == "save"){
+            this->sim.getStatistics().flush();
+            return;
+        }
+        if(cmd == "record"){
+            recording::trailRecorder& recorder = this->sim.getRecorder();
+            if(command.getNumber("stop", 0) != 0){
+                recorder.stop();
+                reply.add("frames", recorder.getFramesWritten());
+                return;
+            }
+            if(command.has("path")){ recorder.setPath(command.getString("path")); }
+            if(command.has("interval")){ recorder.setInterval((int)command.getNumber("interval", 10)); }
+            if(command.has("maxDeposit")){ recorder.setMaxDeposit((float)command.getNumber("maxDeposit", 1)); }
+            if(!recorder.start(this->sim.getResolution())){
+                throw std::runtime_error(recorder.getMessage());
+            }
+            reply.add("message", recorder.getMessage());
+            return;
+        }
+        if(cmd == "trace"){
+            recording::agentTracer& tracer = this->sim.getTracer();
+            if(command.getNumber("stop", 0) != 0){
+                tracer.stop();
+                reply.add("steps", tracer.getStepsWritten());
+                reply.add("dropped", tracer.getStepsDropped());
+                return;
+            }
+            if(command.has("path")){ tracer.setPath(command.getString("path")); }
+            if(command.has("ids")){
+                std::vector<uint32_t> ids;
+                for(double id : toValues(command["ids"])){
+                    ids.push_back((uint32_t)id);
+                }
+                tracer.selectList(ids);
+            }else if(command.has("first") || command.has("stride") || command.has("count")){
+                tracer.selectStride((int)command.getNumber("first", 0), (int)command.getNumber("stride", 1000), (int)command.getNumber("count", 256));
+            }
+            if(!tracer.start(this->sim.getAgentCount(), this->sim.getStepCount())){
+                throw std::runtime_error(tracer.getMessage());
+            }
+            reply.add("message", tracer.getMessage());
+            return;
+        }
+        if(cmd == "publish"){
+            simulation::framePublisher& publisher = this->sim.getPublisher();
+            if(command.getNumber("stop", 0) != 0){
+                publisher.stop();
+                reply.add("frames", publisher.getFramesPublished());
+                return;
+            }
+            if(command.has("format")){
+                std::string format = command.getString("format");
+                if(format != "rgba8" && format != "rgba16f"){
+                    throw std::runtime_error("format must be rgba8 or rgba16f");
+                }
+                publisher.setFormat((format == "rgba16f")? simulation::SHARED_RGBA16F : simulation::SHARED_RGBA8);
+            }
+            if(command.has("name")){ publisher.setName(command.getString("name")); }
+            if(command.has("downscale")){ publisher.setDownscale((int)command.getNumber("downscale", 4)); }
+            if(command.has("rate")){ publisher.setRate((float)command.getNumber("rate", 30)); }
+            if(!publisher.start()){
+                throw std::runtime_error(publisher.getMessage());
+            }
+            reply.add("message", publisher.getMessage());
+            return;
+        }
+        if(cmd == "journal"){
+            recording::parameterJournal& journal = this->sim.getJournal();
+            if(!this->sim.saveJournal(command.getString("path"))){
+                throw std::runtime_error(journal.getMessage());
+            }
+            reply.add("entries", journal.getEntries());
+            return;
+        }
+        if(cmd == "quit"){
+            this->quitRequested = true;
+            return;
+        }
+        throw std::runtime_error("unknown command: " + cmd);
+    }
+
+public:
+    controlCommands(simulation::main& sim) : sim(sim){}
+
+    /*
+        Runs one command line and returns the reply line (without the newline)
+    */
+    std::string handle(const std::string& line){
+        json::objectWriter reply;
+        json::value command;
+        try{
+            command = json::parse(line);
+            if(command.type != json::value::OBJECT){
+                throw std::runtime_error("command must be a JSON object");
+            }
+            json::objectWriter result;
+            this->run(command, result);
+            reply.add("ok", true);
+            if(command.has("id")){
+                reply.addRaw("id", (command["id"].type == json::value::STRING)? json::quote(command["id"].string) : json::number(command["id"].number));
+            }
+            std::string fields = result.str();
+            if(fields.size() > 2){ // Append the command's own fields after ok/id
+                std::string head = reply.str();
+                return head.substr(0, head.size() - 1) + "," + fields.substr(1);
+            }
+        }catch(const std::exception& e){
+            reply.add("ok", false);
+            if(command.has("id")){
+                reply.addRaw("id", (command["id"].type == json::value::STRING)? json::quote(command["id"].string) : json::number(command["id"].number));
+            }
+            reply.add("error", e.what());
+        }
+        return reply.str();
+    }
+
+    bool shouldQuit() const{
+        return this->quitRequested;
+    }
+};
+
+}
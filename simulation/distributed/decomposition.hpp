@@ -0,0 +1,221 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <sched.h>
+
+namespace simulation{
+namespace distributed{
+
+    /*
+        The 8 neighbours of a subdomain, in the order their halo strips and mailboxes are stored in shared memory
+    */
+    const int directionCount = 8;
+    const int directionX[directionCount] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    const int directionY[directionCount] = {-1, -1, -1, 0, 0, 1, 1, 1};
+
+    inline int oppositeDirection(int direction){
+        return directionCount - 1 - direction; // The table above is symmetric, so this works out
+    }
+
+
+    /*
+        Splits a square world of worldSize*worldSize texels into ranksX*ranksY equal rectangular subdomains
+        Subdomains on the edges are neighbours of the ones on the opposite edge, so the world still wraps around
+        like loopBounds() in agent.compute.glsl does for a single texture
+    */
+    struct decomposition{
+        int ranksX = 1;
+        int ranksY = 1;
+        int worldSize = 1024;
+        int tileWidth = 1024;
+        int tileHeight = 1024;
+        int halo = 1; // Width of the ghost border around each tile, must cover the sensor distance
+
+        decomposition() = default;
+
+        decomposition(int ranksX, int ranksY, int worldSize, int halo){
+            if(ranksX < 1 || ranksY < 1 || worldSize % ranksX != 0 || worldSize % ranksY != 0){
+                throw std::runtime_error("World size must be divisible by the number of ranks in each direction");
+            }
+            this->ranksX = ranksX;
+            this->ranksY = ranksY;
+            this->worldSize = worldSize;
+            this->tileWidth = worldSize / ranksX;
+            this->tileHeight = worldSize / ranksY;
+            this->halo = halo;
+            if(halo > this->tileWidth || halo > this->tileHeight){
+                throw std::runtime_error("Subdomains are smaller than the halo, use fewer ranks or a smaller sensor distance");
+            }
+        }
+
+        int rankCount() const{ return this->ranksX * this->ranksY; }
+
+        int rankX(int rank) const{ return rank % this->ranksX; }
+        int rankY(int rank) const{ return rank / this->ranksX; }
+
+        int originX(int rank) const{ return this->rankX(rank) * this->tileWidth; }
+        int originY(int rank) const{ return this->rankY(rank) * this->tileHeight; }
+
+        // Size of the texture each rank works on, tile plus halo on every side
+        int localWidth() const{ return this->tileWidth + 2*this->halo; }
+        int localHeight() const{ return this->tileHeight + 2*this->halo; }
+
+        int neighbour(int rank, int direction) const{
+            int x = (this->rankX(rank) + directionX[direction] + this->ranksX) % this->ranksX;
+            int y = (this->rankY(rank) + directionY[direction] + this->ranksY) % this->ranksY;
+            return y*this->ranksX + x;
+        }
+
+        /*
+            Region of the local texture which is sent to the neighbour in a given direction:
+            the strip of interior texels along that side (or the corner block for diagonals)
+        */
+        void sendRegion(int direction, int& x, int& y, int& w, int& h) const{
+            this->region(direction, false, x, y, w, h);
+        }
+
+        /*
+            Region of the local texture which is filled from the neighbour in a given direction (the ghost texels on that side)
+        */
+        void receiveRegion(int direction, int& x, int& y, int& w, int& h) const{
+            this->region(direction, true, x, y, w, h);
+        }
+
+        int regionTexels(int direction) const{
+            int x, y, w, h;
+            this->sendRegion(direction, x, y, w, h);
+            return w*h;
+        }
+
+    private:
+        void region(int direction, bool ghost, int& x, int& y, int& w, int& h) const{
+            int dx = directionX[direction];
+            int dy = directionY[direction];
+            w = (dx == 0)? this->tileWidth : this->halo;
+            h = (dy == 0)? this->tileHeight : this->halo;
+            if(ghost){
+                x = (dx < 0)? 0 : (dx == 0)? this->halo : this->halo + this->tileWidth;
+                y = (dy < 0)? 0 : (dy == 0)? this->halo : this->halo + this->tileHeight;
+            }else{
+                x = (dx <= 0)? this->halo : this->tileWidth; // tileWidth = halo + tileWidth - halo
+                y = (dy <= 0)? this->halo : this->tileHeight;
+            }
+        }
+    };
+
+
+    /*
+        Barrier that lives in shared memory and can be given up on
+        (a pthread barrier would leave every other process stuck forever if one of them crashed)
+    */
+    struct sharedBarrier{
+        std::atomic<int> waiting;
+        std::atomic<int> generation;
+        std::atomic<int> aborted;
+
+        void init(){
+            this->waiting.store(0);
+            this->generation.store(0);
+            this->aborted.store(0);
+        }
+
+        void wait(int participants){
+            int gen = this->generation.load(std::memory_order_acquire);
+            if(this->waiting.fetch_add(1, std::memory_order_acq_rel) == participants - 1){
+                this->waiting.store(0, std::memory_order_relaxed);
+                this->generation.fetch_add(1, std::memory_order_release);
+                return;
+            }
+            while(this->generation.load(std::memory_order_acquire) == gen){
+                if(this->aborted.load(std::memory_order_relaxed)){
+                    throw std::runtime_error("Distributed run aborted by another process");
+                }
+                sched_yield();
+            }
+        }
+
+        void abort(){
+            this->aborted.store(1);
+        }
+    };
+
+
+    /*
+        Everything the ranks share, laid out in one shared memory segment:
+            header | halo strips [rank][parity][direction] | mailboxes [rank][parity][direction] | world frame
+        Each rank only ever writes its own strips and mailboxes. Strips/mailboxes are double buffered on the step parity,
+        which means one barrier per step is enough: nobody can get to writing parity p again until everyone has
+        passed the next barrier, which is after they finished reading parity p.
+    */
+    struct sharedHeader{
+        sharedBarrier barrier;
+        std::atomic<long long> droppedAgents; // Immigrants that didnt fit into the receiving rank's agent buffer
+        std::atomic<long long> aliveAgents; // Summed up by every rank at the end of the run
+    };
+
+    struct mailbox{
+        unsigned int count;
+        unsigned int padding[3];
+        // Followed by count * (x, y, angle, unused), in the sender's local coordinates
+        float* agents(){ return reinterpret_cast<float*>(this + 1); }
+    };
+
+    class sharedLayout{
+        private:
+            decomposition domain;
+            size_t mailboxCapacity = 0;
+            size_t haloStart = 0;
+            size_t mailboxStart = 0;
+            size_t frameStart = 0;
+            size_t total = 0;
+            size_t haloSizes[directionCount];
+            size_t haloOffsets[directionCount]; // Offset of each direction within the strips of one rank/parity
+            size_t halosPerParity = 0;
+
+            static size_t align(size_t x){ return (x + 63) & ~size_t(63); }
+
+        public:
+            sharedLayout() = default;
+
+            sharedLayout(const decomposition& domain, size_t mailboxCapacity, bool withWorldFrame){
+                this->domain = domain;
+                this->mailboxCapacity = mailboxCapacity;
+                for(int d = 0; d < directionCount; d++){
+                    this->haloSizes[d] = sizeof(float) * 4 * domain.regionTexels(d);
+                    this->haloOffsets[d] = this->halosPerParity;
+                    this->halosPerParity += align(this->haloSizes[d]);
+                }
+                this->haloStart = align(sizeof(sharedHeader));
+                this->mailboxStart = this->haloStart + this->halosPerParity * 2 * domain.rankCount();
+                this->frameStart = this->mailboxStart + this->mailboxBytes() * directionCount * 2 * domain.rankCount();
+                this->total = this->frameStart;
+                if(withWorldFrame){
+                    this->total += sizeof(float) * 4 * (size_t)domain.worldSize * domain.worldSize;
+                }
+            }
+
+            size_t mailboxBytes() const{
+                return align(sizeof(mailbox) + sizeof(float) * 4 * this->mailboxCapacity);
+            }
+
+            size_t getMailboxCapacity() const{ return this->mailboxCapacity; }
+            size_t size() const{ return this->total; }
+            size_t header() const{ return 0; }
+            size_t frame() const{ return this->frameStart; }
+
+            size_t halo(int rank, int parity, int direction) const{
+                return this->haloStart + this->halosPerParity * (rank*2 + parity) + this->haloOffsets[direction];
+            }
+
+            size_t haloSize(int direction) const{
+                return this->haloSizes[direction];
+            }
+
+            size_t box(int rank, int parity, int direction) const{
+                return this->mailboxStart + this->mailboxBytes() * ((rank*2 + parity)*directionCount + direction);
+            }
+    };
+
+}
+}
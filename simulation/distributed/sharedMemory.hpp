@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace simulation{
+namespace distributed{
+
+    /*
+        POSIX shared memory segment (shows up in /dev/shm)
+        The process which creates it also unlinks it when destroyed, processes which attach only unmap it
+    */
+    class sharedMemory{
+        private:
+            std::string name;
+            void* data = nullptr;
+            size_t size = 0;
+            bool owner = false;
+
+            void map(int fd, size_t size){
+                this->data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if(this->data == MAP_FAILED){
+                    this->data = nullptr;
+                    throw std::runtime_error("Error mapping shared memory " + this->name);
+                }
+                this->size = size;
+            }
+
+        public:
+            sharedMemory() = default;
+            sharedMemory(const sharedMemory&) = delete;
+            sharedMemory& operator=(const sharedMemory&) = delete;
+
+            ~sharedMemory(){
+                this->release();
+            }
+
+            /*
+                Creates a new zeroed segment, replacing any stale one with the same name
+            */
+            void create(const std::string& name, size_t size){
+                this->release();
+                this->name = name;
+                shm_unlink(name.c_str());
+                int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+                if(fd == -1){
+                    throw std::runtime_error("Error creating shared memory " + name);
+                }
+                if(ftruncate(fd, size) != 0){
+                    close(fd);
+                    shm_unlink(name.c_str());
+                    throw std::runtime_error("Error resizing shared memory " + name);
+                }
+                this->owner = true;
+                this->map(fd, size);
+            }
+
+            /*
+                Maps an existing segment created by another process
+            */
+            void attach(const std::string& name, bool readOnly=false){
+                this->release();
+                this->name = name;
+                int fd = shm_open(name.c_str(), readOnly ? O_RDONLY : O_RDWR, 0);
+                if(fd == -1){
+                    throw std::runtime_error("Error opening shared memory " + name);
+                }
+                struct stat info;
+                if(fstat(fd, &info) != 0){
+                    close(fd);
+                    throw std::runtime_error("Error reading size of shared memory " + name);
+                }
+                this->data = mmap(nullptr, info.st_size, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if(this->data == MAP_FAILED){
+                    this->data = nullptr;
+                    throw std::runtime_error("Error mapping shared memory " + name);
+                }
+                this->size = info.st_size;
+            }
+
+            void release(){
+                if(this->data != nullptr){
+                    munmap(this->data, this->size);
+                    this->data = nullptr;
+                }
+                if(this->owner){
+                    shm_unlink(this->name.c_str());
+                    this->owner = false;
+                }
+                this->size = 0;
+            }
+
+            template<typename T>
+            T* at(size_t offset) const{
+                return reinterpret_cast<T*>(static_cast<char*>(this->data) + offset);
+            }
+
+            size_t getSize() const{
+                return this->size;
+            }
+
+            const std::string& getName() const{
+                return this->name;
+            }
+    };
+
+}
+}
@@ -0,0 +1,313 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <string>
+#include <cmath>
+#include <iostream>
+
+
+#include "../OpenGLComponents/simulationTexture.hpp"
+#include "../OpenGLComponents/computeShader.hpp"
+#include "../OpenGLComponents/SSBO.hpp"
+#include "../encoding/frameWriter.hpp"
+#include "decomposition.hpp"
+#include "sharedMemory.hpp"
+
+// ! Important, these must be the same as the compute shader group sizes
+#define DF_GROUPSIZE 32
+#define AG_GROUPSIZE 1024
+
+namespace simulation{
+namespace distributed{
+
+    /*
+        Settings for a distributed run, these are fixed for the whole run since every rank has to agree on them
+        Defaults are the same as simulation::main
+    */
+    struct settings{
+        int agentCount = 100000;
+        int steps = 1000;
+        int exportInterval = 0; // 0 = dont export frames
+        unsigned int seed = 0;
+        float sensorDistance = 60;
+        float sensorAngle = 1.5;
+        float turnSpeed = 2;
+        float speed = 1;
+        float diffuse = 0.7;
+        float fade = 0.1;
+        float mainAgentColour[3] = {0.0f, 0.1f, 0.9f};
+        float agentXDirectionColour[3] = {0.0f, 0.7f, 0.2f};
+        float agentYDirectionColour[3] = {0.0f, 0.1f, 0.8f};
+
+        // Halo has to cover everything an agent in the interior can sense or reach in one step, plus the diffuse stencil
+        int haloWidth() const{
+            return (int)std::ceil(std::max(this->sensorDistance, this->speed)) + 2;
+        }
+    };
+
+
+    /*
+        Simulates one subdomain of the world in its own process/GL context
+        The local texture is the tile plus a halo on every side. Each step:
+            1. diffuse + agents run exactly like the single texture version, except agents leaving the interior are
+               removed from the agent buffer and written to the emigrant buffer instead
+            2. emigrants are sorted into this rank's mailboxes and the interior edges are copied into its halo strips
+            3. barrier
+            4. neighbours' strips are copied into the halo, neighbours' mailboxes are put into free agent slots
+    */
+    class worker{
+        private:
+            struct agent{
+                float xPos = 0;
+                float yPos = 0;
+                float angle = 0;
+                float alive = 1; // Negative = empty slot, see agent.compute.glsl
+            };
+
+            int rank;
+            decomposition domain;
+            sharedLayout layout;
+            settings config;
+            sharedMemory& shm;
+            sharedHeader* header;
+
+            int agentCapacity; // Agent buffer has room for more agents than the rank starts with so immigrants have somewhere to go
+            int emigrantCapacity;
+            std::vector<agent> agentData;
+            std::vector<int> freeSlots;
+            std::vector<agent> emigrants;
+
+            openGLComponents::simulationTexture simTexture;
+            openGLComponents::computeShader agentComputeShader;
+            openGLComponents::computeShader diffuseFadeShader;
+            openGLComponents::SSBO agentSSBO;
+            openGLComponents::SSBO emigrantSSBO;
+            encoding::frameWriter frameWriter; // Only used by rank 0
+
+            static int directionOf(int dx, int dy){
+                for(int d = 0; d < directionCount; d++){
+                    if(directionX[d] == dx && directionY[d] == dy){
+                        return d;
+                    }
+                }
+                return -1;
+            }
+
+            void generateAgents(){
+                int startCount = this->config.agentCount / this->domain.rankCount();
+                if(this->rank < this->config.agentCount % this->domain.rankCount()){
+                    startCount++;
+                }
+                this->agentCapacity = startCount*2 + 1024;
+                this->emigrantCapacity = startCount/4 + 1024;
+                std::mt19937 gen(this->config.seed == 0 ? std::random_device()() : this->config.seed + this->rank);
+                std::uniform_real_distribution<> dis(0, 1);
+                this->agentData.assign(this->agentCapacity, agent());
+                this->freeSlots.clear();
+                for(int i = 0; i < this->agentCapacity; i++){
+                    if(i < startCount){
+                        this->agentData[i].xPos = this->domain.halo + dis(gen) * this->domain.tileWidth; // Random position across the interior
+                        this->agentData[i].yPos = this->domain.halo + dis(gen) * this->domain.tileHeight;
+                        this->agentData[i].angle = dis(gen) * 2 * 3.14159265359;
+                    }else{
+                        this->agentData[i].alive = -1;
+                        this->freeSlots.push_back(i);
+                    }
+                }
+            }
+
+            void setUniforms(){
+                this->agentComputeShader.use();
+                this->agentComputeShader.setUniform1i("size", this->domain.worldSize);
+                this->agentComputeShader.setUniform1i("domainMode", 1);
+                this->agentComputeShader.setUniform4i("domainInterior", this->domain.halo, this->domain.halo, this->domain.halo + this->domain.tileWidth, this->domain.halo + this->domain.tileHeight);
+                this->agentComputeShader.setUniform1f("sensorDistance", this->config.sensorDistance);
+                this->agentComputeShader.setUniform1f("sensorAngle", this->config.sensorAngle);
+                this->agentComputeShader.setUniform1f("turnSpeed", this->config.turnSpeed);
+                this->agentComputeShader.setUniform1f("speed", this->config.speed);
+                this->agentComputeShader.setUniform1i("drawSensors", 0);
+                this->agentComputeShader.setUniform3f("mainAgentColour", this->config.mainAgentColour[0], this->config.mainAgentColour[1], this->config.mainAgentColour[2]);
+                this->agentComputeShader.setUniform3f("agentXDirectionColour", this->config.agentXDirectionColour[0], this->config.agentXDirectionColour[1], this->config.agentXDirectionColour[2]);
+                this->agentComputeShader.setUniform3f("agentYDirectionColour", this->config.agentYDirectionColour[0], this->config.agentYDirectionColour[1], this->config.agentYDirectionColour[2]);
+                this->diffuseFadeShader.use();
+                this->diffuseFadeShader.setUniform1f("diffuse", this->config.diffuse);
+                this->diffuseFadeShader.setUniform1f("fade", this->config.fade);
+            }
+
+            /*
+                Reads back the agents which left the interior this step and posts them to the neighbours
+            */
+            void sendAgents(int parity){
+                mailbox* boxes[directionCount];
+                for(int d = 0; d < directionCount; d++){
+                    boxes[d] = this->shm.at<mailbox>(this->layout.box(this->rank, parity, d));
+                    boxes[d]->count = 0;
+                }
+                unsigned int count = 0;
+                GLCall(glGetNamedBufferSubData(this->emigrantSSBO.getID(), 0, sizeof(unsigned int), &count));
+                if(count == 0){
+                    return;
+                }
+                count = (count > (unsigned int)this->emigrantCapacity)? this->emigrantCapacity : count;
+                GLCall(glGetNamedBufferSubData(this->emigrantSSBO.getID(), sizeof(unsigned int)*4, sizeof(agent)*count, this->emigrants.data()));
+                unsigned int zero = 0;
+                GLCall(glNamedBufferSubData(this->emigrantSSBO.getID(), 0, sizeof(unsigned int), &zero));
+
+                int x0 = this->domain.halo;
+                int y0 = this->domain.halo;
+                int x1 = this->domain.halo + this->domain.tileWidth;
+                int y1 = this->domain.halo + this->domain.tileHeight;
+                for(unsigned int i = 0; i < count; i++){
+                    agent& e = this->emigrants[i];
+                    int slot = (int)e.alive; // The shader stores which slot the agent came from in the last float
+                    this->freeSlots.push_back(slot);
+                    int dx = (e.xPos < x0)? -1 : (e.xPos >= x1)? 1 : 0;
+                    int dy = (e.yPos < y0)? -1 : (e.yPos >= y1)? 1 : 0;
+                    mailbox* box = boxes[directionOf(dx, dy)];
+                    if(box->count < this->layout.getMailboxCapacity()){
+                        float* out = box->agents() + 4*box->count;
+                        out[0] = e.xPos;
+                        out[1] = e.yPos;
+                        out[2] = e.angle;
+                        out[3] = 1;
+                        box->count++;
+                    }else{
+                        // Mailbox is full, so the agent stays here on the edge of the interior
+                        e.xPos = std::fmin(std::fmax(e.xPos, (float)x0), x1 - 0.001f);
+                        e.yPos = std::fmin(std::fmax(e.yPos, (float)y0), y1 - 0.001f);
+                        this->insertAgent(e);
+                    }
+                }
+            }
+
+            void receiveAgents(int parity){
+                for(int d = 0; d < directionCount; d++){
+                    // The neighbour in direction d sent these in the opposite direction (towards us)
+                    mailbox* box = this->shm.at<mailbox>(this->layout.box(this->domain.neighbour(this->rank, d), parity, oppositeDirection(d)));
+                    const float* in = box->agents();
+                    for(unsigned int i = 0; i < box->count; i++){
+                        agent a;
+                        a.xPos = in[4*i+0] + directionX[d] * this->domain.tileWidth; // Their local coordinates -> ours
+                        a.yPos = in[4*i+1] + directionY[d] * this->domain.tileHeight;
+                        a.angle = in[4*i+2];
+                        a.alive = 1;
+                        if(!this->insertAgent(a)){
+                            this->header->droppedAgents.fetch_add(1);
+                        }
+                    }
+                }
+            }
+
+            bool insertAgent(const agent& a){
+                if(this->freeSlots.empty()){
+                    return false;
+                }
+                int slot = this->freeSlots.back();
+                this->freeSlots.pop_back();
+                GLCall(glNamedBufferSubData(this->agentSSBO.getID(), sizeof(agent)*slot, sizeof(agent), &a));
+                return true;
+            }
+
+            void sendHalos(int parity){
+                for(int d = 0; d < directionCount; d++){
+                    int x, y, w, h;
+                    this->domain.sendRegion(d, x, y, w, h);
+                    GLCall(glGetTextureSubImage(this->simTexture.getID(), 0, x, y, 0, w, h, 1, GL_RGBA, GL_FLOAT, this->layout.haloSize(d), this->shm.at<float>(this->layout.halo(this->rank, parity, d))));
+                }
+            }
+
+            void receiveHalos(int parity){
+                for(int d = 0; d < directionCount; d++){
+                    int x, y, w, h;
+                    this->domain.receiveRegion(d, x, y, w, h);
+                    const float* strip = this->shm.at<float>(this->layout.halo(this->domain.neighbour(this->rank, d), parity, oppositeDirection(d)));
+                    GLCall(glTextureSubImage2D(this->simTexture.getID(), 0, x, y, w, h, GL_RGBA, GL_FLOAT, strip));
+                }
+            }
+
+        public:
+            worker(int rank, const decomposition& domain, const sharedLayout& layout, const settings& config, sharedMemory& shm)
+                : rank(rank), domain(domain), layout(layout), config(config), shm(shm){
+                this->header = shm.at<sharedHeader>(layout.header());
+            }
+
+            /*
+                Assumes a GL context is current on this thread
+            */
+            void setup(){
+                this->simTexture.init(this->domain.localWidth(), this->domain.localHeight());
+                this->simTexture.clear();
+                this->simTexture.bind();
+
+                this->agentComputeShader.createShaderFromDisk("GLSL/agent.compute.glsl");
+                this->diffuseFadeShader.createShaderFromDisk("GLSL/diffuseFade.compute.glsl");
+                this->setUniforms();
+
+                this->generateAgents();
+                this->agentSSBO.generate(this->agentData);
+                this->agentSSBO.bind(this->agentComputeShader.getID(), "agentData", 0);
+                this->emigrants.assign(this->emigrantCapacity + 1, agent()); // First element is the counter + padding
+                this->emigrants[0] = agent{0, 0, 0, 0};
+                this->emigrantSSBO.generate(this->emigrants);
+                this->emigrantSSBO.bind(this->agentComputeShader.getID(), "emigrantData", 3);
+
+                std::string name = "Rank " + std::to_string(this->rank);
+                GLObjectLabel(GL_TEXTURE, this->simTexture.getID(), (name + " texture").c_str());
+                GLObjectLabel(GL_BUFFER, this->agentSSBO.getID(), (name + " agent SSBO").c_str());
+                GLObjectLabel(GL_BUFFER, this->emigrantSSBO.getID(), (name + " emigrant SSBO").c_str());
+            }
+
+            void step(int stepIndex){
+                GLDebugGroup("Distributed step");
+                int parity = stepIndex & 1;
+                this->simTexture.bind();
+                {
+                    GLDebugGroup("Diffuse/fade");
+                    this->diffuseFadeShader.execute((this->domain.localWidth()+DF_GROUPSIZE-1)/DF_GROUPSIZE, (this->domain.localHeight()+DF_GROUPSIZE-1)/DF_GROUPSIZE, 1);
+                }
+                {
+                    GLDebugGroup("Agents");
+                    this->agentComputeShader.execute((this->agentCapacity+AG_GROUPSIZE-1)/AG_GROUPSIZE, 1, 1);
+                    GLCall(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT));
+                }
+                {
+                    GLDebugGroup("Halo exchange");
+                    this->sendAgents(parity);
+                    this->sendHalos(parity);
+                    this->header->barrier.wait(this->domain.rankCount());
+                    this->receiveHalos(parity);
+                    this->receiveAgents(parity);
+                }
+            }
+
+            /*
+                Every rank copies its interior into the shared world frame, then rank 0 writes it to disk
+                Needs the layout to have been created with a world frame
+            */
+            void exportFrame(int frameIndex){
+                GLDebugGroup("Export frame");
+                float* frame = this->shm.at<float>(this->layout.frame());
+                size_t offset = 4 * ((size_t)this->domain.originY(this->rank) * this->domain.worldSize + this->domain.originX(this->rank));
+                size_t available = sizeof(float) * 4 * (size_t)this->domain.worldSize * this->domain.worldSize - sizeof(float)*offset;
+                GLCall(glPixelStorei(GL_PACK_ROW_LENGTH, this->domain.worldSize)); // Write the rows straight into place in the world frame
+                GLCall(glGetTextureSubImage(this->simTexture.getID(), 0, this->domain.halo, this->domain.halo, 0, this->domain.tileWidth, this->domain.tileHeight, 1, GL_RGBA, GL_FLOAT, available, frame + offset));
+                GLCall(glPixelStorei(GL_PACK_ROW_LENGTH, 0));
+                this->header->barrier.wait(this->domain.rankCount());
+                if(this->rank == 0){
+                    this->frameWriter.writeFloat("animFrame_" + std::to_string(frameIndex) + "." + this->frameWriter.extension(), frame, this->domain.worldSize, this->domain.worldSize);
+                }
+            }
+
+            int countAliveAgents(){
+                GLCall(glGetNamedBufferSubData(this->agentSSBO.getID(), 0, sizeof(agent)*this->agentCapacity, this->agentData.data()));
+                int alive = 0;
+                for(const agent& a : this->agentData){
+                    alive += (a.alive >= 0)? 1 : 0;
+                }
+                return alive;
+            }
+    };
+
+}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace encoding{
+
+    /*
+        Something that can write an 8 bit RGBA frame (width*height*4 bytes, top row first) to a file
+    */
+    class frameEncoder{
+        public:
+            virtual ~frameEncoder() = default;
+            virtual const char* extension() const = 0; // Without the dot
+            virtual bool write(const std::string& path, const uint8_t* rgba, int width, int height) = 0;
+    };
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "frameEncoder.hpp"
+#include "pixelConversion.hpp"
+#include "qoiEncoder.hpp"
+#include "pngEncoder.hpp"
+
+namespace encoding{
+
+    // Names which can be passed to makeEncoder()/frameWriter::setFormat(), in the order shown in the UI
+    inline std::vector<std::string> availableFormats(){
+    #if GLSLSLIME_HAVE_OPENCV
+        return {"qoi", "png"};
+    #else
+        return {"qoi"};
+    #endif
+    }
+
+    inline std::unique_ptr<frameEncoder> makeEncoder(const std::string& format){
+        if(format == "qoi"){
+            return std::unique_ptr<frameEncoder>(new qoiEncoder());
+        }
+    #if GLSLSLIME_HAVE_OPENCV
+        if(format == "png"){
+            return std::unique_ptr<frameEncoder>(new pngEncoder());
+        }
+    #endif
+        return nullptr;
+    }
+
+    inline std::string formatList(){
+        std::string list;
+        for(const std::string& format : availableFormats()){
+            list += (list.empty() ? "" : ", ") + format;
+        }
+        return list;
+    }
+
+    /*
+        Converts float frames read back from the GPU to 8 bit and hands them to an encoder, keeping the buffers around between frames
+        The format is picked from the file extension, paths without one get the default format
+    */
+    class frameWriter{
+        private:
+            std::string format;
+            std::unique_ptr<frameEncoder> encoder;
+            std::string otherFormat; // For paths with the extension of a different format than the default
+            std::unique_ptr<frameEncoder> otherEncoder;
+            std::vector<uint8_t> rgba;
+            int threads = defaultThreadCount();
+            stripWorkers workers;
+
+            frameEncoder* encoderForPath(const std::string& path){
+                size_t dot = path.find_last_of('.');
+                size_t slash = path.find_last_of("/\\");
+                if(dot == std::string::npos || (slash != std::string::npos && slash > dot) || dot + 1 == path.size() || path.compare(dot + 1, std::string::npos, this->format) == 0){
+                    return this->encoder.get(); // Compared in place, this runs for every frame
+                }
+                if(path.compare(dot + 1, std::string::npos, this->otherFormat) != 0){
+                    std::string extension = path.substr(dot + 1);
+                    std::unique_ptr<frameEncoder> other = makeEncoder(extension);
+                    if(other == nullptr){
+                        throw std::runtime_error("Can't write ." + extension + " frames, available formats are: " + formatList());
+                    }
+                    this->otherEncoder = std::move(other);
+                    this->otherFormat = extension;
+                }
+                return this->otherEncoder.get();
+            }
+
+        public:
+            frameWriter(const std::string& format=availableFormats().back()){
+                this->setFormat(format);
+            }
+
+            // Returns false (and keeps the current format) if the format isnt available in this build
+            bool setFormat(const std::string& format){
+                std::unique_ptr<frameEncoder> newEncoder = makeEncoder(format);
+                if(newEncoder == nullptr){
+                    return false;
+                }
+                this->encoder = std::move(newEncoder);
+                this->format = format;
+                return true;
+            }
+
+            // Throws if frames with this path cant be written, so callers can refuse them before any work is done
+            void checkPath(const std::string& path){
+                this->encoderForPath(path);
+            }
+
+            const std::string& getFormat() const{
+                return this->format;
+            }
+
+            const char* extension() const{
+                return this->encoder->extension();
+            }
+
+            bool writeRGBA8(const std::string& path, const uint8_t* pixels, int width, int height){
+                return this->encoderForPath(path)->write(path, pixels, width, height);
+            }
+
+            bool writeFloat(const std::string& path, const float* pixels, int width, int height){
+                this->rgba.resize((size_t)width * height * 4);
+                floatToRGBA8(pixels, this->rgba.data(), width, height, this->workers, this->threads);
+                return this->writeRGBA8(path, this->rgba.data(), width, height);
+            }
+    };
+
+}
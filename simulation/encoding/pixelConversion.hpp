@@ -0,0 +1,140 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GLSLSLIME_SSE2 1
+#endif
+
+namespace encoding{
+
+    /*
+        Converts RGBA floats (0-1, as read back from the simulation texture) to 8 bit RGBA, rounding and clamping like opencv does
+        SSE2 does 4 pixels at a time, anything left over (or on other CPUs) goes through the plain loop
+    */
+    inline void floatToRGBA8(const float* source, uint8_t* destination, size_t pixels){
+        size_t values = pixels * 4;
+        size_t i = 0;
+    #ifdef GLSLSLIME_SSE2
+        const __m128 scale = _mm_set1_ps(255.0f);
+        for(; i + 16 <= values; i += 16){
+            __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + i), scale)); // Rounds to nearest
+            __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + i + 4), scale));
+            __m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + i + 8), scale));
+            __m128i d = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(source + i + 12), scale));
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)); // Both packs saturate, so this clamps to 0-255 as well
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), packed);
+        }
+    #endif
+        for(; i < values; i++){
+            float v = source[i] * 255.0f + 0.5f;
+            destination[i] = !(v > 0.0f)? 0 : (v >= 255.0f)? 255 : (uint8_t)v; // NaN ends up as 0 like it does with SSE2
+        }
+    }
+
+    inline int defaultThreadCount(){
+        unsigned int n = std::thread::hardware_concurrency();
+        return (n == 0)? 4 : (int)n;
+    }
+
+    /*
+        Splits rows [0, height) into strips and runs work(firstRow, lastRow, strip) for each one at the same time
+        The threads are started the first time they are needed and then wait for the next frame, starting new threads
+        every frame allocated (and took longer than converting a small frame). The calling thread does strip 0
+        One frame at a time, run() returns once every strip is done
+    */
+    class stripWorkers{
+        private:
+            std::vector<std::thread> threads; // Thread i does strip i + 1
+            std::mutex mutex;
+            std::condition_variable wake;
+            std::condition_variable done;
+            void (*call)(const void*, int, int, int) = nullptr;
+            const void* work = nullptr;
+            int height = 0;
+            int strips = 0;
+            int remaining = 0; // Strips other threads are still working on
+            unsigned long long generation = 0; // Bumped for every frame
+            bool quit = false;
+
+            int firstRow(int s) const{
+                return (int)((long long)this->height * s / this->strips);
+            }
+
+            void loop(int s){
+                unsigned long long seen = 0;
+                std::unique_lock<std::mutex> lock(this->mutex);
+                while(true){
+                    this->wake.wait(lock, [&](){ return this->quit || this->generation != seen; });
+                    if(this->quit){
+                        return;
+                    }
+                    seen = this->generation;
+                    if(s >= this->strips){
+                        continue; // Fewer strips than threads this frame
+                    }
+                    int first = this->firstRow(s);
+                    int last = this->firstRow(s + 1);
+                    lock.unlock();
+                    this->call(this->work, first, last, s);
+                    lock.lock();
+                    if(--this->remaining == 0){
+                        this->done.notify_one();
+                    }
+                }
+            }
+
+        public:
+            stripWorkers() = default;
+            stripWorkers(const stripWorkers&) = delete;
+            stripWorkers& operator=(const stripWorkers&) = delete;
+
+            ~stripWorkers(){
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    this->quit = true;
+                }
+                this->wake.notify_all();
+                for(std::thread& t : this->threads){
+                    t.join();
+                }
+            }
+
+            template<typename F>
+            void run(int height, int strips, const F& work){
+                strips = (strips < 1)? 1 : (strips > height)? height : strips;
+                if(strips <= 1){
+                    work(0, height, 0);
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    this->call = [](const void* w, int first, int last, int s){ (*static_cast<const F*>(w))(first, last, s); };
+                    this->work = &work;
+                    this->height = height;
+                    this->strips = strips;
+                    this->remaining = strips - 1;
+                    this->generation++;
+                }
+                while((int)this->threads.size() < strips - 1){ // Only more threads than ever before allocates
+                    this->threads.emplace_back(&stripWorkers::loop, this, (int)this->threads.size() + 1);
+                }
+                this->wake.notify_all();
+                work(0, this->firstRow(1), 0);
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->done.wait(lock, [&](){ return this->remaining == 0; });
+            }
+    };
+
+    inline void floatToRGBA8(const float* source, uint8_t* destination, int width, int height, stripWorkers& workers, int threads){
+        workers.run(height, threads, [&](int first, int last, int){
+            floatToRGBA8(source + (size_t)first * width * 4, destination + (size_t)first * width * 4, (size_t)(last - first) * width);
+        });
+    }
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#if GLSLSLIME_HAVE_OPENCV
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "frameEncoder.hpp"
+
+namespace encoding{
+
+    /*
+        PNG through opencv, this is what frames were always written with before the qoi encoder
+        It is single threaded and a lot slower, but png is what most things expect
+    */
+    class pngEncoder : public frameEncoder{
+        private:
+            cv::Mat bgra;
+            std::vector<int> params = {cv::IMWRITE_PNG_COMPRESSION, 3}; // 3 is opencv's default, 0-9
+
+        public:
+            const char* extension() const override{
+                return "png";
+            }
+
+            void setCompressionLevel(int level){
+                this->params[1] = level;
+            }
+
+            bool write(const std::string& path, const uint8_t* rgba, int width, int height) override{
+                cv::Mat img(height, width, CV_8UC4, const_cast<uint8_t*>(rgba)); // Only a header, the pixels arent copied
+                cv::cvtColor(img, this->bgra, cv::COLOR_RGBA2BGRA);
+                return cv::imwrite(path, this->bgra, this->params); // Allocates inside opencv whatever we do, qoi doesnt
+            }
+    };
+
+}
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "frameEncoder.hpp"
+#include "pixelConversion.hpp"
+
+namespace encoding{
+
+    /*
+        QOI (https://qoiformat.org) encoder which splits the frame into horizontal strips and encodes them on separate threads
+
+        The output is a normal QOI file that any decoder can read. It works because each strip is encoded as if it was the
+        start of a new image, with two differences:
+            - the first pixel of a strip is always written as an explicit RGBA op, so it doesnt depend on the previous pixel
+            - an index entry is only used once this strip has written it, so it doesnt depend on the previous strip either
+              (the decoder will have exactly the same pixel in that slot, since both sides update it for every pixel)
+        Runs are also ended at the end of every strip. This costs a handful of bytes per strip.
+    */
+    class qoiEncoder : public frameEncoder{
+        private:
+            struct pixel{
+                uint8_t r, g, b, a;
+                bool operator==(const pixel& o) const{ return r == o.r && g == o.g && b == o.b && a == o.a; }
+            };
+
+            std::vector<std::vector<uint8_t>> strips; // Kept between frames so they dont have to be reallocated
+            std::vector<size_t> sizes; // Encoded bytes in each strip
+            std::vector<uint8_t> fileData;
+            int threads = defaultThreadCount();
+            stripWorkers workers;
+
+            static int hash(const pixel& p){
+                return (p.r*3 + p.g*5 + p.b*7 + p.a*11) % 64;
+            }
+
+            static size_t encodeStrip(const pixel* pixels, size_t count, uint8_t* out){
+                pixel index[64] = {};
+                bool valid[64] = {};
+                size_t n = 0;
+                int run = 0;
+                pixel prev = pixels[0];
+                out[n++] = 0xFF; // QOI_OP_RGBA
+                out[n++] = prev.r;
+                out[n++] = prev.g;
+                out[n++] = prev.b;
+                out[n++] = prev.a;
+                index[hash(prev)] = prev;
+                valid[hash(prev)] = true;
+
+                for(size_t i = 1; i < count; i++){
+                    pixel px = pixels[i];
+                    if(px == prev){
+                        run++;
+                        if(run == 62){
+                            out[n++] = 0xC0 | (run - 1); // QOI_OP_RUN
+                            run = 0;
+                        }
+                        continue;
+                    }
+                    if(run > 0){
+                        out[n++] = 0xC0 | (run - 1);
+                        run = 0;
+                    }
+                    int h = hash(px);
+                    if(valid[h] && index[h] == px){
+                        out[n++] = h; // QOI_OP_INDEX
+                    }else{
+                        index[h] = px;
+                        valid[h] = true;
+                        if(px.a == prev.a){
+                            int8_t dr = px.r - prev.r;
+                            int8_t dg = px.g - prev.g;
+                            int8_t db = px.b - prev.b;
+                            int8_t drdg = dr - dg;
+                            int8_t dbdg = db - dg;
+                            if(dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2){
+                                out[n++] = 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2); // QOI_OP_DIFF
+                            }else if(drdg > -9 && drdg < 8 && dg > -33 && dg < 32 && dbdg > -9 && dbdg < 8){
+                                out[n++] = 0x80 | (dg + 32); // QOI_OP_LUMA
+                                out[n++] = (drdg + 8) << 4 | (dbdg + 8);
+                            }else{
+                                out[n++] = 0xFE; // QOI_OP_RGB
+                                out[n++] = px.r;
+                                out[n++] = px.g;
+                                out[n++] = px.b;
+                            }
+                        }else{
+                            out[n++] = 0xFF;
+                            out[n++] = px.r;
+                            out[n++] = px.g;
+                            out[n++] = px.b;
+                            out[n++] = px.a;
+                        }
+                    }
+                    prev = px;
+                }
+                if(run > 0){
+                    out[n++] = 0xC0 | (run - 1);
+                }
+                return n;
+            }
+
+            static void putBigEndian(uint8_t* out, uint32_t v){
+                out[0] = v >> 24;
+                out[1] = v >> 16;
+                out[2] = v >> 8;
+                out[3] = v;
+            }
+
+        public:
+            const char* extension() const override{
+                return "qoi";
+            }
+
+            void setThreads(int threads){
+                this->threads = (threads < 1)? 1 : threads;
+            }
+
+            /*
+                Encodes into memory, used by write() and handy for benchmarking without touching the disk
+            */
+            void encode(const uint8_t* rgba, int width, int height, std::vector<uint8_t>& out){
+                int stripCount = (height < this->threads)? height : this->threads;
+                this->strips.resize(stripCount);
+                this->sizes.resize(stripCount);
+                const pixel* pixels = reinterpret_cast<const pixel*>(rgba);
+                this->workers.run(height, stripCount, [&](int first, int last, int s){
+                    size_t count = (size_t)(last - first) * width;
+                    this->strips[s].resize(count * 5 + 5); // Worst case, every pixel is an RGBA op
+                    this->sizes[s] = encodeStrip(pixels + (size_t)first * width, count, this->strips[s].data());
+                });
+
+                size_t total = 14 + 8;
+                for(int s = 0; s < stripCount; s++){
+                    total += this->sizes[s];
+                }
+                out.reserve(14 + 8 + (size_t)width * height * 5 + 5 * stripCount); // Worst case, so frames that compress worse than the last dont reallocate
+                out.resize(total);
+                std::memcpy(out.data(), "qoif", 4);
+                putBigEndian(&out[4], width);
+                putBigEndian(&out[8], height);
+                out[12] = 4; // RGBA
+                out[13] = 0; // sRGB with linear alpha
+                size_t offset = 14;
+                for(int s = 0; s < stripCount; s++){
+                    std::memcpy(&out[offset], this->strips[s].data(), this->sizes[s]);
+                    offset += this->sizes[s];
+                }
+                static const uint8_t end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+                std::memcpy(&out[offset], end, 8);
+            }
+
+            bool write(const std::string& path, const uint8_t* rgba, int width, int height) override{
+                if(width <= 0 || height <= 0){
+                    return false;
+                }
+                this->encode(rgba, width, height, this->fileData);
+                FILE* file = std::fopen(path.c_str(), "wb");
+                if(file == nullptr){
+                    return false;
+                }
+                bool ok = std::fwrite(this->fileData.data(), 1, this->fileData.size(), file) == this->fileData.size();
+                return std::fclose(file) == 0 && ok;
+            }
+    };
+
+}
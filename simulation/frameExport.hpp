@@ -0,0 +1,272 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include <glad/gl.h>
+#include <imgui.h>
+
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/asyncReadback.hpp"
+#include "OpenGLComponents/memoryTracker.hpp"
+#include "encoding/frameWriter.hpp"
+
+#define EX_GROUPSIZE 16 // ! Must be the same as the group size in exportFrame.compute.glsl
+
+namespace simulation{
+
+/*
+    Exports frames at a chosen size from a chosen part of the simulation texture
+    The crop, scaling and conversion to 8 bit happen in exportFrame.compute.glsl, and only the finished frame
+    comes back through an asyncReadback, so exporting a 1080p video of an 8192x8192 simulation reads back 8MB a frame instead of 1GB
+
+    request() doesnt wait for the GPU, the frame gets written by a later poll() (or flush() when it is needed right away)
+*/
+class frameExport{
+public:
+    enum region{ REGION_WHOLE = 0, REGION_VIEW = 1, REGION_CUSTOM = 2 };
+
+    // What the window currently shows, as passed to quadShader.vert.glsl
+    struct view{
+        float offsetX = 0;
+        float offsetY = 0;
+        float zoomMultiplier = 1;
+        float textureRatio = 1;
+    };
+
+    struct rectangle{
+        float x = 0;
+        float y = 0;
+        float width = 0;
+        float height = 0;
+    };
+
+private:
+    /*
+        Settings
+    */
+    int regionMode = REGION_WHOLE;
+    float custom[4] = {0, 0, 1024, 1024}; // x, y, width, height in texels, REGION_CUSTOM only
+    int outputWidth = 0; // 0 = worked out from the crop and the other size, both 0 = one pixel per texel
+    int outputHeight = 0;
+
+
+    /*
+        OpenGL components
+    */
+    openGLComponents::computeShader shader;
+    openGLComponents::asyncReadback readback;
+    unsigned int texture = 0;
+    int textureWidth = 0;
+    int textureHeight = 0;
+    static const int slots = 3; // Frames in flight at once
+    std::string paths[slots]; // Of the frames in flight, in the same ring order as the readback slots so the strings keep their buffers
+    int oldestPath = 0;
+    int pathsInFlight = 0;
+    unsigned long long framesWritten = 0;
+    unsigned long long framesFailed = 0;
+    std::string lastFailed; // Path of the last frame that couldnt be written
+
+    static const int sourceUnit = 6; // Same units as the display pyramid uses, both only bind them while they run
+    static const int destinationUnit = 7;
+
+    /*
+        The frame is taken off the ring before it is written, so a write that throws cant leave it queued to throw
+        again on every later poll. The mapped pixels and the path stay as they are until the next request()
+        Returns false if a frame couldnt be written
+    */
+    bool writeOldest(encoding::frameWriter& writer, bool block){
+        bool ok = true;
+        while(const void* data = block ? this->readback.wait() : this->readback.poll()){
+            const std::string& path = this->paths[this->oldestPath];
+            this->oldestPath = (this->oldestPath + 1) % slots;
+            this->pathsInFlight--;
+            this->readback.release();
+            if(writer.writeRGBA8(path, static_cast<const uint8_t*>(data), this->textureWidth, this->textureHeight)){
+                this->framesWritten++;
+            }else{
+                this->framesFailed++;
+                this->lastFailed = path;
+                ok = false;
+            }
+            if(block){
+                break;
+            }
+        }
+        return ok;
+    }
+
+    void resize(int width, int height, encoding::frameWriter& writer){
+        if(width == this->textureWidth && height == this->textureHeight){
+            return;
+        }
+        this->flush(writer); // Frames in flight are still the old size
+        this->destroy();
+        GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &this->texture));
+        GLCall(glTextureStorage2D(this->texture, 1, GL_RGBA8, width, height));
+        GLObjectLabel(GL_TEXTURE, this->texture, "Export frame texture");
+        this->textureWidth = width;
+        this->textureHeight = height;
+        openGLComponents::memory::allocate(openGLComponents::memory::TEXTURE, 4LL * width * height);
+        this->readback.init(4LL * width * height, slots);
+    }
+
+    void destroy(){
+        if(this->texture != 0){
+            GLCall(glDeleteTextures(1, &this->texture));
+            openGLComponents::memory::release(openGLComponents::memory::TEXTURE, 4LL * this->textureWidth * this->textureHeight);
+            this->texture = 0;
+        }
+        this->readback.destroy();
+        this->textureWidth = 0;
+        this->textureHeight = 0;
+    }
+
+public:
+    ~frameExport(){
+        this->destroy();
+    }
+
+    void setup(){
+        this->shader.createShaderFromDisk("GLSL/exportFrame.compute.glsl");
+        GLObjectLabel(GL_PROGRAM, this->shader.getID(), "Export frame compute shader");
+    }
+
+    /*
+        Part of a res*res texture that gets exported, in texels
+    */
+    rectangle crop(int res, const view& v) const{
+        rectangle r;
+        if(this->regionMode == REGION_VIEW){ // Inverse of the texture coordinates in quadShader.vert.glsl
+            r.x = (0.5f - 0.5f*v.zoomMultiplier - v.offsetX) * v.textureRatio * res;
+            r.y = (0.5f - 0.5f*v.zoomMultiplier - v.offsetY) * res;
+            r.width = v.zoomMultiplier * v.textureRatio * res;
+            r.height = v.zoomMultiplier * res;
+        }else if(this->regionMode == REGION_CUSTOM){
+            r.x = this->custom[0];
+            r.y = this->custom[1];
+            r.width = this->custom[2];
+            r.height = this->custom[3];
+        }else{
+            r.width = res;
+            r.height = res;
+        }
+        r.width = std::max(r.width, 1.0f);
+        r.height = std::max(r.height, 1.0f);
+        return r;
+    }
+
+    /*
+        Size of the exported frame for a crop, keeping its aspect ratio for whichever size isnt set
+    */
+    void outputSize(const rectangle& r, int& width, int& height) const{
+        width = this->outputWidth;
+        height = this->outputHeight;
+        if(width <= 0 && height <= 0){
+            width = (int)std::lround(r.width);
+            height = (int)std::lround(r.height);
+        }else if(width <= 0){
+            width = (int)std::lround(height * r.width / r.height);
+        }else if(height <= 0){
+            height = (int)std::lround(width * r.height / r.width);
+        }
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+    }
+
+    /*
+        Queues up a frame of the simulation texture to be written to path
+        If the readbacks are all in flight this waits for the oldest one, so frames are never dropped
+        Throws if the path is a format that cant be written, before anything is queued
+    */
+    void request(unsigned int sourceTexture, int res, bool repeat, const view& v, const std::string& path, encoding::frameWriter& writer){
+        writer.checkPath(path);
+        rectangle r = this->crop(res, v);
+        int width, height;
+        this->outputSize(r, width, height);
+        this->resize(width, height, writer);
+        if(this->readback.full()){
+            this->writeOldest(writer, true);
+        }
+
+        GLDebugGroup("Export frame");
+        GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT)); // Simulation texture was written as an image
+        this->shader.use();
+        this->shader.setUniform1i("source", sourceUnit);
+        this->shader.setUniform2f("cropOrigin", r.x, r.y);
+        this->shader.setUniform2f("cropSize", r.width, r.height);
+        this->shader.setUniform1i("repeat", repeat);
+        this->shader.setUniform1i("clampOutput", 1);
+        GLCall(glBindTextureUnit(sourceUnit, sourceTexture));
+        GLCall(glBindImageTexture(destinationUnit, this->texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8));
+        this->shader.execute((width+EX_GROUPSIZE-1)/EX_GROUPSIZE, (height+EX_GROUPSIZE-1)/EX_GROUPSIZE, 1);
+        GLCall(glBindTextureUnit(sourceUnit, 0));
+        this->readback.requestTexture(this->texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 4LL * width * height);
+        this->paths[(this->oldestPath + this->pathsInFlight) % slots] = path;
+        this->pathsInFlight++;
+    }
+
+    /*
+        Writes any frames the GPU has finished, never blocks
+    */
+    void poll(encoding::frameWriter& writer){
+        this->writeOldest(writer, false);
+    }
+
+    /*
+        Waits for and writes every frame still in flight, returns false if any of them couldnt be written
+    */
+    bool flush(encoding::frameWriter& writer){
+        bool ok = true;
+        while(this->pathsInFlight > 0){
+            ok = this->writeOldest(writer, true) && ok;
+        }
+        return ok;
+    }
+
+    unsigned long long getFramesFailed() const{
+        return this->framesFailed;
+    }
+
+    const std::string& getLastFailed() const{
+        return this->lastFailed;
+    }
+
+    void setRegion(int mode){
+        this->regionMode = std::min(std::max(mode, 0), 2);
+    }
+
+    void setCustomRegion(float x, float y, float width, float height){
+        this->regionMode = REGION_CUSTOM;
+        this->custom[0] = x;
+        this->custom[1] = y;
+        this->custom[2] = width;
+        this->custom[3] = height;
+    }
+
+    void setOutputSize(int width, int height){
+        this->outputWidth = std::max(width, 0);
+        this->outputHeight = std::max(height, 0);
+    }
+
+    void drawSettings(int res, const view& v){
+        ImGui::Combo("Export region", &this->regionMode, "Whole texture\0Current view\0Custom\0");
+        if(this->regionMode == REGION_CUSTOM){
+            ImGui::InputFloat4("x, y, width, height", this->custom);
+        }
+        ImGui::InputInt("Export width (0 = auto)", &this->outputWidth);
+        ImGui::InputInt("Export height (0 = auto)", &this->outputHeight);
+        this->outputWidth = std::max(this->outputWidth, 0);
+        this->outputHeight = std::max(this->outputHeight, 0);
+        rectangle r = this->crop(res, v);
+        int width, height;
+        this->outputSize(r, width, height);
+        ImGui::Text("%.0fx%.0f texels at %.0f, %.0f exported as %dx%d, %.1f MB read back per frame", r.width, r.height, r.x, r.y, width, height, 4.0 * width * height / 1e6);
+        if(this->framesFailed > 0){
+            ImGui::TextWrapped("%llu frames couldnt be written, the last was %s", this->framesFailed, this->lastFailed.c_str());
+        }
+    }
+};
+
+}
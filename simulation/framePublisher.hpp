@@ -0,0 +1,320 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <glad/gl.h>
+#include <imgui.h>
+
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/asyncReadback.hpp"
+#include "OpenGLComponents/memoryTracker.hpp"
+#include "sharedFrame.hpp"
+
+#define PB_GROUPSIZE 16 // ! Must be the same as the group size in exportFrame.compute.glsl
+
+namespace simulation{
+
+/*
+    Publishes the live trail texture to POSIX shared memory (layout in sharedFrame.hpp) for other processes to read
+    while the simulation runs, instead of them reading exported image files
+
+    The texture is scaled down and converted on the GPU by the same shader as frame exports, and comes back through an
+    asyncReadback, so a step only ever pays for queueing the copy. Finished frames are copied into the segment by poll()
+    If the readbacks are all still in flight when a frame is due it is skipped rather than waited for, monitoring tools
+    want the newest frame and the simulation shouldnt slow down for them
+*/
+class framePublisher{
+private:
+    /*
+        Settings
+    */
+    char name[64] = "/glslslime"; // Segment name, the file in /dev/shm without the slash
+    int format = SHARED_RGBA8;
+    int downscale = 4; // Published frames are the texture size divided by this
+    float rate = 30; // Most frames per second, 0 = every step
+
+
+    /*
+        OpenGL components
+    */
+    openGLComponents::computeShader shader;
+    openGLComponents::asyncReadback readback;
+    unsigned int texture = 0;
+    int width = 0;
+    int height = 0;
+    int textureFormat = SHARED_RGBA8;
+
+    static const int sourceUnit = 6; // Same units as frame exports, both only bind them while they run
+    static const int destinationUnit = 7;
+
+
+    /*
+        Shared memory and state
+    */
+#ifndef _WIN32
+    distributed::sharedMemory memory;
+#endif
+    sharedFrameHeader* header = nullptr;
+    bool publishing = false;
+    std::chrono::steady_clock::time_point lastFrame;
+    unsigned long long framesPublished = 0;
+    unsigned long long framesSkipped = 0;
+    std::string message;
+
+    size_t frameBytes() const{
+        return sharedFramePixelBytes(this->textureFormat) * this->width * this->height;
+    }
+
+    void destroyTexture(){
+        if(this->texture != 0){
+            GLCall(glDeleteTextures(1, &this->texture));
+            openGLComponents::memory::release(openGLComponents::memory::TEXTURE, (long long)this->frameBytes());
+            this->texture = 0;
+        }
+        this->readback.destroy();
+        this->width = 0;
+        this->height = 0;
+    }
+
+    // Tells readers the segment is going away, they need to attach again to see anything newer
+    void closeSegment(){
+        if(this->header != nullptr){
+            this->header->closed.store(1, std::memory_order_release);
+            this->header = nullptr;
+        }
+#ifndef _WIN32
+        this->memory.release();
+#endif
+    }
+
+    void openSegment(size_t slotBytes){
+#ifndef _WIN32
+        this->closeSegment();
+        size_t headerBytes = (sizeof(sharedFrameHeader) + 63) / 64 * 64; // Pixels start on a cache line
+        this->memory.create(this->name, headerBytes + 2 * slotBytes);
+        this->header = this->memory.at<sharedFrameHeader>(0);
+        std::memcpy(this->header->magic, sharedFrameMagic, 8);
+        this->header->version = sharedFrameVersion;
+        this->header->headerBytes = sizeof(sharedFrameHeader);
+        this->header->slotBytes = slotBytes;
+        for(int s = 0; s < 2; s++){
+            this->header->slots[s].offset = headerBytes + s * slotBytes; // The segment starts zeroed, so everything else is 0
+        }
+#endif
+    }
+
+    /*
+        Makes the texture and readbacks for frames of this size, and a segment with room for them
+        Frames still in flight are the old size, so they are written out first
+    */
+    void resize(int newWidth, int newHeight){
+        if(newWidth == this->width && newHeight == this->height && this->format == this->textureFormat){
+            return;
+        }
+        this->flush();
+        this->destroyTexture();
+        this->width = newWidth;
+        this->height = newHeight;
+        this->textureFormat = this->format;
+        GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &this->texture));
+        GLCall(glTextureStorage2D(this->texture, 1, (this->textureFormat == SHARED_RGBA16F)? GL_RGBA16F : GL_RGBA8, this->width, this->height));
+        GLObjectLabel(GL_TEXTURE, this->texture, "Published frame texture");
+        openGLComponents::memory::allocate(openGLComponents::memory::TEXTURE, (long long)this->frameBytes());
+        this->readback.init(this->frameBytes(), 2);
+        if(this->header == nullptr || this->header->slotBytes < this->frameBytes()){
+            this->openSegment(this->frameBytes());
+        }
+    }
+
+    void write(const void* pixels, long long step){
+        uint64_t published = this->header->published.load(std::memory_order_relaxed);
+        sharedFrameSlot& slot = this->header->slots[published % 2]; // Not the newest frame, readers might be looking at that
+        uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.step = step;
+        slot.width = this->width;
+        slot.height = this->height;
+        slot.format = this->textureFormat;
+        std::memcpy(reinterpret_cast<char*>(this->header) + slot.offset, pixels, this->frameBytes());
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        this->header->published.store(published + 1, std::memory_order_release);
+        this->framesPublished++;
+    }
+
+    void writeFinished(bool block){
+        long long step = 0;
+        while(const void* data = block ? this->readback.wait(&step) : this->readback.poll(&step)){
+            if(this->header != nullptr){
+                this->write(data, step);
+            }
+            this->readback.release();
+        }
+    }
+
+public:
+    ~framePublisher(){
+        this->stop();
+        this->destroyTexture();
+    }
+
+    /*
+        Starts publishing (or carries on with new settings), the segment is made by the first frame
+    */
+    bool start(){
+#ifdef _WIN32
+        this->message = "Publishing needs POSIX shared memory, which this platform doesnt have";
+        return false;
+#else
+        if(this->name[0] != '/' || std::strchr(this->name + 1, '/') != nullptr){
+            this->message = "The name must start with / and have no other /";
+            return false;
+        }
+        if(this->shader.getID() == 0){
+            this->shader.createShaderFromDisk("GLSL/exportFrame.compute.glsl");
+            GLObjectLabel(GL_PROGRAM, this->shader.getID(), "Publish frame compute shader");
+        }
+        if(this->publishing && this->memory.getName() != this->name){
+            this->closeSegment(); // Renamed, the next frame makes the new one
+        }
+        this->publishing = true;
+        this->message = "Publishing to /dev/shm" + std::string(this->name);
+        return true;
+#endif
+    }
+
+    void stop(){
+        if(!this->publishing){
+            return;
+        }
+        this->flush();
+        this->closeSegment();
+        this->publishing = false;
+        this->message = "Stopped after " + std::to_string(this->framesPublished) + " frames";
+    }
+
+    /*
+        Queues up the trail texture to be published if a frame is due, call after each step
+    */
+    void capture(unsigned int sourceTexture, int res, bool repeat, long long step){
+        if(!this->publishing){
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if(this->rate > 0 && now - this->lastFrame < std::chrono::duration<double>(1.0 / this->rate)){
+            return;
+        }
+        int newWidth = std::max(res / std::max(this->downscale, 1), 1);
+        try{
+            this->resize(newWidth, newWidth);
+            if(this->header == nullptr){
+                this->openSegment(this->frameBytes()); // First frame, or renamed since the last one
+            }
+        }catch(const std::runtime_error& e){ // Couldnt make the segment, not worth stopping the simulation for
+            this->message = e.what();
+            this->closeSegment();
+            this->publishing = false;
+            return;
+        }
+        if(this->readback.full()){
+            this->framesSkipped++;
+            return;
+        }
+        this->lastFrame = now;
+
+        GLDebugGroup("Publish frame");
+        GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT)); // Simulation texture was written as an image
+        this->shader.use();
+        this->shader.setUniform1i("source", sourceUnit);
+        this->shader.setUniform2f("cropOrigin", 0, 0);
+        this->shader.setUniform2f("cropSize", res, res);
+        this->shader.setUniform1i("repeat", repeat);
+        this->shader.setUniform1i("clampOutput", this->textureFormat == SHARED_RGBA8);
+        GLCall(glBindTextureUnit(sourceUnit, sourceTexture));
+        GLCall(glBindImageTexture(destinationUnit, this->texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, (this->textureFormat == SHARED_RGBA16F)? GL_RGBA16F : GL_RGBA8));
+        this->shader.execute((this->width+PB_GROUPSIZE-1)/PB_GROUPSIZE, (this->height+PB_GROUPSIZE-1)/PB_GROUPSIZE, 1);
+        GLCall(glBindTextureUnit(sourceUnit, 0));
+        this->readback.requestTexture(this->texture, 0, 0, 0, this->width, this->height, GL_RGBA, (this->textureFormat == SHARED_RGBA16F)? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, this->frameBytes(), step);
+    }
+
+    /*
+        Copies any frames the GPU has finished into the segment, never blocks
+    */
+    void poll(){
+        this->writeFinished(false);
+    }
+
+    /*
+        Waits for and copies every frame still in flight
+    */
+    void flush(){
+        this->writeFinished(true);
+    }
+
+    void setName(const std::string& newName){
+        std::snprintf(this->name, sizeof(this->name), "%s", newName.c_str());
+    }
+
+    void setFormat(int newFormat){
+        this->format = std::min(std::max(newFormat, 0), 1);
+    }
+
+    void setDownscale(int newDownscale){
+        this->downscale = std::max(newDownscale, 1);
+    }
+
+    void setRate(float newRate){
+        this->rate = std::max(newRate, 0.0f);
+    }
+
+    bool isPublishing() const{
+        return this->publishing;
+    }
+
+    unsigned long long getFramesPublished() const{
+        return this->framesPublished;
+    }
+
+    unsigned long long getFramesSkipped() const{
+        return this->framesSkipped;
+    }
+
+    const std::string& getMessage() const{
+        return this->message;
+    }
+
+    void drawSettings(int res){
+        if(!this->publishing){ // Fixed while the segment exists
+            ImGui::InputText("Segment name", this->name, sizeof(this->name));
+        }
+        ImGui::Combo("Published format", &this->format, "8 bit RGBA\0Half float RGBA\0");
+        ImGui::SliderInt("Downscale", &this->downscale, 1, 16);
+        this->downscale = std::max(this->downscale, 1);
+        ImGui::SliderFloat("Frames per second (0 = every step)", &this->rate, 0, 120);
+        this->rate = std::max(this->rate, 0.0f);
+        int size = std::max(res / this->downscale, 1);
+        ImGui::Text("%dx%d, %.2f MB per frame", size, size, sharedFramePixelBytes(this->format) * size * size / 1e6);
+        if(ImGui::Button(this->publishing ? "Stop publishing" : "Start publishing")){
+            if(this->publishing){
+                this->stop();
+            }else{
+                this->start();
+            }
+        }
+        if(!this->message.empty()){
+            ImGui::SameLine();
+            ImGui::TextWrapped("%s", this->message.c_str());
+        }
+        if(this->publishing){
+            ImGui::Text("%llu frames published, %llu skipped (readbacks still in flight)", this->framesPublished, this->framesSkipped);
+        }
+    }
+};
+
+}
@@ -0,0 +1,381 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <imgui.h>
+
+#include "../OpenGLComponents/computeShader.hpp"
+#include "../OpenGLComponents/SSBO.hpp"
+#include "../OpenGLComponents/asyncReadback.hpp"
+
+namespace recording{
+
+/*
+    Trace file layout (.sltrace), everything little endian:
+        traceHeader
+        uint32 agent ID for each of the traced agents
+        then any number of chunks, each a traceChunk followed by steps * tracedCount traceRecords (step by step, agents in header order)
+    Chunks are only missing steps if the host fell so far behind that the GPU ring wrapped, firstStep shows where
+*/
+#pragma pack(push, 1)
+struct traceHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordBytes; // sizeof(traceRecord)
+    uint32_t tracedCount;
+    uint32_t reserved[3];
+};
+
+struct traceChunk{
+    uint32_t magic;
+    uint32_t steps;
+    uint64_t firstStep;
+};
+
+// Matches traceRecord in agent.compute.glsl (std430)
+struct traceRecord{
+    uint32_t step;
+    uint32_t agent; // Top bit set for an empty slot (agent migrated to another subdomain)
+    float x;
+    float y;
+    float angle;
+    float leftSensor;
+    float rightSensor;
+    float forwardSensor;
+};
+#pragma pack(pop)
+
+static const char traceMagic[8] = {'S', 'L', 'I', 'M', 'E', 'T', 'R', 'C'};
+static const uint32_t traceVersion = 1;
+static const uint32_t traceChunkMagic = 0x4B484354; // "TCHK"
+
+/*
+    Follows a sample of agents by having the agent shader write their position, heading and sensor readings into
+    a ring of steps on the GPU. Every chunkSteps steps the finished part of the ring is copied out through an
+    asyncReadback and appended to the trace file, so the step itself only pays for a few extra stores
+
+    If the file writes fall a whole ring behind the oldest chunk is dropped rather than stalling the simulation,
+    which shows up as a gap in the chunk steps and in the UI
+*/
+class agentTracer{
+public:
+    enum selection{ SELECT_STRIDE = 1, SELECT_LIST = 2 }; // Same numbers as traceMode in agent.compute.glsl
+
+private:
+    /*
+        Settings
+    */
+    char path[256] = "agents.sltrace";
+    int mode = SELECT_STRIDE;
+    int first = 0;
+    int stride = 1000;
+    int count = 256;
+    char idList[1024] = "0, 1, 2, 3"; // For SELECT_LIST
+    int chunkSteps = 16; // Steps per readback
+    int ringChunks = 4; // Chunks the GPU ring holds, so how far behind the file writes can get before dropping
+
+
+    /*
+        State
+    */
+    FILE* file = nullptr;
+    std::vector<uint32_t> traced; // Agent IDs, sorted
+    int modeInShader = 0;
+    long long firstStep = 0; // Steps are numbered like the simulation's step count after the step has run, so from 1
+    long long chunkStart = 0; // First step of the chunk being written into the ring
+    long long lastStep = 0; // Last step the shader was told to trace
+    std::deque<long long> pending; // First steps of finished chunks which are still only on the GPU
+    unsigned long long stepsWritten = 0;
+    unsigned long long stepsDropped = 0;
+    std::string message;
+
+
+    /*
+        OpenGL components
+    */
+    openGLComponents::SSBO ringSSBO;
+    openGLComponents::SSBO listSSBO;
+    openGLComponents::asyncReadback readback;
+
+    size_t chunkBytes() const{
+        return (size_t)this->chunkSteps * this->traced.size() * sizeof(traceRecord);
+    }
+
+    // Rows count from the first traced step, so chunks always line up with the ring and never wrap around it
+    long long ringRow(long long step) const{
+        return (step - this->firstStep) % ((long long)this->chunkSteps * this->ringChunks);
+    }
+
+    size_t ringOffset(long long step) const{
+        return (size_t)this->ringRow(step) * this->traced.size() * sizeof(traceRecord);
+    }
+
+    std::vector<uint32_t> selectAgents(int agentCount) const{
+        std::vector<uint32_t> ids;
+        if(this->mode == SELECT_LIST){
+            std::stringstream list(this->idList);
+            std::string item;
+            while(std::getline(list, item, ',')){
+                char* end = nullptr;
+                long id = std::strtol(item.c_str(), &end, 10);
+                if(end != item.c_str() && id >= 0 && id < agentCount){
+                    ids.push_back((uint32_t)id);
+                }
+            }
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }else{
+            for(long long id = this->first; id < agentCount && (int)ids.size() < this->count; id += this->stride){
+                ids.push_back((uint32_t)id);
+            }
+        }
+        return ids;
+    }
+
+    void request(long long start, int steps){
+        this->readback.requestBuffer(this->ringSSBO.getID(), this->ringOffset(start), (size_t)steps * this->traced.size() * sizeof(traceRecord), start);
+    }
+
+    // Asks for as many finished chunks as there is room for, and drops any the GPU is about to write over
+    void requestPending(){
+        while(!this->pending.empty() && !this->readback.full()){
+            this->request(this->pending.front(), this->chunkSteps);
+            this->pending.pop_front();
+        }
+        while((int)this->pending.size() >= this->ringChunks){
+            this->pending.pop_front();
+            this->stepsDropped += this->chunkSteps;
+        }
+    }
+
+    void pickUp(bool block){
+        long long start;
+        size_t bytes;
+        while(const void* data = block ? this->readback.wait(&start, &bytes) : this->readback.poll(&start, &bytes)){
+            traceChunk chunk;
+            chunk.magic = traceChunkMagic;
+            chunk.steps = bytes / (this->traced.size() * sizeof(traceRecord));
+            chunk.firstStep = start;
+            std::fwrite(&chunk, sizeof(chunk), 1, this->file);
+            std::fwrite(data, 1, bytes, this->file);
+            this->stepsWritten += chunk.steps;
+            this->readback.release();
+        }
+    }
+
+public:
+    ~agentTracer(){
+        this->stop();
+    }
+
+    /*
+        Starts tracing the selected agents from the next step, returns false (and sets the message) if nothing can be traced
+        The ring and agent list are bound here, so this has to be called again after the agent SSBO is recreated
+    */
+    bool start(int agentCount, long long step){
+        this->stop();
+        this->stride = std::max(1, this->stride);
+        this->chunkSteps = std::max(1, this->chunkSteps);
+        this->ringChunks = std::max(2, this->ringChunks);
+        this->traced = this->selectAgents(agentCount);
+        if(this->traced.empty()){
+            this->message = "No agents selected";
+            return false;
+        }
+        this->file = std::fopen(this->path, "wb");
+        if(this->file == nullptr){
+            this->message = std::string("Couldnt open ") + this->path + " for writing";
+            return false;
+        }
+        traceHeader header;
+        std::memcpy(header.magic, traceMagic, sizeof(header.magic));
+        header.version = traceVersion;
+        header.recordBytes = sizeof(traceRecord);
+        header.tracedCount = this->traced.size();
+        std::memset(header.reserved, 0, sizeof(header.reserved));
+        std::fwrite(&header, sizeof(header), 1, this->file);
+        std::fwrite(this->traced.data(), sizeof(uint32_t), this->traced.size(), this->file);
+
+        std::vector<traceRecord> ring((size_t)this->chunkSteps * this->ringChunks * this->traced.size());
+        this->ringSSBO.generate(ring);
+        this->listSSBO.generate(this->traced);
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, this->ringSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, this->listSSBO.getID()));
+        GLObjectLabel(GL_BUFFER, this->ringSSBO.getID(), "Agent trace ring SSBO");
+        GLObjectLabel(GL_BUFFER, this->listSSBO.getID(), "Traced agents SSBO");
+        this->readback.init(this->chunkBytes(), this->ringChunks);
+
+        this->firstStep = step + 1;
+        this->chunkStart = this->firstStep;
+        this->lastStep = step;
+        this->modeInShader = -1; // Selection may have changed, so the uniforms need setting again
+        this->pending.clear();
+        this->stepsWritten = 0;
+        this->stepsDropped = 0;
+        this->message = "Tracing " + std::to_string(this->traced.size()) + " agents to " + this->path;
+        return true;
+    }
+
+    /*
+        Writes out everything already traced, including a partly filled chunk, then closes the file
+    */
+    void stop(){
+        if(this->file == nullptr){
+            return;
+        }
+        for(long long start : this->pending){
+            if(this->readback.full()){
+                this->pickUp(true);
+            }
+            this->request(start, this->chunkSteps);
+        }
+        this->pending.clear();
+        if(this->lastStep >= this->chunkStart){
+            if(this->readback.full()){
+                this->pickUp(true);
+            }
+            this->request(this->chunkStart, (int)(this->lastStep - this->chunkStart + 1));
+        }
+        this->pickUp(true);
+        std::fclose(this->file);
+        this->file = nullptr;
+        this->readback.destroy();
+        this->message = std::to_string(this->stepsWritten) + " steps of " + std::to_string(this->traced.size()) + " agents written to " + this->path;
+        if(this->stepsDropped > 0){
+            this->message += ", " + std::to_string(this->stepsDropped) + " steps dropped";
+        }
+    }
+
+    bool isTracing() const{
+        return this->file != nullptr;
+    }
+
+    /*
+        Called right before the agent shader runs step number step (1-based), turns tracing on or off in the shader
+    */
+    void apply(openGLComponents::computeShader& agentShader, long long step){
+        int mode = (this->file != nullptr)? this->mode : 0;
+        agentShader.use();
+        if(mode != this->modeInShader){
+            agentShader.setUniform1i("traceMode", mode);
+            if(mode != 0){
+                agentShader.setUniform1ui("traceFirst", this->first);
+                agentShader.setUniform1ui("traceStride", this->stride);
+                agentShader.setUniform1ui("traceCount", this->traced.size());
+            }
+            this->modeInShader = mode;
+        }
+        if(mode == 0){
+            return;
+        }
+        agentShader.setUniform1ui("traceStep", (unsigned int)step);
+        agentShader.setUniform1ui("traceRow", (unsigned int)this->ringRow(step));
+        this->lastStep = step;
+    }
+
+    /*
+        Called after the agent shader has run, sends off the chunk if that step finished it
+    */
+    void capture(){
+        if(this->file == nullptr){
+            return;
+        }
+        this->pickUp(false); // Steps can run without applySettings() in between (the step control command), so the ring is drained here too
+        if(this->lastStep - this->chunkStart + 1 >= this->chunkSteps){
+            this->pending.push_back(this->chunkStart);
+            this->chunkStart += this->chunkSteps;
+        }
+        this->requestPending();
+    }
+
+    /*
+        Writes out any chunks the GPU has finished copying, never blocks
+    */
+    void poll(){
+        if(this->file != nullptr){
+            this->pickUp(false);
+        }
+    }
+
+    void setPath(const std::string& path){
+        path.copy(this->path, sizeof(this->path) - 1);
+        this->path[std::min(path.size(), sizeof(this->path) - 1)] = '\0';
+    }
+
+    void selectStride(int first, int stride, int count){
+        this->mode = SELECT_STRIDE;
+        this->first = std::max(0, first);
+        this->stride = std::max(1, stride);
+        this->count = std::max(1, count);
+    }
+
+    void selectList(const std::vector<uint32_t>& ids){
+        this->mode = SELECT_LIST;
+        std::string list;
+        for(uint32_t id : ids){
+            list += (list.empty() ? "" : ",") + std::to_string(id);
+        }
+        this->setList(list);
+    }
+
+    void setList(const std::string& list){
+        list.copy(this->idList, sizeof(this->idList) - 1);
+        this->idList[std::min(list.size(), sizeof(this->idList) - 1)] = '\0';
+    }
+
+    unsigned long long getStepsWritten() const{
+        return this->stepsWritten;
+    }
+
+    unsigned long long getStepsDropped() const{
+        return this->stepsDropped;
+    }
+
+    const std::string& getMessage() const{
+        return this->message;
+    }
+
+    void drawSettings(int agentCount, long long step){
+        bool tracing = this->file != nullptr;
+        if(!tracing){ // These are fixed for the whole file
+            ImGui::InputText("Trace path", this->path, sizeof(this->path));
+            ImGui::Combo("Traced agents", &this->mode, "\0Every Nth agent\0Agent IDs\0");
+            this->mode = std::max((int)SELECT_STRIDE, this->mode);
+            if(this->mode == SELECT_STRIDE){
+                ImGui::InputInt("First agent", &this->first);
+                ImGui::InputInt("Every Nth", &this->stride);
+                ImGui::SliderInt("Agents to trace", &this->count, 1, 4096);
+            }else{
+                ImGui::InputText("Agent IDs (comma separated)", this->idList, sizeof(this->idList));
+            }
+            ImGui::SliderInt("Steps per readback", &this->chunkSteps, 1, 256);
+            ImGui::SliderInt("Readbacks in flight", &this->ringChunks, 2, 16);
+        }
+        if(ImGui::Button(tracing ? "Stop tracing" : "Start tracing")){
+            if(tracing){
+                this->stop();
+            }else{
+                this->start(agentCount, step);
+            }
+        }
+        if(!this->message.empty()){
+            ImGui::SameLine();
+            ImGui::TextWrapped("%s", this->message.c_str());
+        }
+        if(tracing){
+            ImGui::Text("%llu steps written (%.1f MB)", this->stepsWritten, this->stepsWritten * this->traced.size() * sizeof(traceRecord) / 1e6);
+            if(this->stepsDropped > 0){
+                ImGui::TextColored(ImVec4(1, 0.5, 0, 1), "%llu steps dropped, the file writes couldnt keep up", this->stepsDropped);
+            }
+        }
+    }
+};
+
+}
@@ -0,0 +1,223 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <imgui.h>
+
+#include "../../misc/json.hpp"
+
+namespace recording{
+
+/*
+    Journal file layout (.sljournal), one JSON object per line in the order things happened:
+        {"step":0,"cmd":"journal","version":1}
+        {"step":0,"cmd":"restart","agents":100000,"resolution":1024,"seed":1234}   seed is the one actually used, never -1
+        {"step":0,"cmd":"set","params":{"speed":1,"fade":0.1}}   settings which changed since they were last written, every setting the first time
+        {"step":120,"cmd":"view","offset":[0.1,0],"zoom":2,"ratio":1.77,"repeat":false}
+        {"step":5000,"cmd":"end"}
+    step counts from the restart before the entry, and an entry at step n applies from step n+1 on (so once n steps have run)
+    A restart starts the simulation over, so everything before one only matters for the settings it leaves behind
+
+    The commands are the same as the control socket's (see simulation/control.hpp) apart from journal, view and end
+*/
+static const int journalVersion = 1;
+
+/*
+    Writes down every settings change and restart of a session as it happens, so the session can be replayed later
+    without the UI (see simulation/replay.hpp and GLSLSlimeReplay), for example at a higher resolution or frame rate
+    The journal only ever holds changes, so it stays small however long the session runs, and lives in memory until saved
+
+    Settings are compared in place each step, so steps where nothing changed cost a few compares and no allocations
+    Lines are formatted straight onto the end of the journal, so a change (e.g. every frame of dragging a slider or the view)
+    only allocates when the journal text has to grow
+*/
+class parameterJournal{
+private:
+    struct tracked{
+        bool written = false;
+        double values[4] = {};
+    };
+    std::vector<tracked> last; // Last value written for each setting, by the index it was recorded with
+    float lastView[4] = {};
+    bool lastRepeat = false;
+    bool viewWritten = false;
+
+    std::string text; // Every finished line so far
+    std::string pending; // Fields of the settings changed at pendingStep, written as one set line
+    long long pendingStep = 0;
+    bool hasPending = false;
+    long long entries = 0;
+
+    char path[256] = "session.sljournal";
+    std::string message;
+
+    // Same format as json::number
+    static void appendNumber(std::string& out, double x){
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", x);
+        out += buffer;
+    }
+
+    // Steps and seeds can have more digits than json::number keeps
+    static json::objectWriter entry(long long step, const char* cmd){
+        json::objectWriter line;
+        line.addRaw("step", std::to_string(step));
+        line.add("cmd", cmd);
+        return line;
+    }
+
+    void append(const json::objectWriter& line){
+        this->text += line.str() + "\n";
+        this->entries++;
+    }
+
+    void appendLine(const char* line){
+        this->text += line;
+        this->entries++;
+    }
+
+    void flushPending(){
+        if(!this->hasPending){
+            return;
+        }
+        char head[64];
+        std::snprintf(head, sizeof(head), "{\"step\":%lld,\"cmd\":\"set\",\"params\":{", this->pendingStep);
+        this->text += head;
+        this->text += this->pending;
+        this->appendLine("}}\n");
+        this->pending.clear(); // Keeps its buffer for the next step
+        this->hasPending = false;
+    }
+
+public:
+    parameterJournal(){
+        json::objectWriter header = entry(0, "journal");
+        header.add("version", journalVersion);
+        this->append(header);
+    }
+
+    /*
+        Writes down a setting if it differs from what was last written for it (index is its position in the
+        simulation's list of settings), settings changed at the same step end up in the same line
+    */
+    void record(long long step, size_t index, const char* name, const double* values, int components){
+        if(index >= this->last.size()){
+            this->last.resize(index + 1);
+        }
+        tracked& t = this->last[index];
+        bool changed = !t.written;
+        for(int c = 0; c < components && !changed; c++){
+            changed = t.values[c] != values[c];
+        }
+        if(!changed){
+            return;
+        }
+        t.written = true;
+        for(int c = 0; c < components && c < 4; c++){
+            t.values[c] = values[c];
+        }
+        if(this->hasPending && this->pendingStep != step){
+            this->flushPending();
+        }
+        this->pendingStep = step;
+        if(!this->pending.empty()){
+            this->pending += ",";
+        }
+        this->pending += "\"";
+        this->pending += name; // Setting names never need escaping
+        this->pending += "\":";
+        if(components > 1){
+            this->pending += "[";
+        }
+        for(int c = 0; c < components; c++){
+            if(c > 0){
+                this->pending += ",";
+            }
+            appendNumber(this->pending, values[c]);
+        }
+        if(components > 1){
+            this->pending += "]";
+        }
+        this->hasPending = true;
+    }
+
+    void view(long long step, float offsetX, float offsetY, float zoomMultiplier, float textureRatio, bool repeat){
+        float v[4] = {offsetX, offsetY, zoomMultiplier, textureRatio};
+        if(this->viewWritten && repeat == this->lastRepeat && v[0] == this->lastView[0] && v[1] == this->lastView[1] && v[2] == this->lastView[2] && v[3] == this->lastView[3]){
+            return;
+        }
+        for(int c = 0; c < 4; c++){
+            this->lastView[c] = v[c];
+        }
+        this->lastRepeat = repeat;
+        this->viewWritten = true;
+        this->flushPending(); // Keeps the lines in step order
+        char line[256];
+        std::snprintf(line, sizeof(line), "{\"step\":%lld,\"cmd\":\"view\",\"offset\":[%.9g,%.9g],\"zoom\":%.9g,\"ratio\":%.9g,\"repeat\":%s}\n",
+                      step, (double)offsetX, (double)offsetY, (double)zoomMultiplier, (double)textureRatio, repeat ? "true" : "false");
+        this->appendLine(line);
+    }
+
+    /*
+        step is the step the simulation was on when it restarted, seed must be the seed actually used
+    */
+    void restart(long long step, int agents, int resolution, int seed){
+        this->flushPending();
+        char line[128];
+        std::snprintf(line, sizeof(line), "{\"step\":%lld,\"cmd\":\"restart\",\"agents\":%d,\"resolution\":%d,\"seed\":%d}\n", step, agents, resolution, seed);
+        this->appendLine(line);
+    }
+
+    /*
+        Writes the whole journal so far, ending at step, the journal carries on recording afterwards
+        An empty path uses the one set in the UI
+    */
+    bool save(long long step, const std::string& savePath=""){
+        this->flushPending();
+        std::string target = savePath.empty()? std::string(this->path) : savePath;
+        FILE* file = std::fopen(target.c_str(), "wb");
+        if(file == nullptr){
+            this->message = "Cant open " + target;
+            return false;
+        }
+        std::string end = entry(step, "end").str() + "\n";
+        bool written = std::fwrite(this->text.data(), 1, this->text.size(), file) == this->text.size()
+                    && std::fwrite(end.data(), 1, end.size(), file) == end.size();
+        written = (std::fclose(file) == 0) && written;
+        this->message = written ? "Saved " + std::to_string(this->entries + 1) + " entries to " + target : "Failed writing " + target;
+        return written;
+    }
+
+    void setPath(const std::string& newPath){
+        std::snprintf(this->path, sizeof(this->path), "%s", newPath.c_str());
+    }
+
+    const std::string& getMessage() const{
+        return this->message;
+    }
+
+    long long getEntries() const{
+        return this->entries + (this->hasPending ? 1 : 0);
+    }
+
+    size_t getBytes() const{
+        return this->text.size();
+    }
+
+    /*
+        Returns true when save was clicked, the caller saves so it can write down the current settings first
+    */
+    bool drawSettings(){
+        ImGui::InputText("Journal path", this->path, sizeof(this->path));
+        bool clicked = ImGui::Button("Save journal");
+        ImGui::SameLine();
+        ImGui::Text("%lld entries (%.1f KB) this session", this->getEntries(), this->getBytes() / 1024.0);
+        if(!this->message.empty()){
+            ImGui::TextWrapped("%s", this->message.c_str());
+        }
+        return clicked;
+    }
+};
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if GLSLSLIME_HAVE_ZLIB
+    #include <zlib.h>
+#endif
+
+namespace recording{
+
+    /*
+        Layout of a trail recording (.slrec), everything little endian:
+
+            fileHeader
+            frameHeader + payload     once per recorded frame, in order
+            ...
+            "SLIMEIDX", uint64 count, indexEntry * count
+            fileTrailer               points back at the index
+
+        A payload is the frame's 16 bit deposit values after prediction, split into a plane of low bytes and a plane
+        of high bytes (the high bytes of small differences are nearly all 0 or 255), and then deflated.
+        The predictor is picked per frame by whichever compresses best: none, the texel to the left, or the same texel
+        in the previous recorded frame. Frames that dont use the previous frame are keyframes, decoding can start there.
+        value = quantized * scale gives the deposit back.
+
+        The index and trailer are only written when a recording is closed properly, if they are missing the reader
+        rebuilds the index by walking the frame headers instead.
+    */
+    const char fileMagic[8] = {'S','L','I','M','E','R','E','C'};
+    const char indexMagic[8] = {'S','L','I','M','E','I','D','X'};
+    const char trailerMagic[8] = {'S','L','I','M','E','E','N','D'};
+    const uint32_t frameMagic = 0x454D5246; // "FRME"
+    const uint32_t formatVersion = 1;
+
+    enum codec : uint8_t{
+        CODEC_STORED = 0,
+        CODEC_DEFLATE = 1
+    };
+
+    enum frameFlags : uint8_t{
+        FRAME_KEYFRAME = 1
+    };
+
+    enum predictor : uint8_t{
+        PREDICT_NONE = 0,
+        PREDICT_LEFT = 1,
+        PREDICT_PREVIOUS = 2
+    };
+
+    #pragma pack(push, 1)
+    struct fileHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        float scale; // Deposit per quantization step
+        uint32_t keyframeInterval;
+        uint32_t reserved = 0;
+    };
+
+    struct frameHeader{
+        uint32_t magic;
+        uint32_t index;
+        int64_t step;
+        uint8_t flags;
+        uint8_t codec;
+        uint8_t predictor;
+        uint8_t reserved;
+        uint32_t clippedTexels;
+        uint32_t storedBytes;
+        uint32_t rawBytes;
+    };
+
+    struct indexEntry{
+        uint64_t offset; // Of the frameHeader
+        int64_t step;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    struct fileTrailer{
+        uint64_t indexOffset;
+        char magic[8];
+    };
+    #pragma pack(pop)
+    static_assert(sizeof(fileHeader) == 32 && sizeof(frameHeader) == 32 && sizeof(indexEntry) == 24 && sizeof(fileTrailer) == 16, "recording structs must be packed");
+
+
+    /*
+        Prediction, the residuals wrap around so every direction is lossless
+    */
+    inline void predictSpatial(const uint16_t* frame, uint16_t* out, size_t width, size_t height){
+        for(size_t y = 0; y < height; y++){
+            const uint16_t* row = frame + y * width;
+            uint16_t* outRow = out + y * width;
+            uint16_t left = (y > 0)? frame[(y - 1) * width] : 0; // First texel of a row is predicted from the one above
+            for(size_t x = 0; x < width; x++){
+                outRow[x] = (uint16_t)(row[x] - left);
+                left = row[x];
+            }
+        }
+    }
+
+    inline void unpredictSpatial(uint16_t* frame, size_t width, size_t height){
+        for(size_t y = 0; y < height; y++){
+            uint16_t* row = frame + y * width;
+            uint16_t left = (y > 0)? frame[(y - 1) * width] : 0;
+            for(size_t x = 0; x < width; x++){
+                row[x] = (uint16_t)(row[x] + left);
+                left = row[x];
+            }
+        }
+    }
+
+    inline void predictTemporal(const uint16_t* frame, const uint16_t* previous, uint16_t* out, size_t count){
+        for(size_t i = 0; i < count; i++){
+            out[i] = (uint16_t)(frame[i] - previous[i]);
+        }
+    }
+
+    inline void unpredictTemporal(uint16_t* frame, const uint16_t* previous, size_t count){
+        for(size_t i = 0; i < count; i++){
+            frame[i] = (uint16_t)(frame[i] + previous[i]);
+        }
+    }
+
+    inline void predict(predictor p, const uint16_t* frame, const uint16_t* previous, uint16_t* out, size_t width, size_t height){
+        if(p == PREDICT_LEFT){
+            predictSpatial(frame, out, width, height);
+        }else if(p == PREDICT_PREVIOUS){
+            predictTemporal(frame, previous, out, width * height);
+        }else{
+            std::memcpy(out, frame, width * height * sizeof(uint16_t));
+        }
+    }
+
+    // Turns the residuals in frame back into values, previous is only needed for PREDICT_PREVIOUS
+    inline void unpredict(predictor p, uint16_t* frame, const uint16_t* previous, size_t width, size_t height){
+        if(p == PREDICT_LEFT){
+            unpredictSpatial(frame, width, height);
+        }else if(p == PREDICT_PREVIOUS){
+            unpredictTemporal(frame, previous, width * height);
+        }else if(p != PREDICT_NONE){
+            throw std::runtime_error("Unknown predictor " + std::to_string((int)p));
+        }
+    }
+
+    inline void splitBytes(const uint16_t* values, uint8_t* out, size_t count){
+        for(size_t i = 0; i < count; i++){
+            out[i] = (uint8_t)values[i];
+            out[count + i] = (uint8_t)(values[i] >> 8);
+        }
+    }
+
+    inline void joinBytes(const uint8_t* planes, uint16_t* out, size_t count){
+        for(size_t i = 0; i < count; i++){
+            out[i] = (uint16_t)(planes[i] | (planes[count + i] << 8));
+        }
+    }
+
+
+    /*
+        Compression, falls back to storing the planes as they are when built without zlib
+    */
+    inline codec compressPlanes(const std::vector<uint8_t>& planes, std::vector<uint8_t>& out, int level){
+    #if GLSLSLIME_HAVE_ZLIB
+        uLongf length = compressBound(planes.size());
+        out.resize(length);
+        if(compress2(out.data(), &length, planes.data(), planes.size(), level) == Z_OK && length < planes.size()){
+            out.resize(length);
+            return CODEC_DEFLATE;
+        }
+    #else
+        (void)level;
+    #endif
+        out = planes;
+        return CODEC_STORED;
+    }
+
+    inline void decompressPlanes(const std::vector<uint8_t>& stored, codec c, std::vector<uint8_t>& planes){
+        if(c == CODEC_STORED){
+            if(stored.size() != planes.size()){
+                throw std::runtime_error("Stored frame has the wrong size");
+            }
+            planes = stored;
+            return;
+        }
+    #if GLSLSLIME_HAVE_ZLIB
+        if(c == CODEC_DEFLATE){
+            uLongf length = planes.size();
+            if(uncompress(planes.data(), &length, stored.data(), stored.size()) != Z_OK || length != planes.size()){
+                throw std::runtime_error("Corrupt compressed frame");
+            }
+            return;
+        }
+    #endif
+        throw std::runtime_error("Frame uses codec " + std::to_string((int)c) + ", which this build cant decode (built without zlib?)");
+    }
+
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "trailFormat.hpp"
+
+namespace recording{
+
+/*
+    Random access to the frames of a .slrec trail recording, no OpenGL needed
+    Decoding frame i starts from the closest keyframe at or before it, and consecutive frames reuse the previous
+    result so reading a range in order only decodes each frame once
+*/
+class trailReader{
+private:
+    FILE* file = nullptr;
+    fileHeader header;
+    std::vector<indexEntry> index;
+    bool indexRebuilt = false;
+
+    std::vector<uint16_t> current; // Last decoded frame
+    long long currentIndex = -1;
+    std::vector<uint8_t> stored;
+    std::vector<uint8_t> planes;
+    std::vector<uint16_t> delta;
+
+    void seek(uint64_t offset){
+    #ifdef _WIN32
+        if(_fseeki64(this->file, (long long)offset, SEEK_SET) != 0){
+    #else
+        if(fseeko(this->file, (off_t)offset, SEEK_SET) != 0){
+    #endif
+            throw std::runtime_error("Seek failed in trail recording");
+        }
+    }
+
+    bool readIndex(){
+        fileTrailer trailer;
+    #ifdef _WIN32
+        if(_fseeki64(this->file, -(long long)sizeof(trailer), SEEK_END) != 0){
+    #else
+        if(fseeko(this->file, -(off_t)sizeof(trailer), SEEK_END) != 0){
+    #endif
+            return false;
+        }
+        if(std::fread(&trailer, sizeof(trailer), 1, this->file) != 1 || std::memcmp(trailer.magic, trailerMagic, sizeof(trailerMagic)) != 0){
+            return false;
+        }
+        this->seek(trailer.indexOffset);
+        char magic[8];
+        uint64_t count;
+        if(std::fread(magic, sizeof(magic), 1, this->file) != 1 || std::memcmp(magic, indexMagic, sizeof(indexMagic)) != 0 || std::fread(&count, sizeof(count), 1, this->file) != 1){
+            return false;
+        }
+        this->index.resize(count);
+        return std::fread(this->index.data(), sizeof(indexEntry), count, this->file) == count;
+    }
+
+    // For recordings that were never closed, walks the frame headers until they run out
+    void rebuildIndex(){
+        this->index.clear();
+        this->indexRebuilt = true;
+        uint64_t offset = sizeof(fileHeader);
+        frameHeader frame;
+        while(true){
+            this->seek(offset);
+            if(std::fread(&frame, sizeof(frame), 1, this->file) != 1 || frame.magic != frameMagic || frame.index != this->index.size()){
+                break;
+            }
+            uint64_t next = offset + sizeof(frame) + frame.storedBytes;
+            this->seek(next - 1);
+            if(std::fgetc(this->file) == EOF){
+                break; // Payload was cut off
+            }
+            indexEntry entry;
+            entry.offset = offset;
+            entry.step = frame.step;
+            entry.flags = frame.flags;
+            entry.reserved = 0;
+            this->index.push_back(entry);
+            offset = next;
+        }
+    }
+
+    // Decodes frame i into current, which must hold frame i-1 unless i is a keyframe
+    void decodeInto(size_t i){
+        frameHeader frame;
+        this->seek(this->index[i].offset);
+        if(std::fread(&frame, sizeof(frame), 1, this->file) != 1 || frame.magic != frameMagic){
+            throw std::runtime_error("Bad frame header for frame " + std::to_string(i));
+        }
+        size_t count = this->texelCount();
+        if(frame.rawBytes != count * 2){
+            throw std::runtime_error("Frame " + std::to_string(i) + " has the wrong size");
+        }
+        this->stored.resize(frame.storedBytes);
+        if(std::fread(this->stored.data(), 1, this->stored.size(), this->file) != this->stored.size()){
+            throw std::runtime_error("Frame " + std::to_string(i) + " is cut off");
+        }
+        this->planes.resize(frame.rawBytes);
+        decompressPlanes(this->stored, (codec)frame.codec, this->planes);
+        if(frame.predictor == PREDICT_PREVIOUS && this->currentIndex != (long long)i - 1){
+            throw std::runtime_error("Frame " + std::to_string(i) + " needs the frame before it decoded first");
+        }
+        this->delta.resize(count);
+        joinBytes(this->planes.data(), this->delta.data(), count);
+        unpredict((predictor)frame.predictor, this->delta.data(), this->current.data(), this->header.width, this->header.height);
+        this->current.swap(this->delta);
+        this->currentIndex = i;
+    }
+
+public:
+    trailReader(const std::string& path){
+        this->file = std::fopen(path.c_str(), "rb");
+        if(this->file == nullptr){
+            throw std::runtime_error("Couldnt open trail recording: " + path);
+        }
+        if(std::fread(&this->header, sizeof(this->header), 1, this->file) != 1 || std::memcmp(this->header.magic, fileMagic, sizeof(fileMagic)) != 0){
+            std::fclose(this->file);
+            throw std::runtime_error("Not a trail recording: " + path);
+        }
+        if(this->header.version != formatVersion){
+            std::fclose(this->file);
+            throw std::runtime_error("Unsupported trail recording version " + std::to_string(this->header.version) + ": " + path);
+        }
+        if(!this->readIndex()){
+            this->rebuildIndex();
+        }
+    }
+
+    ~trailReader(){
+        std::fclose(this->file);
+    }
+
+    trailReader(const trailReader&) = delete;
+    trailReader& operator=(const trailReader&) = delete;
+
+    size_t frameCount() const{
+        return this->index.size();
+    }
+
+    unsigned int width() const{
+        return this->header.width;
+    }
+
+    unsigned int height() const{
+        return this->header.height;
+    }
+
+    size_t texelCount() const{
+        return (size_t)this->header.width * this->header.height;
+    }
+
+    float scale() const{
+        return this->header.scale;
+    }
+
+    long long step(size_t i) const{
+        return this->index.at(i).step;
+    }
+
+    bool isKeyframe(size_t i) const{
+        return (this->index.at(i).flags & FRAME_KEYFRAME) != 0;
+    }
+
+    // True if the file wasnt closed properly and the index had to be rebuilt (the last frame may be missing)
+    bool wasRecovered() const{
+        return this->indexRebuilt;
+    }
+
+    /*
+        The quantized values of frame i, valid until the next call
+    */
+    const std::vector<uint16_t>& frame(size_t i){
+        if(i >= this->index.size()){
+            throw std::out_of_range("Frame " + std::to_string(i) + " out of range, the recording has " + std::to_string(this->index.size()) + " frames");
+        }
+        if((long long)i == this->currentIndex){
+            return this->current;
+        }
+        size_t start = i; // Back to the nearest keyframe, or to just after the frame already decoded if that is closer
+        while(!this->isKeyframe(start) && (long long)start != this->currentIndex + 1){
+            if(start == 0){
+                throw std::runtime_error("Recording doesnt start with a keyframe");
+            }
+            start--;
+        }
+        for(size_t f = start; f <= i; f++){
+            this->decodeInto(f);
+        }
+        return this->current;
+    }
+
+    /*
+        Frame i as deposit values
+    */
+    void frameAsFloat(size_t i, float* out){
+        const std::vector<uint16_t>& values = this->frame(i);
+        for(size_t t = 0; t < values.size(); t++){
+            out[t] = values[t] * this->header.scale;
+        }
+    }
+};
+
+}
@@ -0,0 +1,397 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <imgui.h>
+
+#include "../OpenGLComponents/computeShader.hpp"
+#include "../OpenGLComponents/SSBO.hpp"
+#include "../OpenGLComponents/asyncReadback.hpp"
+#include "../encoding/pixelConversion.hpp"
+#include "trailFormat.hpp"
+
+// ! Important, must be the same as in quantize.compute.glsl
+#define QT_GROUPSIZE 256
+
+namespace recording{
+
+/*
+    Records the raw deposit channel every N steps into a .slrec file (see trailFormat.hpp) for offline analysis
+    The GPU quantizes the deposit to 16 bits and it comes back through an asyncReadback, then worker threads do the
+    prediction and compression while a frame is written out as soon as it and every frame before it are done
+
+    Frames are never dropped, if the workers fall behind capture() waits for them, so the simulation slows down instead
+*/
+class trailRecorder{
+private:
+    /*
+        Settings
+    */
+    char path[256] = "trail.slrec";
+    int interval = 10; // Steps between recorded frames
+    float maxDeposit = 1.0f; // Deposit that maps to the top of the 16 bit range, agents deposit 1 so this only needs raising with food maps
+    int keyframeInterval = 32; // Every Nth frame doesnt depend on the previous one, so decoding a random frame needs at most N-1 deltas
+    int compressionLevel = 1; // zlib level, 1 is far faster than the default for very little size
+    int threads = std::max(1, encoding::defaultThreadCount() - 1); // Leave a core for the render thread
+
+
+    /*
+        Work passed to the compression threads
+    */
+    struct job{
+        uint32_t index = 0;
+        long long step = 0;
+        bool keyframe = false; // Forces a predictor that doesnt depend on the previous frame
+        uint32_t clippedTexels = 0;
+        std::shared_ptr<const std::vector<uint16_t>> frame;
+        std::shared_ptr<const std::vector<uint16_t>> previous; // Not set for keyframes
+    };
+
+    struct chunk{
+        frameHeader header;
+        std::vector<uint8_t> payload;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable roomAvailable;
+    std::deque<job> jobs;
+    std::map<uint32_t, chunk> finished; // Done, but waiting for an earlier frame before they can be written
+    bool stopping = false;
+    int maxPending = 0;
+
+
+    /*
+        Output
+    */
+    FILE* file = nullptr;
+    uint64_t fileOffset = 0; // Tracked by hand, ftell is only 32 bits on some platforms
+    std::vector<indexEntry> index;
+    uint32_t submitted = 0;
+    uint32_t written = 0;
+    unsigned long long rawBytes = 0;
+    unsigned long long storedBytes = 0;
+    uint32_t lastClipped = 0;
+    std::string message;
+    std::shared_ptr<const std::vector<uint16_t>> previousFrame;
+
+
+    /*
+        OpenGL components
+    */
+    openGLComponents::computeShader shader;
+    openGLComponents::SSBO quantizedSSBO;
+    openGLComponents::asyncReadback readback;
+    int res = 0;
+    size_t texelCount = 0;
+
+    // Tries each predictor on every 8th row and keeps whichever of them compresses smallest
+    predictor choosePredictor(const job& j, std::vector<uint16_t>& predicted, std::vector<uint8_t>& planes, std::vector<uint8_t>& compressed){
+        const predictor candidates[3] = {PREDICT_NONE, PREDICT_LEFT, PREDICT_PREVIOUS};
+        predictor best = PREDICT_NONE;
+        size_t bestSize = SIZE_MAX;
+        size_t width = this->res, rows = (this->res + 7) / 8;
+        std::vector<uint16_t> sample(rows * width);
+        for(predictor p : candidates){
+            if(p == PREDICT_PREVIOUS && j.previous == nullptr){
+                continue;
+            }
+            predict(p, j.frame->data(), (p == PREDICT_PREVIOUS)? j.previous->data() : nullptr, predicted.data(), width, this->res);
+            for(size_t r = 0; r < rows; r++){
+                std::memcpy(&sample[r * width], &predicted[r * 8 * width], width * sizeof(uint16_t));
+            }
+            planes.resize(sample.size() * 2);
+            splitBytes(sample.data(), planes.data(), sample.size());
+            compressPlanes(planes, compressed, this->compressionLevel);
+            if(compressed.size() < bestSize){
+                best = p;
+                bestSize = compressed.size();
+            }
+        }
+        return best;
+    }
+
+    void encode(const job& j, chunk& c, std::vector<uint16_t>& predicted, std::vector<uint8_t>& planes){
+        predicted.resize(this->texelCount);
+        predictor p = this->choosePredictor(j, predicted, planes, c.payload);
+        predict(p, j.frame->data(), (p == PREDICT_PREVIOUS)? j.previous->data() : nullptr, predicted.data(), this->res, this->res);
+        planes.resize(this->texelCount * 2);
+        splitBytes(predicted.data(), planes.data(), this->texelCount);
+
+        c.header.magic = frameMagic;
+        c.header.index = j.index;
+        c.header.step = j.step;
+        c.header.flags = (p != PREDICT_PREVIOUS)? FRAME_KEYFRAME : 0;
+        c.header.codec = compressPlanes(planes, c.payload, this->compressionLevel);
+        c.header.predictor = p;
+        c.header.reserved = 0;
+        c.header.clippedTexels = j.clippedTexels;
+        c.header.storedBytes = c.payload.size();
+        c.header.rawBytes = planes.size();
+    }
+
+    void workerLoop(){
+        std::vector<uint16_t> predicted;
+        std::vector<uint8_t> planes;
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while(true){
+            this->jobAvailable.wait(lock, [this](){ return this->stopping || !this->jobs.empty(); });
+            if(this->jobs.empty()){
+                return; // Stopping and nothing left to do
+            }
+            job j = std::move(this->jobs.front());
+            this->jobs.pop_front();
+            lock.unlock();
+            chunk c;
+            this->encode(j, c, predicted, planes);
+            j = job(); // Let go of the frames before waiting on anything
+            lock.lock();
+            this->finished[c.header.index] = std::move(c);
+            this->writeFinished();
+            this->roomAvailable.notify_all();
+        }
+    }
+
+    // Writes every finished frame that is next in line, the mutex must be held
+    void writeFinished(){
+        auto it = this->finished.find(this->written);
+        while(it != this->finished.end()){
+            chunk& c = it->second;
+            indexEntry entry;
+            entry.offset = this->fileOffset;
+            entry.step = c.header.step;
+            entry.flags = c.header.flags;
+            entry.reserved = 0;
+            std::fwrite(&c.header, sizeof(c.header), 1, this->file);
+            std::fwrite(c.payload.data(), 1, c.payload.size(), this->file);
+            this->fileOffset += sizeof(c.header) + c.payload.size();
+            this->index.push_back(entry);
+            this->rawBytes += c.header.rawBytes;
+            this->storedBytes += c.header.storedBytes;
+            this->lastClipped = c.header.clippedTexels;
+            this->finished.erase(it);
+            this->written++;
+            it = this->finished.find(this->written);
+        }
+    }
+
+    // Hands a frame that has been read back to the workers, waits if too many are already queued
+    void submit(const void* data, long long step){
+        const uint32_t* words = static_cast<const uint32_t*>(data);
+        std::shared_ptr<std::vector<uint16_t>> frame = std::make_shared<std::vector<uint16_t>>(this->texelCount);
+        std::memcpy(frame->data(), words + 1, this->texelCount * sizeof(uint16_t)); // Little endian, so texel i is the i-th half word
+
+        job j;
+        j.index = this->submitted;
+        j.step = step;
+        j.keyframe = (this->submitted % this->keyframeInterval == 0);
+        j.clippedTexels = words[0];
+        j.frame = frame;
+        j.previous = j.keyframe ? nullptr : this->previousFrame;
+        this->previousFrame = frame;
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->roomAvailable.wait(lock, [this](){ return (int)(this->submitted - this->written) < this->maxPending; });
+        this->jobs.push_back(std::move(j));
+        this->submitted++;
+        this->jobAvailable.notify_one();
+    }
+
+    void pickUp(bool block){
+        long long step;
+        while(const void* data = block ? this->readback.wait(&step) : this->readback.poll(&step)){
+            this->submit(data, step);
+            this->readback.release();
+        }
+    }
+
+public:
+    ~trailRecorder(){
+        this->stop();
+    }
+
+    /*
+        Starts a new recording at the given texture resolution, returns false (and sets the message) if the file cant be opened
+    */
+    bool start(int res){
+        this->stop();
+        this->file = std::fopen(this->path, "wb");
+        if(this->file == nullptr){
+            this->message = std::string("Couldnt open ") + this->path + " for writing";
+            return false;
+        }
+        if(this->shader.getID() == 0){
+            this->shader.createShaderFromDisk("GLSL/quantize.compute.glsl");
+            GLObjectLabel(GL_PROGRAM, this->shader.getID(), "Quantize compute shader");
+        }
+        this->res = res;
+        this->texelCount = (size_t)res * res;
+        this->shader.setUniform1i("size", res);
+        size_t quantizedBytes = (1 + (this->texelCount + 1) / 2) * sizeof(uint32_t);
+        this->quantizedSSBO.generateZeroed(quantizedBytes);
+        this->quantizedSSBO.bind(this->shader.getID(), "quantizedTrail", 8);
+        GLObjectLabel(GL_BUFFER, this->quantizedSSBO.getID(), "Quantized trail SSBO");
+        this->readback.init(quantizedBytes, 3);
+
+        fileHeader header;
+        std::memcpy(header.magic, fileMagic, sizeof(header.magic));
+        header.version = formatVersion;
+        header.width = res;
+        header.height = res;
+        header.scale = this->maxDeposit / 65535.0f;
+        header.keyframeInterval = this->keyframeInterval = std::max(1, this->keyframeInterval);
+        std::fwrite(&header, sizeof(header), 1, this->file);
+        this->fileOffset = sizeof(header);
+
+        this->index.clear();
+        this->submitted = 0;
+        this->written = 0;
+        this->rawBytes = 0;
+        this->storedBytes = 0;
+        this->lastClipped = 0;
+        this->previousFrame = nullptr;
+        this->stopping = false;
+        this->threads = std::max(1, this->threads);
+        this->maxPending = this->threads * 2;
+        for(int i = 0; i < this->threads; i++){
+            this->workers.emplace_back(&trailRecorder::workerLoop, this);
+        }
+        this->message = std::string("Recording to ") + this->path;
+        return true;
+    }
+
+    /*
+        Finishes every frame still on the GPU or being compressed, then writes the index and closes the file
+    */
+    void stop(){
+        if(this->file == nullptr){
+            return;
+        }
+        this->pickUp(true);
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->jobAvailable.notify_all();
+        for(std::thread& worker : this->workers){
+            worker.join();
+        }
+        this->workers.clear();
+        this->previousFrame = nullptr;
+
+        uint64_t indexOffset = this->fileOffset;
+        uint64_t count = this->index.size();
+        std::fwrite(indexMagic, sizeof(indexMagic), 1, this->file);
+        std::fwrite(&count, sizeof(count), 1, this->file);
+        std::fwrite(this->index.data(), sizeof(indexEntry), this->index.size(), this->file);
+        fileTrailer trailer;
+        trailer.indexOffset = indexOffset;
+        std::memcpy(trailer.magic, trailerMagic, sizeof(trailer.magic));
+        std::fwrite(&trailer, sizeof(trailer), 1, this->file);
+        std::fclose(this->file);
+        this->file = nullptr;
+        this->readback.destroy();
+        this->message = std::to_string(this->written) + " frames written to " + this->path;
+    }
+
+    bool isRecording() const{
+        return this->file != nullptr;
+    }
+
+    /*
+        Called after every step, only does anything every interval steps while recording
+        Assumes the simulation texture is bound to image unit 0
+    */
+    void capture(long long step){
+        if(this->file == nullptr || step % this->interval != 0){
+            return;
+        }
+        this->pickUp(false);
+        if(this->readback.full()){
+            long long oldest;
+            this->submit(this->readback.wait(&oldest), oldest); // Never drop a frame, wait for the oldest one instead
+            this->readback.release();
+        }
+        GLDebugGroup("Quantize trail");
+        GLCall(glClearNamedBufferSubData(this->quantizedSSBO.getID(), GL_R32UI, 0, sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+        GLCall(glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT));
+        this->shader.setUniform1f("maxDeposit", this->maxDeposit);
+        this->shader.execute(((this->texelCount + 1) / 2 + QT_GROUPSIZE - 1) / QT_GROUPSIZE, 1, 1);
+        this->readback.requestBuffer(this->quantizedSSBO.getID(), 0, this->readback.getCapacity(), step);
+    }
+
+    /*
+        Passes on any frames the GPU has finished with, never blocks (unless the workers are behind)
+    */
+    void poll(){
+        if(this->file != nullptr){
+            this->pickUp(false);
+        }
+    }
+
+    void setPath(const std::string& path){
+        path.copy(this->path, sizeof(this->path) - 1);
+        this->path[std::min(path.size(), sizeof(this->path) - 1)] = '\0';
+    }
+
+    void setInterval(int interval){
+        this->interval = (interval < 1)? 1 : interval;
+    }
+
+    void setMaxDeposit(float maxDeposit){
+        this->maxDeposit = (maxDeposit > 0)? maxDeposit : 1.0f;
+    }
+
+    uint32_t getFramesWritten(){
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->written;
+    }
+
+    const std::string& getMessage() const{
+        return this->message;
+    }
+
+    void drawSettings(int res){
+        bool recording = this->file != nullptr;
+        if(!recording){ // These are fixed for the whole file
+            ImGui::InputText("Recording path", this->path, sizeof(this->path));
+            ImGui::SliderFloat("Deposit range", &this->maxDeposit, 0.01, 16);
+            ImGui::SliderInt("Keyframe interval", &this->keyframeInterval, 1, 256);
+            ImGui::SliderInt("Compression level", &this->compressionLevel, 0, 9);
+            ImGui::SliderInt("Compression threads", &this->threads, 1, std::max(1, encoding::defaultThreadCount()));
+        }
+        ImGui::SliderInt("Record interval", &this->interval, 1, 600);
+        if(ImGui::Button(recording ? "Stop recording" : "Start recording")){
+            if(recording){
+                this->stop();
+            }else{
+                this->start(res);
+            }
+        }
+        if(!this->message.empty()){
+            ImGui::SameLine();
+            ImGui::TextWrapped("%s", this->message.c_str());
+        }
+        if(recording){
+            std::lock_guard<std::mutex> lock(this->mutex);
+            ImGui::Text("%u frames written, %u queued, %.1f MB (%.1fx smaller than raw 16 bit)", this->written, this->submitted - this->written,
+                        this->storedBytes / 1e6, (this->storedBytes > 0)? (double)this->rawBytes / this->storedBytes : 0.0);
+            if(this->lastClipped > 0){
+                ImGui::TextColored(ImVec4(1, 0.5, 0, 1), "%u texels above the deposit range in the last frame", this->lastClipped);
+            }
+        }
+    }
+};
+
+}
@@ -0,0 +1,235 @@
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "simulation.hpp"
+#include "recording/parameterJournal.hpp"
+#include "../misc/json.hpp"
+
+namespace simulation{
+
+/*
+    Plays a settings journal (see recording/parameterJournal.hpp) back without a window, stepping as fast as the GPU
+    goes and exporting frames on the way, so a session explored at a low resolution can be rendered properly afterwards
+
+    Every change is applied at the same step it was made at. At another resolution the settings which are lengths in
+    texels (parameter::texels) are scaled with it and the agents start in the same places relative to the texture, so
+    the result looks like the session did, just with more detail (it isnt the same simulation though, and even at the
+    same resolution the GPU doesnt promise bit identical results)
+*/
+class replay{
+public:
+    struct options{
+        int resolution = 0; // 0 = the journalled resolution of each restart
+        int agents = 0; // 0 = the journalled agent count of each restart
+        int every = 0; // Export a frame every this many steps, 0 = only at the end of each replayed restart
+        int segment = -1; // Only replay the restart with this number (0 = the start of the session), -1 = all of them
+        std::string prefix = "replayFrame"; // Frames are prefix_<n>.<format>
+        std::string format = encoding::availableFormats().back();
+        int region = simulation::frameExport::REGION_WHOLE;
+        float custom[4] = {0, 0, 0, 0}; // REGION_CUSTOM, in texels of the replayed resolution
+        int width = 0; // Exported frame size, 0 = one pixel per texel (see frameExport::setOutputSize)
+        int height = 0;
+    };
+
+private:
+    options settings;
+    std::vector<json::value> entries;
+    std::unique_ptr<simulation::main> sim;
+    std::map<std::string, std::vector<double>> journalled; // Every setting as last journalled, unscaled
+    json::value lastView;
+    double scale = 1; // Replayed/journalled resolution
+    int segment = -1; // Restarts seen so far - 1
+    bool frameIsCurrent = false; // Whether the last step has been exported already
+    long long stepsRun = 0;
+    long long framesWritten = 0;
+
+    bool active() const{
+        return this->sim != nullptr && (this->settings.segment < 0 || this->segment == this->settings.segment);
+    }
+
+    void apply(const std::string& name, const std::vector<double>& values){
+        std::vector<double> scaled = values;
+        for(const simulation::main::parameter& p : this->sim->getParameters()){
+            if(p.texels && name == p.name){
+                for(double& v : scaled){
+                    v *= this->scale;
+                }
+            }
+        }
+        if(!this->sim->setParameter(name, scaled)){
+            std::cout << "Ignoring unknown setting " << name << std::endl;
+        }
+    }
+
+    void applyView(){
+        if(this->lastView.type != json::value::OBJECT){
+            return;
+        }
+        const json::value& offset = this->lastView["offset"];
+        float x = (offset.array.size() == 2)? offset.array[0].number : 0;
+        float y = (offset.array.size() == 2)? offset.array[1].number : 0;
+        this->sim->setView(x, y, this->lastView.getNumber("zoom", 1), this->lastView.getNumber("ratio", 1));
+        this->sim->setRepeat(this->lastView.getNumber("repeat", 0) != 0);
+    }
+
+    void exportFrame(){
+        this->sim->exportFrame(this->settings.prefix + "_" + std::to_string(this->framesWritten) + "." + this->settings.format);
+        this->framesWritten++;
+        this->frameIsCurrent = true;
+    }
+
+    void advance(long long step){
+        while(this->sim->getStepCount() < step){
+            this->sim->applySettings();
+            this->sim->step();
+            this->stepsRun++;
+            this->frameIsCurrent = false;
+            if(this->settings.every > 0 && this->sim->getStepCount() % this->settings.every == 0){
+                this->exportFrame();
+            }
+        }
+    }
+
+    void endSegment(){
+        if(this->active() && !this->frameIsCurrent){
+            this->exportFrame();
+        }
+    }
+
+    void restart(const json::value& entry){
+        int journalRes = (int)entry.getNumber("resolution", 1024);
+        int res = (this->settings.resolution > 0)? this->settings.resolution : journalRes;
+        int agents = (this->settings.agents > 0)? this->settings.agents : (int)entry.getNumber("agents", 0);
+        int seed = (int)entry.getNumber("seed", 0);
+        this->scale = (double)res / std::max(journalRes, 1);
+        if(this->sim == nullptr){
+            this->sim = std::make_unique<simulation::main>(agents, res);
+            this->sim->setParameter("seed", seed);
+            this->sim->setup();
+            simulation::frameExport& exporter = this->sim->getExporter();
+            exporter.setRegion(this->settings.region);
+            if(this->settings.region == simulation::frameExport::REGION_CUSTOM){
+                exporter.setCustomRegion(this->settings.custom[0], this->settings.custom[1], this->settings.custom[2], this->settings.custom[3]);
+            }
+            exporter.setOutputSize(this->settings.width, this->settings.height);
+        }else{
+            if(!this->sim->setParameter("agentCount", agents) || !this->sim->setParameter("resolution", res) || !this->sim->setParameter("seed", seed)){
+                throw std::runtime_error("restart out of range: " + std::to_string(agents) + " agents at " + std::to_string(res) + "x" + std::to_string(res));
+            }
+            if(!this->sim->restart()){
+                throw std::runtime_error("restart refused: " + this->sim->getPreflightMessage());
+            }
+        }
+        if(!this->sim->getPreflightMessage().empty()){
+            std::cout << this->sim->getPreflightMessage() << std::endl;
+        }
+        for(const auto& setting : this->journalled){ // The scale may have changed, and skipped restarts never applied theirs
+            this->apply(setting.first, setting.second);
+        }
+        this->applyView();
+        this->frameIsCurrent = false;
+        std::cout << "Restart " << this->segment << ": " << this->sim->getAgentCount() << " agents at " << this->sim->getResolution() << "x" << this->sim->getResolution() << ", seed " << seed << std::endl;
+    }
+
+public:
+    replay(const std::string& journalPath, const options& settings) : settings(settings){
+        std::ifstream file(journalPath);
+        if(!file.good()){
+            throw std::runtime_error("Cant open journal " + journalPath);
+        }
+        std::string line;
+        int lineNumber = 0;
+        while(std::getline(file, line)){
+            lineNumber++;
+            if(line.empty()){
+                continue;
+            }
+            try{
+                this->entries.push_back(json::parse(line));
+            }catch(const std::exception& e){
+                throw std::runtime_error(journalPath + " line " + std::to_string(lineNumber) + ": " + e.what());
+            }
+        }
+        if(this->entries.empty() || this->entries[0].getString("cmd") != "journal"){
+            throw std::runtime_error(journalPath + " isnt a settings journal");
+        }
+        if(this->entries[0].getNumber("version", 0) > recording::journalVersion){
+            throw std::runtime_error(journalPath + " was written by a newer version");
+        }
+    }
+
+    /*
+        Runs the whole journal (or the chosen restart of it), the OpenGL context must be current
+    */
+    void run(){
+        for(const json::value& entry : this->entries){
+            std::string cmd = entry.getString("cmd");
+            long long step = (long long)entry.getNumber("step", 0);
+            if(this->active()){
+                this->advance(step);
+            }
+            if(cmd == "restart"){
+                this->endSegment();
+                this->segment++;
+                if(this->settings.segment >= 0 && this->segment > this->settings.segment){
+                    break; // Past the one being replayed
+                }
+                if(this->settings.segment < 0 || this->segment == this->settings.segment){
+                    this->restart(entry);
+                }
+            }else if(cmd == "set"){
+                for(const auto& setting : entry["params"].object){
+                    const json::value& v = setting.second;
+                    std::vector<double> values;
+                    if(v.type == json::value::ARRAY){
+                        for(const json::value& element : v.array){
+                            values.push_back((element.type == json::value::BOOLEAN)? element.boolean : element.number);
+                        }
+                    }else{
+                        values.push_back((v.type == json::value::BOOLEAN)? v.boolean : v.number);
+                    }
+                    this->journalled[setting.first] = values;
+                    if(this->active()){
+                        this->apply(setting.first, values);
+                    }
+                }
+            }else if(cmd == "view"){
+                this->lastView = entry;
+                if(this->active()){
+                    this->applyView();
+                }
+            }else if(cmd == "end"){
+                break;
+            }
+        }
+        this->endSegment();
+        if(this->sim != nullptr){
+            this->sim->flushExports();
+            simulation::frameExport& exporter = this->sim->getExporter();
+            if(exporter.getFramesFailed() > 0){
+                this->framesWritten -= (long long)exporter.getFramesFailed();
+                std::cout << exporter.getFramesFailed() << " frames couldnt be written, the last was " << exporter.getLastFailed() << std::endl;
+            }
+        }
+        if(this->settings.segment >= 0 && this->segment < this->settings.segment){
+            throw std::runtime_error("the journal only has " + std::to_string(this->segment + 1) + " restarts");
+        }
+    }
+
+    long long getStepsRun() const{
+        return this->stepsRun;
+    }
+
+    long long getFramesWritten() const{
+        return this->framesWritten;
+    }
+};
+
+}
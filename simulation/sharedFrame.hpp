@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+    #include "distributed/sharedMemory.hpp"
+#endif
+
+namespace simulation{
+
+    /*
+        Layout of the shared memory segment the frame publisher writes (see framePublisher.hpp), it shows up as /dev/shm/<name>
+
+            sharedFrameHeader
+            pixels of slot 0      at slots[0].offset, slotBytes long
+            pixels of slot 1      at slots[1].offset
+
+        Frames go to the two slots in turn, so the newest one is never written over until the next one is finished and
+        a reader gets a whole frame interval to look at it. Each slot is a seqlock: its sequence is odd while the publisher
+        writes it, so a reader checks the sequence is even before looking and unchanged afterwards, and throws away what
+        it saw if not. Readers never write to the segment, any number of them can attach
+
+        Pixels are RGBA rows from y = 0, as 8 bit or as half floats (which keep deposits above 1), the trail is the alpha
+        If closed becomes 1 the publisher has let go of the segment (stopped, or needed a bigger one) and readers should attach again
+    */
+    const char sharedFrameMagic[8] = {'S','L','I','M','E','S','H','M'};
+    const uint32_t sharedFrameVersion = 1;
+
+    enum sharedFrameFormat : uint32_t{
+        SHARED_RGBA8 = 0,
+        SHARED_RGBA16F = 1
+    };
+
+    struct sharedFrameSlot{
+        std::atomic<uint64_t> sequence; // Odd while the slot is being written
+        uint64_t step; // Simulation step the frame is from
+        uint64_t offset; // Of the pixels, from the start of the segment
+        uint32_t width;
+        uint32_t height;
+        uint32_t format; // sharedFrameFormat
+        uint32_t reserved;
+    };
+
+    struct sharedFrameHeader{
+        char magic[8];
+        uint32_t version;
+        uint32_t headerBytes; // sizeof(sharedFrameHeader)
+        uint64_t slotBytes; // Room for pixels in each slot
+        std::atomic<uint64_t> published; // Frames finished so far, the newest is in slots[(published - 1) % 2]
+        std::atomic<uint32_t> closed;
+        uint32_t reserved;
+        sharedFrameSlot slots[2];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free, "shared frame atomics must be lock free to work across processes");
+
+    inline size_t sharedFramePixelBytes(uint32_t format){
+        return (format == SHARED_RGBA16F)? 8 : 4;
+    }
+
+#ifndef _WIN32
+    /*
+        Attaches to a published segment read-only and looks at the newest frame in place, for C++ consumers
+        Anything else can do the same from the layout above, e.g. numpy on an mmap of /dev/shm/<name>
+    */
+    class sharedFrameReader{
+        private:
+            distributed::sharedMemory memory;
+
+        public:
+            void attach(const std::string& name){
+                this->memory.attach(name, true);
+                const sharedFrameHeader* header = this->memory.at<sharedFrameHeader>(0);
+                if(this->memory.getSize() < sizeof(sharedFrameHeader) || std::memcmp(header->magic, sharedFrameMagic, 8) != 0){
+                    this->memory.release();
+                    throw std::runtime_error(name + " isnt a GLSLSlime frame segment");
+                }
+                if(header->version > sharedFrameVersion){
+                    this->memory.release();
+                    throw std::runtime_error(name + " was made by a newer version");
+                }
+            }
+
+            bool closed() const{
+                return this->memory.getSize() == 0 || this->memory.at<sharedFrameHeader>(0)->closed.load(std::memory_order_acquire) != 0;
+            }
+
+            uint64_t published() const{
+                return this->memory.at<sharedFrameHeader>(0)->published.load(std::memory_order_acquire);
+            }
+
+            /*
+                Calls f(pixels, slot) with the newest frame, returns true if the frame wasnt written over while f looked at it
+                On false whatever f worked out has to be thrown away (try again, the publisher has moved on to a newer frame)
+            */
+            template<typename F>
+            bool read(F f) const{
+                const sharedFrameHeader* header = this->memory.at<sharedFrameHeader>(0);
+                uint64_t published = header->published.load(std::memory_order_acquire);
+                if(published == 0){
+                    return false;
+                }
+                const sharedFrameSlot& slot = header->slots[(published - 1) % 2];
+                uint64_t before = slot.sequence.load(std::memory_order_acquire);
+                if(before % 2 != 0){
+                    return false;
+                }
+                f(this->memory.at<const void>(slot.offset), slot);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return slot.sequence.load(std::memory_order_relaxed) == before;
+            }
+    };
+#endif
+
+}
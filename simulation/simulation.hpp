@@ -1,12 +1,16 @@
+#pragma once
 #include <vector>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cstdio>
+#include <cmath>
+#include <stdexcept>
 
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
-#include <opencv2/opencv.hpp>
 
 #include "OpenGLComponents/VAO.hpp"
 #include "OpenGLComponents/VBO.hpp"
@@ -14,6 +18,20 @@
 #include "OpenGLComponents/simulationTexture.hpp"
 #include "OpenGLComponents/computeShader.hpp"
 #include "OpenGLComponents/SSBO.hpp"
+#include "OpenGLComponents/displayPyramid.hpp"
+#include "OpenGLComponents/timerQuery.hpp"
+#include "OpenGLComponents/memoryTracker.hpp"
+#include "OpenGLComponents/senseMap.hpp"
+#include "statistics.hpp"
+#include "worldMaps.hpp"
+#include "frameExport.hpp"
+#include "framePublisher.hpp"
+#include "agentGrid.hpp"
+#include "encoding/frameWriter.hpp"
+#include "recording/trailRecorder.hpp"
+#include "recording/agentTracer.hpp"
+#include "recording/parameterJournal.hpp"
+#include "../misc/allocationCounter.hpp"
 
 // ! Important, these must be the same as the compute shader group sizes
 #define DF_GROUPSIZE 32
@@ -44,6 +62,31 @@ namespace simulation{
         double prevMouseClickXPos = -1;
         double prevMouseClickYPos = -1;
         bool rmbClicked = false;
+
+        /*
+            Applies any scrolling and right click dragging since the last call to a view, returns true if it changed
+            Used by both the simulation and the threaded renderer (simulationThread.hpp) so they pan and zoom the same
+        */
+        bool consumeViewInput(float& offsetX, float& offsetY, float& zoomMultiplier){
+            bool changed = false;
+            if(scrollYOffset != 0){
+                zoomMultiplier -= (scrollYOffset / 40.0f) * zoomMultiplier*5;
+                zoomMultiplier = (zoomMultiplier < 0)? 0 : zoomMultiplier;
+                scrollYOffset = 0;
+                changed = true;
+            }
+            if(rmbClicked){
+                double xr = prevMouseClickXPos / mouseClickXPos;
+                double yr = prevMouseClickYPos / mouseClickYPos;
+                offsetX += (1-xr)*zoomMultiplier;
+                offsetY -= (1-yr)*zoomMultiplier;
+                rmbClicked = false;
+                prevMouseClickXPos = mouseClickXPos;
+                prevMouseClickYPos = mouseClickYPos;
+                changed = true;
+            }
+            return changed;
+        }
     }
 
     /*
@@ -81,6 +124,8 @@ private: // ==================================================== PRIVATE =======
     int agentCount;
     int widthHeightResolution;
     int widthHeightResolution_current;
+    int seed = -1; // Seed for the starting agent positions, -1 = different every time
+    int seed_current = 0; // The seed the current agents were actually made with
 
 
     /*
@@ -92,6 +137,8 @@ private: // ==================================================== PRIVATE =======
     float offsetX_inShader = offsetX; // These three are passed to the vertex shader in quadShader.vert.glsl
     float offsetY_inShader = offsetY;
     float zoomMultiplier_inShader = zoomMultiplier;
+    bool downsampleDisplay = true; // Show a downsampled copy of the texture when zoomed out far enough that texels are smaller than pixels
+    int displayLevel_inShader = 0; // Passed to quadShader.frag.glsl, 0 = full resolution texture
 
 
     /*
@@ -104,6 +151,10 @@ private: // ==================================================== PRIVATE =======
     bool drawSensors = false;
     float diffuse = 0.7;
     float fade = 0.1;
+    bool filteredSensing = false; // Sense a filtered copy of the trail through a sampler instead of single texels of the image
+    float sensorFootprint = 1; // Width in texels of the area each sensor averages over (filtered sensing only)
+    bool forwardSensor = false;
+    float sensorLod = 0; // log2 of sensorFootprint
     float sensorDistance_inShader = sensorDistance; // This and the following four are passed to agent.compute.glsl
     float sensorAngle_inShader = sensorAngle;
     float turnSpeed_inShader = turnSpeed;
@@ -111,6 +162,17 @@ private: // ==================================================== PRIVATE =======
     bool drawSensors_inShader = drawSensors;
     float diffuse_inShader = diffuse; // This is and fade are passed to diffuseFade.compute.glsl
     float fade_inShader = fade;
+    bool filteredSensing_inShader = filteredSensing; // This and the following two are passed to agent.compute.glsl (and diffuseFade.compute.glsl for filteredSensing)
+    float sensorLod_inShader = sensorLod;
+    bool forwardSensor_inShader = forwardSensor;
+    bool neighbourInteraction = false; // Sort the agents into a grid every step so they can react to the agents around them
+    float neighbourRadius = 8; // Texels
+    float repulsion = 0.5; // Negative pulls agents together instead
+    float crowdingLimit = 0; // Above this many neighbours less trail is deposited, 0 = no limit
+    int neighbourChecks = 64; // Most candidates each agent looks at, bounds the cost in crowded cells
+    bool neighbourInteraction_inShader = neighbourInteraction; // This and the following two are passed to agent.compute.glsl
+    float repulsion_inShader = repulsion;
+    float crowdingLimit_inShader = crowdingLimit;
 
 
     /*
@@ -129,6 +191,43 @@ private: // ==================================================== PRIVATE =======
     float sensorColour_inShader[3];
 
 
+    /*
+        Obstacle/food maps
+    */
+    simulation::worldMaps maps;
+
+
+    /*
+        Statistics
+    */
+    long long stepCount = 0;
+    simulation::statistics stats;
+
+
+    /*
+        Raw deposit recording
+    */
+    recording::trailRecorder recorder;
+
+
+    /*
+        Per-agent tracing
+    */
+    recording::agentTracer tracer;
+
+
+    /*
+        Settings/restart journal, for replaying the session later (see recording/parameterJournal.hpp)
+    */
+    recording::parameterJournal journal;
+
+
+    /*
+        Live trail for other processes, through shared memory (see framePublisher.hpp)
+    */
+    simulation::framePublisher publisher;
+
+
     /*
         Animation rendering
     */
@@ -136,6 +235,33 @@ private: // ==================================================== PRIVATE =======
     int animFrameCount = 0;
     int renderedFrameCount = 0;
     int frameInterval = 1;
+    encoding::frameWriter frameWriter;
+    simulation::frameExport exporter;
+    std::vector<std::string> formats = encoding::availableFormats(); // Looked up once, the UI lists them every frame
+    std::vector<const char*> formatNames; // Of the above, for ImGui::Combo
+    int frameFormat = (int)this->formats.size() - 1; // Index into formats
+    std::string animationPath; // Reused for every animation frame, so naming one doesnt allocate
+
+
+    /*
+        Debugging
+    */
+    int glDebugLevel = debugging::level;
+    allocations::frameCounter allocationCounter; // Only counts anything with GLSLSLIME_COUNT_ALLOCATIONS
+
+
+    /*
+        Memory
+    */
+    int memoryPolicy = 1; // What to do when a restart wont fit in memory, 0 = refuse, 1 = downscale until it fits
+    std::string preflightMessage;
+
+
+    /*
+        Profiling, GPU time of each stage of a step
+    */
+    openGLComponents::timerQuery diffuseTimer;
+    openGLComponents::timerQuery agentTimer;
 
 
     /*
@@ -164,6 +290,10 @@ private: // ==================================================== PRIVATE =======
     openGLComponents::simulationTexture simTexture;
     openGLComponents::computeShader agentComputeShader;
     openGLComponents::computeShader diffuseFadeShader;
+    openGLComponents::computeShader downsampleShader;
+    openGLComponents::displayPyramid displayPyramid;
+    openGLComponents::senseMap senseMap; // Only created while filtered sensing is on
+    simulation::agentGrid grid; // Only has buffers while neighbour interaction is on
     struct computeShaderStruct{
         float xPos = 0;
         float yPos = 0;
@@ -175,13 +305,76 @@ private: // ==================================================== PRIVATE =======
     openGLComponents::SSBO SSBO; // Above vector will be stored in this SSBO
 
 
+    /*
+        Every setting that can be changed by name (through the control socket), see registerParameters()
+    */
+public:
+    struct parameter{
+        const char* name;
+        float* f = nullptr; // Exactly one of these three is set
+        int* i = nullptr;
+        bool* b = nullptr;
+        int components = 1; // 3 for colours
+        bool restart = false; // Only takes effect after restart()
+        bool texels = false; // A length in texels, scaled when a journal is replayed at another resolution
+        float min = 0; // Range the UI offers, only enforced by setParameter() for restart settings
+        float max = 1;
+    };
+private:
+    std::vector<parameter> parameters;
+
+    void registerParameters(){
+        auto add = [this](const char* name, float* f, int* i, bool* b, float min=0, float max=1, int components=1, bool restart=false){
+            parameter p;
+            p.name = name;
+            p.f = f;
+            p.i = i;
+            p.b = b;
+            p.components = components;
+            p.restart = restart;
+            p.min = min;
+            p.max = max;
+            this->parameters.push_back(p);
+        };
+        add("sensorDistance", &this->sensorDistance, nullptr, nullptr, 0, 300);
+        this->parameters.back().texels = true;
+        add("sensorAngle", &this->sensorAngle, nullptr, nullptr, 0, 3.1416);
+        add("turnSpeed", &this->turnSpeed, nullptr, nullptr, 0, 5);
+        add("speed", &this->speed, nullptr, nullptr, 0.01, 25);
+        this->parameters.back().texels = true;
+        add("diffuse", &this->diffuse, nullptr, nullptr, 0, 1);
+        add("fade", &this->fade, nullptr, nullptr, 0, 0.2);
+        add("drawSensors", nullptr, nullptr, &this->drawSensors);
+        add("filteredSensing", nullptr, nullptr, &this->filteredSensing);
+        add("sensorFootprint", &this->sensorFootprint, nullptr, nullptr, 1, 64);
+        this->parameters.back().texels = true;
+        add("forwardSensor", nullptr, nullptr, &this->forwardSensor);
+        add("neighbourInteraction", nullptr, nullptr, &this->neighbourInteraction);
+        add("neighbourRadius", &this->neighbourRadius, nullptr, nullptr, 1, 64);
+        this->parameters.back().texels = true;
+        add("repulsion", &this->repulsion, nullptr, nullptr, -2, 2);
+        add("crowdingLimit", &this->crowdingLimit, nullptr, nullptr, 0, 64);
+        add("neighbourChecks", nullptr, &this->neighbourChecks, nullptr, 1, 512);
+        add("mainAgentColour", this->mainAgentColour, nullptr, nullptr, 0, 1, 3);
+        add("agentXDirectionColour", this->agentXDirectionColour, nullptr, nullptr, 0, 1, 3);
+        add("agentYDirectionColour", this->agentYDirectionColour, nullptr, nullptr, 0, 1, 3);
+        add("sensorColour", this->sensorColour, nullptr, nullptr, 0, 1, 3);
+        add("renderFrames", nullptr, nullptr, &this->renderFrames);
+        add("frameInterval", nullptr, &this->frameInterval, nullptr, 1, 10);
+        add("agentCount", nullptr, &this->agentCount, nullptr, 0, 1 << 27, 1, true); // Past the UI's range, preflight() checks what actually fits
+        add("resolution", nullptr, &this->widthHeightResolution, nullptr, 1, 4096*2, 1, true);
+        add("seed", nullptr, &this->seed, nullptr, -1, 0x7FFFFFFF, 1, true); // Journalled seeds can be anything restart() makes
+    }
+
+
     /*
         Useful functions
     */
     void generateAgents(){ // Fills this->agentData with some randomly generated (but valid) data for the simulation to start with
         this->agentData.clear();
         std::random_device rd;
-        std::mt19937 gen(rd());
+        this->seed_current = (this->seed >= 0)? this->seed : (int)(rd() & 0x7FFFFFFF); // Kept (and fits the seed setting) so the journal can make the same agents again
+        std::mt19937 gen((unsigned int)this->seed_current);
         std::uniform_real_distribution<> dis(0, 1);
         for(int i = 0; i < this->agentCount; i++){
             computeShaderStruct temp;
@@ -192,6 +385,130 @@ private: // ==================================================== PRIVATE =======
         }
     }
 
+    /*
+        Hands every setting (apart from the restart ones, which the restart entries cover) and the view to the journal,
+        which only writes down the ones that changed
+    */
+    void journalSettings(){
+        double values[3];
+        for(size_t i = 0; i < this->parameters.size(); i++){
+            const parameter& p = this->parameters[i];
+            if(p.restart){
+                continue;
+            }
+            for(int c = 0; c < p.components; c++){
+                values[c] = (p.f != nullptr)? p.f[c] : (p.i != nullptr)? p.i[c] : p.b[c];
+            }
+            this->journal.record(this->stepCount, i, p.name, values, p.components);
+        }
+        this->journal.view(this->stepCount, this->offsetX_inShader, this->offsetY_inShader, this->zoomMultiplier_inShader, this->textureRatio, this->simTexture.getRepeat());
+    }
+
+    /*
+        Which level of detail is needed to show the texture at the current zoom, so that one screen pixel covers
+        between one and two texels of the level (0 = full resolution, n = downsampled n times)
+    */
+    int requiredDisplayLevel(){
+        if(!this->downsampleDisplay){
+            return 0;
+        }
+        float texelsPerPixel = this->widthHeightResolution_current * this->zoomMultiplier / winGlobals::currentHeight;
+        int level = 0;
+        while(texelsPerPixel >= 2.0f && level < this->displayPyramid.getLevels()){
+            texelsPerPixel /= 2.0f;
+            level++;
+        }
+        return level;
+    }
+
+    /*
+        Estimated memory needed by the simulation with a given agent count and resolution, on the device and on the host
+    */
+    struct footprint{
+        long long device = 0;
+        long long host = 0;
+    };
+
+    footprint estimateFootprint(long long agents, long long res){
+        footprint f;
+        f.device += 16 * res * res; // Simulation texture
+        f.device += openGLComponents::displayPyramid::bytesFor(res);
+        f.device += 16 * agents; // Agent SSBO
+        f.device += simulation::statistics::bytesFor(res, agents);
+        f.device += this->maps.bytesFor(res);
+        if(this->neighbourInteraction){
+            f.device += simulation::agentGrid::bytesFor(agents, res, this->neighbourRadius);
+        }
+        if(this->filteredSensing){
+            f.device += openGLComponents::senseMap::bytesFor(res);
+        }
+        f.host += 16 * agents; // this->agentData
+        if(this->renderFrames){
+            f.host += (16 + 4 + 2*5) * res * res; // Exported frames are copied out as floats, converted to 8 bit and then encoded (worst case 5 bytes per pixel, twice)
+        }
+        return f;
+    }
+
+    /*
+        Checks that the requested agent count and resolution fit within the GL limits and the device/host memory that is free
+        Memory used by the current simulation counts as free since restart() releases it first
+        Depending on memoryPolicy, a configuration which doesnt fit is either refused (returns false) or scaled down until it does
+    */
+    bool preflight(){
+        int maxTextureSize = 0;
+        GLint64 maxBlockSize = 0;
+        GLCall(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize));
+        GLCall(glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize));
+        openGLComponents::memory::deviceInfo device = openGLComponents::memory::queryDevice();
+        long long deviceBudget = (device.availableBytes < 0)? -1 : (device.availableBytes + openGLComponents::memory::deviceTotal()) * 9 / 10;
+        long long hostAvailable = openGLComponents::memory::hostAvailable();
+        long long hostBudget = (hostAvailable < 0)? -1 : (hostAvailable + 16LL * (long long)this->agentData.capacity()) * 9 / 10;
+
+        long long agents = this->agentCount;
+        long long res = this->widthHeightResolution;
+        auto fits = [&](){
+            footprint f = this->estimateFootprint(agents, res);
+            return res <= maxTextureSize && 16 * agents <= maxBlockSize
+                && (deviceBudget < 0 || f.device <= deviceBudget) && (hostBudget < 0 || f.host <= hostBudget);
+        };
+        this->preflightMessage.clear();
+        if(res < 1 || agents < 0){
+            this->preflightMessage = "resolution must be at least 1 and the agent count cant be negative, restart refused";
+            return false;
+        }
+        footprint requested = this->estimateFootprint(agents, res);
+        if(fits()){
+            return true;
+        }
+        char message[512];
+        snprintf(message, sizeof(message), "%lld agents at %lldx%lld needs %.0f MB device/%.0f MB host, budget is %.0f MB/%.0f MB (max texture %d)",
+                 agents, res, res, openGLComponents::memory::toMB(requested.device), openGLComponents::memory::toMB(requested.host),
+                 openGLComponents::memory::toMB(deviceBudget), openGLComponents::memory::toMB(hostBudget), maxTextureSize);
+        this->preflightMessage = message;
+        if(this->memoryPolicy == 0){
+            this->preflightMessage += ", restart refused";
+            return false;
+        }
+        // Texture is usually the biggest thing, so that gets halved first, then the agent count
+        while(!fits() && res > 512){
+            res /= 2;
+        }
+        while(!fits() && agents > 0){
+            agents /= 2;
+        }
+        while(!fits() && res > 1){
+            res /= 2;
+        }
+        if(!fits()){
+            this->preflightMessage += ", nothing fits";
+            return false;
+        }
+        this->agentCount = agents;
+        this->widthHeightResolution = res;
+        this->preflightMessage += ", scaled down to " + std::to_string(agents) + " agents at " + std::to_string(res) + "x" + std::to_string(res);
+        return true;
+    }
+
     template<typename T> bool arryCmp(T* arr1, T* arr2, int size){
         for(int i = 0; i < size; i++){
             if(arr1[i] != arr2[i]){
@@ -202,6 +519,24 @@ private: // ==================================================== PRIVATE =======
     }
 
 
+    /*
+        Names the GL objects so they show up properly in debugger/profiler captures
+    */
+    void labelObjects(){
+        GLObjectLabel(GL_BUFFER, this->vbo.getID(), "Quad VBO");
+        GLObjectLabel(GL_VERTEX_ARRAY, this->vao.getID(), "Quad VAO");
+        GLObjectLabel(GL_PROGRAM, this->shader.getID(), "Quad shader");
+        GLObjectLabel(GL_PROGRAM, this->agentComputeShader.getID(), "Agent compute shader");
+        GLObjectLabel(GL_PROGRAM, this->diffuseFadeShader.getID(), "Diffuse/fade compute shader");
+        GLObjectLabel(GL_TEXTURE, this->simTexture.getID(), "Simulation texture");
+        GLObjectLabel(GL_BUFFER, this->SSBO.getID(), "Agent SSBO");
+        GLObjectLabel(GL_PROGRAM, this->downsampleShader.getID(), "Downsample compute shader");
+        if(this->displayPyramid.getID() != 0){
+            GLObjectLabel(GL_TEXTURE, this->displayPyramid.getID(), "Display pyramid");
+        }
+    }
+
+
     /*
         These functions helps get rid of some repetitive code in the update function
     */
@@ -236,6 +571,10 @@ public: // ==================================================== PUBLIC =========
     main(unsigned int n_agents=10000, unsigned int n_widthHeightResolution=1024){
         this->agentCount = n_agents;
         this->widthHeightResolution = n_widthHeightResolution;
+        this->registerParameters();
+        for(const std::string& format : this->formats){
+            this->formatNames.push_back(format.c_str());
+        }
         // Setting the inShader values to the values of the pointers, as it is assumed that they will be set very soon by this->setup():
         for(int i = 0; i < 3; i++){ 
             this->mainAgentColour_inShader[i] = this->mainAgentColour[i];
@@ -277,6 +616,18 @@ public: // ==================================================== PUBLIC =========
         this->shader.setUniform1f("offsetX", this->offsetX_inShader);
         this->shader.setUniform1f("offsetY", this->offsetY_inShader);
         this->shader.setUniform1f("zoomMultiplier", this->zoomMultiplier_inShader);
+        this->shader.setUniform1i("pyramidSampler", 1);
+        this->shader.setUniform1i("displayLevel", this->displayLevel_inShader);
+
+        // Create the compute shader and texture for the downsampled copy shown when zoomed out
+        this->downsampleShader.createShaderFromDisk("GLSL/downsample.compute.glsl");
+        this->displayPyramid.init(this->widthHeightResolution_current);
+
+        // Create the compute shader which crops and scales exported frames
+        this->exporter.setup();
+
+        // Create the compute shader which sorts agents into a grid for neighbour queries, its buffers are made on first use
+        this->grid.setup();
         
         // Create the compute shader to simulate the agents
         this->agentComputeShader.createShaderFromDisk("GLSL/agent.compute.glsl");
@@ -287,6 +638,12 @@ public: // ==================================================== PUBLIC =========
         this->agentComputeShader.setUniform1f("turnSpeed", this->turnSpeed_inShader);
         this->agentComputeShader.setUniform1f("speed", this->speed_inShader);
         this->agentComputeShader.setUniform1i("drawSensors", this->drawSensors_inShader);
+        this->agentComputeShader.setUniform1i("filteredSensing", this->filteredSensing_inShader);
+        this->agentComputeShader.setUniform1f("sensorLod", this->sensorLod_inShader);
+        this->agentComputeShader.setUniform1i("useForwardSensor", this->forwardSensor_inShader);
+        this->agentComputeShader.setUniform1i("useNeighbours", this->neighbourInteraction_inShader);
+        this->agentComputeShader.setUniform1f("repulsion", this->repulsion_inShader);
+        this->agentComputeShader.setUniform1f("crowdingLimit", this->crowdingLimit_inShader);
         this->agentComputeShader.setUniform3f("sensorColour", this->sensorColour_inShader[0], this->sensorColour_inShader[1], this->sensorColour_inShader[2]);
         this->agentComputeShader.setUniform3f("mainAgentColour", this->mainAgentColour_inShader[0], this->mainAgentColour_inShader[1], this->mainAgentColour_inShader[2]);
         this->agentComputeShader.setUniform3f("agentXDirectionColour", this->agentXDirectionColour_inShader[0], this->agentXDirectionColour_inShader[1], this->agentXDirectionColour_inShader[2]);
@@ -298,35 +655,60 @@ public: // ==================================================== PUBLIC =========
         this->diffuseFadeShader.setUniform1f("size", this->widthHeightResolution_current);
         this->diffuseFadeShader.setUniform1f("diffuse", this->diffuse_inShader);
         this->diffuseFadeShader.setUniform1f("fade", this->fade_inShader);
+        this->diffuseFadeShader.setUniform1i("writeSenseMap", this->filteredSensing_inShader);
         
         // Generate starting agent data, create an SSBO from it, and bind it to the compute shader
         this->generateAgents();
         this->SSBO.generate(this->agentData);
         this->SSBO.bind(this->agentComputeShader.getID(), "agentData", 0);
+        this->stats.setup(this->widthHeightResolution_current, this->agentCount);
+        this->stats.bindAgents(this->SSBO, 0);
+        this->journal.restart(0, (int)this->agentData.size(), this->widthHeightResolution_current, this->seed_current);
+
+        this->labelObjects();
     }
 
 
     /*
         Reset the simulation back to a starting state
         This assumes that setup() has already been called
+        Returns false if the requested settings wont fit in memory (see preflight())
     */
-    void restart(){
+    bool restart(){
+        if(!this->preflight()){
+            return false; // Requested settings wont fit, preflightMessage says why
+        }
+
+        this->recorder.stop(); // A recording has a fixed resolution, so it ends here
+        this->tracer.stop(); // Agent IDs mean something else after a restart
+
         // Reset the texture
         this->widthHeightResolution_current = this->widthHeightResolution;
         this->simTexture.destroy();
         this->simTexture.init(this->widthHeightResolution_current);
         this->simTexture.clear();
+        this->simTexture.bind(); // Anything run before the next step (e.g. a stats command) reads image unit 0
+        this->displayPyramid.init(this->widthHeightResolution_current);
+        this->senseMap.destroy(); // Gets recreated at the new resolution by the next step
+        this->maps.reload(this->widthHeightResolution_current); // Maps are resampled to the texture resolution
 
         // Reset agent SSBO
         this->generateAgents();
         this->SSBO.generate(this->agentData);
         this->SSBO.bind(this->agentComputeShader.getID(), "agentData", 0);
+        this->journal.restart(this->stepCount, (int)this->agentData.size(), this->widthHeightResolution_current, this->seed_current);
+        this->stepCount = 0;
+        this->stats.setup(this->widthHeightResolution_current, this->agentCount);
+        this->stats.bindAgents(this->SSBO, 0);
 
         // Ensure that the size uniform in both of the compute shaders is set to the correct value
         this->diffuseFadeShader.use();
         this->diffuseFadeShader.setUniform1f("size", this->widthHeightResolution_current);
         this->agentComputeShader.use();
         this->agentComputeShader.setUniform1i("size", this->widthHeightResolution_current);
+
+        this->labelObjects(); // Texture and SSBO are new objects, so they need labelling again
+        return true;
     }
 
 
@@ -334,23 +716,301 @@ public: // ==================================================== PUBLIC =========
         Perform a single step of the simulation
     */
     void step(){
+        GLDebugGroup("Simulation step");
+        this->journalSettings(); // Before anything runs, so the entry's step is the number of steps which ran without the change
         this->simTexture.bind();
-        this->diffuseFadeShader.execute((this->widthHeightResolution_current+DF_GROUPSIZE-1)/DF_GROUPSIZE, (this->widthHeightResolution_current+DF_GROUPSIZE-1)/DF_GROUPSIZE, 1);
-        this->agentComputeShader.execute(this->agentData.size()/AG_GROUPSIZE, 1, 1);
+        this->maps.apply(this->agentComputeShader, this->diffuseFadeShader);
+        if(this->filteredSensing_inShader){
+            if(this->senseMap.getID() == 0){
+                this->senseMap.init(this->widthHeightResolution_current);
+                GLObjectLabel(GL_TEXTURE, this->senseMap.getID(), "Sense map");
+            }
+            this->senseMap.bindImage(1);
+        }
+        {
+            GLDebugGroup("Diffuse/fade");
+            this->diffuseTimer.begin();
+            this->diffuseFadeShader.execute((this->widthHeightResolution_current+DF_GROUPSIZE-1)/DF_GROUPSIZE, (this->widthHeightResolution_current+DF_GROUPSIZE-1)/DF_GROUPSIZE, 1);
+            this->diffuseTimer.end();
+        }
+        if(this->filteredSensing_inShader){
+            GLDebugGroup("Sense map levels");
+            GLCall(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT));
+            this->senseMap.generateLevels((int)std::ceil(this->sensorLod_inShader));
+            this->senseMap.bindSampler(4);
+        }
+        if(this->neighbourInteraction_inShader){
+            this->grid.build(this->SSBO, this->agentData.size(), this->widthHeightResolution_current, this->neighbourRadius, this->neighbourChecks);
+        }
+        {
+            GLDebugGroup("Agents");
+            this->tracer.apply(this->agentComputeShader, this->stepCount + 1);
+            this->agentTimer.begin();
+            this->agentComputeShader.execute((this->agentData.size()+AG_GROUPSIZE-1)/AG_GROUPSIZE, 1, 1);
+            this->agentTimer.end();
+            this->tracer.capture();
+        }
+        this->displayPyramid.invalidate();
+        this->stepCount++;
+        this->stats.measure(this->stepCount);
+        this->recorder.capture(this->stepCount);
+        this->publisher.capture(this->simTexture.getID(), this->widthHeightResolution_current, this->simTexture.getRepeat(), this->stepCount);
     }
 
 
     /*
         Render the quad and texture
+        The display pyramid is only built here, so it costs nothing for steps which never get shown
     */
     void render(){
+        GLDebugGroup("Render quad");
+        int displayLevel = this->requiredDisplayLevel();
+        this->displayPyramid.build(this->downsampleShader, this->simTexture.getID(), displayLevel);
         this->simTexture.bind();
+        this->displayPyramid.bind(1);
         this->shader.use();
+        if(displayLevel != this->displayLevel_inShader){
+            this->displayLevel_inShader = displayLevel;
+            this->shader.setUniform1i("displayLevel", this->displayLevel_inShader);
+        }
         this->vao.bind();
         glDrawArrays(GL_TRIANGLES, 0, this->quadVertices.size() / 5);
     }
 
 
+    /*
+        Pushes any settings which have changed into the shaders and picks up finished GPU readbacks
+        update() calls this every frame, without a UI (headless control) it has to be called directly
+    */
+    void applySettings(){
+        this->checkSet1f_compute("sensorDistance", this->sensorDistance, this->sensorDistance_inShader, this->agentComputeShader);
+        this->checkSet1f_compute("sensorAngle", this->sensorAngle, this->sensorAngle_inShader, this->agentComputeShader);
+        this->checkSet1f_compute("turnSpeed", this->turnSpeed, this->turnSpeed_inShader, this->agentComputeShader);
+        this->checkSet1f_compute("diffuse", this->diffuse, this->diffuse_inShader, this->diffuseFadeShader);
+        this->checkSet1f_compute("fade", this->fade, this->fade_inShader, this->diffuseFadeShader);
+        this->checkSet1f_compute("speed", this->speed, this->speed_inShader, this->agentComputeShader);
+        this->checkSet3f_compute("mainAgentColour", this->mainAgentColour, this->mainAgentColour_inShader, this->agentComputeShader);
+        this->checkSet3f_compute("agentXDirectionColour", this->agentXDirectionColour, this->agentXDirectionColour_inShader, this->agentComputeShader);
+        this->checkSet3f_compute("agentYDirectionColour", this->agentYDirectionColour, this->agentYDirectionColour_inShader, this->agentComputeShader);
+        this->checkSet1i_compute("drawSensors", this->drawSensors, this->drawSensors_inShader, this->agentComputeShader);
+        this->checkSet3f_compute("sensorColour", this->sensorColour, this->sensorColour_inShader, this->agentComputeShader);
+        this->sensorLod = std::log2(this->sensorFootprint < 1 ? 1 : this->sensorFootprint);
+        this->checkSet1f_compute("sensorLod", this->sensorLod, this->sensorLod_inShader, this->agentComputeShader);
+        this->checkSet1i_compute("useForwardSensor", this->forwardSensor, this->forwardSensor_inShader, this->agentComputeShader);
+        if(this->filteredSensing != this->filteredSensing_inShader){
+            this->checkSet1i_compute("filteredSensing", this->filteredSensing, this->filteredSensing_inShader, this->agentComputeShader);
+            this->diffuseFadeShader.setUniform1i("writeSenseMap", this->filteredSensing_inShader);
+            if(!this->filteredSensing_inShader){
+                this->senseMap.destroy(); // No point keeping the memory around
+            }
+        }
+        if(this->neighbourInteraction != this->neighbourInteraction_inShader){
+            this->checkSet1i_compute("useNeighbours", this->neighbourInteraction, this->neighbourInteraction_inShader, this->agentComputeShader);
+            if(!this->neighbourInteraction_inShader){
+                this->grid.release();
+            }
+        }
+        this->checkSet1f_compute("repulsion", this->repulsion, this->repulsion_inShader, this->agentComputeShader);
+        this->checkSet1f_compute("crowdingLimit", this->crowdingLimit, this->crowdingLimit_inShader, this->agentComputeShader);
+        this->stats.poll();
+        this->recorder.poll();
+        this->tracer.poll();
+        this->exporter.poll(this->frameWriter);
+        this->publisher.poll();
+    }
+
+
+    frameExport::view currentView() const{
+        frameExport::view v;
+        v.offsetX = this->offsetX_inShader;
+        v.offsetY = this->offsetY_inShader;
+        v.zoomMultiplier = this->zoomMultiplier_inShader;
+        v.textureRatio = this->textureRatio;
+        return v;
+    }
+
+    /*
+        Queues the export region of the simulation texture (see frameExport.hpp) to be written to an image file
+        once the GPU is done with it, applySettings() picks it up
+    */
+    void exportFrame(const std::string& path){
+        this->exporter.request(this->simTexture.getID(), this->widthHeightResolution_current, this->simTexture.getRepeat(), this->currentView(), path, this->frameWriter);
+    }
+
+    /*
+        Writes the export region of the simulation texture to an image file right away, throws if it cant be
+    */
+    void saveFrame(const std::string& path){
+        this->exportFrame(path);
+        if(!this->flushExports()){
+            throw std::runtime_error("Couldnt write " + this->exporter.getLastFailed());
+        }
+    }
+
+    /*
+        Waits for every queued export to be written, returns false if any of them couldnt be
+    */
+    bool flushExports(){
+        return this->exporter.flush(this->frameWriter);
+    }
+
+    /*
+        Exports a frame for the animation if rendering frames is turned on, every frameInterval calls
+        update() calls this once per frame, the simulation thread once per step
+    */
+    void captureAnimationFrame(){
+        if(this->renderFrames && this->renderedFrameCount % this->frameInterval == 0){
+            char name[64];
+            std::snprintf(name, sizeof(name), "animFrame_%d.%s", this->animFrameCount, this->frameWriter.extension());
+            this->animationPath = name; // Keeps the string's buffer from the last frame
+            this->exportFrame(this->animationPath);
+            this->animFrameCount++;
+        }
+        this->renderedFrameCount++;
+    }
+
+    /*
+        Moves the view (what render() shows and what the "current view" export region crops to)
+        textureRatio is the window's width/height
+    */
+    void setView(float offsetX, float offsetY, float zoomMultiplier, float textureRatio){
+        this->offsetX = offsetX;
+        this->offsetY = offsetY;
+        this->zoomMultiplier = zoomMultiplier;
+        this->textureRatio = textureRatio;
+        this->offsetX_inShader = offsetX;
+        this->offsetY_inShader = offsetY;
+        this->zoomMultiplier_inShader = zoomMultiplier;
+        this->shader.setUniform1f("offsetX", this->offsetX_inShader);
+        this->shader.setUniform1f("offsetY", this->offsetY_inShader);
+        this->shader.setUniform1f("zoomMultiplier", this->zoomMultiplier_inShader);
+        this->shader.setUniform1f("textureRatio", this->textureRatio);
+    }
+
+
+    /*
+        Settings by name, mostly for the control socket
+        Values are converted to whatever type the setting is, colours take 3 values
+        Returns false if there is no setting with that name or the wrong number of values was given, or if a restart
+        setting is outside its range (the rest only look odd out of range, restart settings size buffers and textures)
+    */
+    bool setParameter(const std::string& name, const std::vector<double>& values){
+        for(parameter& p : this->parameters){
+            if(name != p.name){
+                continue;
+            }
+            if((int)values.size() != p.components){
+                return false;
+            }
+            for(int c = 0; c < p.components && p.restart; c++){
+                if(!(values[c] >= p.min && values[c] <= p.max)){ // NaN fails too
+                    return false;
+                }
+            }
+            for(int c = 0; c < p.components; c++){
+                if(p.f != nullptr){ p.f[c] = values[c]; }
+                if(p.i != nullptr){ p.i[c] = (int)values[c]; }
+                if(p.b != nullptr){ p.b[c] = values[c] != 0; }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool setParameter(const std::string& name, double value){
+        return this->setParameter(name, std::vector<double>{value});
+    }
+
+    std::vector<double> getParameter(const parameter& p) const{
+        std::vector<double> values;
+        for(int c = 0; c < p.components; c++){
+            values.push_back((p.f != nullptr)? p.f[c] : (p.i != nullptr)? p.i[c] : p.b[c]);
+        }
+        return values;
+    }
+
+    const std::vector<parameter>& getParameters() const{
+        return this->parameters;
+    }
+
+    long long getStepCount() const{
+        return this->stepCount;
+    }
+
+    const std::string& getPreflightMessage() const{
+        return this->preflightMessage;
+    }
+
+    /*
+        Measures the statistics right now and waits for the result, rather than waiting for the next interval
+    */
+    const simulation::statistics::result& measureStatistics(){
+        this->stats.measure(this->stepCount, true);
+        this->stats.flush();
+        return this->stats.getLatest();
+    }
+
+    simulation::statistics& getStatistics(){
+        return this->stats;
+    }
+
+    recording::trailRecorder& getRecorder(){
+        return this->recorder;
+    }
+
+    simulation::frameExport& getExporter(){
+        return this->exporter;
+    }
+
+    recording::agentTracer& getTracer(){
+        return this->tracer;
+    }
+
+    /*
+        Writes the journal of this session so far (see recording/parameterJournal.hpp), an empty path uses the one set in the UI
+    */
+    bool saveJournal(const std::string& path=""){
+        this->journalSettings(); // Changes since the last step havent been written down yet
+        return this->journal.save(this->stepCount, path);
+    }
+
+    recording::parameterJournal& getJournal(){
+        return this->journal;
+    }
+
+    simulation::framePublisher& getPublisher(){
+        return this->publisher;
+    }
+
+    int getAgentCount() const{
+        return (int)this->agentData.size();
+    }
+
+    int getResolution() const{
+        return this->widthHeightResolution_current;
+    }
+
+    unsigned int getTextureID() const{
+        return this->simTexture.getID();
+    }
+
+    unsigned int getAgentBufferID() const{
+        return this->SSBO.getID();
+    }
+
+    bool getRepeat() const{
+        return this->simTexture.getRepeat();
+    }
+
+    // Whether the texture wraps around when shown (and exported) zoomed out
+    void setRepeat(bool repeat){
+        if(repeat != this->simTexture.getRepeat()){
+            this->simTexture.toggleRepeat();
+            this->displayPyramid.setRepeat(repeat);
+        }
+    }
+
+
     /*
         ImGUI + setting various uniforms based on the values in the ImGUI window
     */
@@ -370,99 +1030,141 @@ public: // ==================================================== PUBLIC =========
         ImGui::ColorEdit3("Agent X Direction Colour", this->agentXDirectionColour);
         ImGui::ColorEdit3("Agent Y Direction Colour", this->agentYDirectionColour);
         ImGui::Checkbox("Draw Sensors", &this->drawSensors);
+        ImGui::Checkbox("Filtered sensing", &this->filteredSensing);
+        ImGui::SameLine();
+        ImGui::Checkbox("Forward sensor", &this->forwardSensor);
+        ImGui::SliderFloat("Sensor footprint", &this->sensorFootprint, 1, 64);
         ImGui::ColorEdit3("Sensor Colour", this->sensorColour);
         if(ImGui::Button("Toggle texture repeat")){
-            this->simTexture.toggleRepeat();
+            this->setRepeat(!this->simTexture.getRepeat());
         }
+        ImGui::Checkbox("Downsample display when zoomed out", &this->downsampleDisplay);
         ImGui::Dummy(ImVec2(0, 10));
         ImGui::Checkbox("Render frames to disk", &this->renderFrames);
         ImGui::SliderInt("Frame interval", &this->frameInterval, 1, 10);
+        if(ImGui::Combo("Frame format", &this->frameFormat, this->formatNames.data(), this->formatNames.size())){
+            this->frameWriter.setFormat(this->formats[this->frameFormat]);
+        }
+        this->exporter.drawSettings(this->widthHeightResolution_current, this->currentView());
+        if(ImGui::CollapsingHeader("World maps")){
+            this->maps.drawSettings(this->widthHeightResolution_current);
+        }
+        if(ImGui::CollapsingHeader("Statistics")){
+            this->stats.drawSettings();
+        }
+        if(ImGui::CollapsingHeader("Trail recording")){
+            this->recorder.drawSettings(this->widthHeightResolution_current);
+        }
+        if(ImGui::CollapsingHeader("Neighbours")){
+            ImGui::Checkbox("Agents react to nearby agents", &this->neighbourInteraction);
+            ImGui::SliderFloat("Neighbour radius", &this->neighbourRadius, 1, 64);
+            ImGui::SliderFloat("Repulsion (negative attracts)", &this->repulsion, -2, 2);
+            ImGui::SliderFloat("Crowding limit (0 = off)", &this->crowdingLimit, 0, 64);
+            ImGui::SliderInt("Neighbour checks per agent", &this->neighbourChecks, 1, 512);
+            if(this->neighbourInteraction){
+                ImGui::Text("Grid: %dx%d cells, %.1f MB", this->grid.getCellsPerAxis(), this->grid.getCellsPerAxis(),
+                            openGLComponents::memory::toMB(simulation::agentGrid::bytesFor(this->agentData.size(), this->widthHeightResolution_current, this->neighbourRadius)));
+            }
+        }
+        if(ImGui::CollapsingHeader("Agent tracing")){
+            this->tracer.drawSettings((int)this->agentData.size(), this->stepCount);
+        }
+        if(ImGui::CollapsingHeader("Shared memory")){
+            this->publisher.drawSettings(this->widthHeightResolution_current);
+        }
+        if(ImGui::CollapsingHeader("Journal")){
+            if(this->journal.drawSettings()){
+                this->saveJournal();
+            }
+        }
         ImGui::Dummy(ImVec2(0, 10));
         ImGui::Text("Restart required for the following settings:");
         ImGui::SliderInt("Agent Count", &this->agentCount, 0, 5000000);
-        ImGui::SliderInt("Texture Resolution", &this->widthHeightResolution, 0, 4096*2);
+        ImGui::SliderInt("Texture Resolution", &this->widthHeightResolution, 1, 4096*2);
+        ImGui::InputInt("Seed (-1 = random)", &this->seed);
+        ImGui::Combo("If it doesnt fit in memory", &this->memoryPolicy, "Refuse restart\0Downscale\0");
+        footprint estimate = this->estimateFootprint(this->agentCount, this->widthHeightResolution);
+        ImGui::Text("Estimated memory: %.1f MB device, %.1f MB host", openGLComponents::memory::toMB(estimate.device), openGLComponents::memory::toMB(estimate.host));
         ImGui::Dummy(ImVec2(0, 10));
         if(ImGui::Button("Restart")){
             this->restart();
         }
+        if(!this->preflightMessage.empty()){
+            ImGui::TextWrapped("%s", this->preflightMessage.c_str());
+        }
         ImGui::End();
 
         // Draw the window for displaying info
         ImGui::SetNextWindowPos(ImVec2(0, 520), ImGuiCond_Always);
-        ImGui::SetNextWindowSize(ImVec2(600, 340), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(600, 440), ImGuiCond_Always);
         ImGui::Begin("Info");
         ImGui::Text("FPS: %f", ImGui::GetIO().Framerate);
+        if(ImGui::Combo("GL debug level", &this->glDebugLevel, "Off\0Callback only\0Full checking\0")){
+            debugging::setLevel(this->glDebugLevel);
+            this->glDebugLevel = debugging::level; // Cant go above what was compiled in
+        }
         ImGui::Text("Rendered Frames: %d", this->renderedFrameCount);
         ImGui::Text("Anim Frames: %d", this->animFrameCount);
         ImGui::Text("OffsetX_inShader: %f", this->offsetX_inShader);
         ImGui::Text("OffsetY_inShader: %f", this->offsetY_inShader);
         ImGui::Text("ZoomMultiplier_inShader: %f", this->zoomMultiplier_inShader);
+        ImGui::Text("DisplayLevel_inShader: %d", this->displayLevel_inShader);
         ImGui::Text("SensorDistance_inShader: %f", this->sensorDistance_inShader);
         ImGui::Text("SensorAngle_inShader: %f", this->sensorAngle_inShader);
         ImGui::Text("TurnSpeed_inShader: %f", this->turnSpeed_inShader);
         ImGui::Text("Speed_inShader: %f", this->speed_inShader);
         ImGui::Text("DrawSensors_inShader: %d", this->drawSensors_inShader);
+        ImGui::Text("FilteredSensing_inShader: %d, SensorLod_inShader: %f, ForwardSensor_inShader: %d", this->filteredSensing_inShader, this->sensorLod_inShader, this->forwardSensor_inShader);
+        ImGui::Text("Neighbours_inShader: %d, Repulsion_inShader: %f, CrowdingLimit_inShader: %f", this->neighbourInteraction_inShader, this->repulsion_inShader, this->crowdingLimit_inShader);
         ImGui::Text("Diffuse_inShader: %f", this->diffuse_inShader);
         ImGui::Text("Fade_inShader: %f", this->fade_inShader);
         ImGui::Text("MainAgentColour_inShader: %f, %f, %f", this->mainAgentColour_inShader[0], this->mainAgentColour_inShader[1], this->mainAgentColour_inShader[2]);
         ImGui::Text("AgentXDirectionColour_inShader: %f, %f, %f", this->agentXDirectionColour_inShader[0], this->agentXDirectionColour_inShader[1], this->agentXDirectionColour_inShader[2]);
         ImGui::Text("AgentYDirectionColour_inShader: %f, %f, %f", this->agentYDirectionColour_inShader[0], this->agentYDirectionColour_inShader[1], this->agentYDirectionColour_inShader[2]);
         ImGui::Text("SensorColour_inShader: %f, %f, %f", this->sensorColour_inShader[0], this->sensorColour_inShader[1], this->sensorColour_inShader[2]);
+        ImGui::Text("Steps: %lld", this->stepCount);
+        if(allocations::counted){
+            this->allocationCounter.sample(); // Once a frame, so this is everything since the last update()
+            ImGui::Text("Allocations last frame: %llu (%llu bytes), frames with any: %llu", this->allocationCounter.frameCount, this->allocationCounter.frameBytes, this->allocationCounter.framesWithAllocations);
+        }
+        if(ImGui::CollapsingHeader("Memory")){
+            openGLComponents::memory::deviceInfo device = openGLComponents::memory::queryDevice();
+            ImGui::Text("Textures: %.1f MB, buffers: %.1f MB, readback: %.1f MB", openGLComponents::memory::toMB(openGLComponents::memory::get(openGLComponents::memory::TEXTURE)),
+                        openGLComponents::memory::toMB(openGLComponents::memory::get(openGLComponents::memory::BUFFER)), openGLComponents::memory::toMB(openGLComponents::memory::get(openGLComponents::memory::READBACK)));
+            ImGui::Text("Host agent data: %.1f MB", openGLComponents::memory::toMB(16LL * this->agentData.capacity()));
+            if(device.availableBytes >= 0){
+                ImGui::Text("Device free: %.0f MB of %.0f MB (%s)", openGLComponents::memory::toMB(device.availableBytes), openGLComponents::memory::toMB(device.totalBytes), device.source);
+            }else{
+                ImGui::Text("Device free: unknown (driver doesnt report it)");
+            }
+            ImGui::Text("Host available: %.0f MB", openGLComponents::memory::toMB(openGLComponents::memory::hostAvailable()));
+        }
+        if(ImGui::CollapsingHeader("Profiler")){
+            ImGui::Text("Diffuse/fade: %.3f ms", this->diffuseTimer.getAverageMs());
+            ImGui::Text("Agents: %.3f ms", this->agentTimer.getAverageMs());
+            if(this->neighbourInteraction_inShader){
+                ImGui::Text("Neighbour grid build: %.3f ms", this->grid.getBuildMs());
+                ImGui::Text("Neighbour queries: %.3f ms", this->grid.getQueryMs());
+            }
+        }
+        this->stats.drawInfo();
         ImGui::End();
 
-        // Check if any of the uniforms need to be updated, and if so, update them
-        this->checkSet1f_compute("sensorDistance", this->sensorDistance, this->sensorDistance_inShader, this->agentComputeShader);
-        this->checkSet1f_compute("sensorAngle", this->sensorAngle, this->sensorAngle_inShader, this->agentComputeShader);
-        this->checkSet1f_compute("turnSpeed", this->turnSpeed, this->turnSpeed_inShader, this->agentComputeShader);
-        this->checkSet1f_compute("diffuse", this->diffuse, this->diffuse_inShader, this->diffuseFadeShader);
-        this->checkSet1f_compute("fade", this->fade, this->fade_inShader, this->diffuseFadeShader);
-        this->checkSet1f_compute("speed", this->speed, this->speed_inShader, this->agentComputeShader);
-        this->checkSet3f_compute("mainAgentColour", this->mainAgentColour, this->mainAgentColour_inShader, this->agentComputeShader);
-        this->checkSet3f_compute("agentXDirectionColour", this->agentXDirectionColour, this->agentXDirectionColour_inShader, this->agentComputeShader);
-        this->checkSet3f_compute("agentYDirectionColour", this->agentYDirectionColour, this->agentYDirectionColour_inShader, this->agentComputeShader);
-        this->checkSet1i_compute("drawSensors", this->drawSensors, this->drawSensors_inShader, this->agentComputeShader);
-        this->checkSet3f_compute("sensorColour", this->sensorColour, this->sensorColour_inShader, this->agentComputeShader);
+        this->applySettings();
 
         // Check if any input needs to be processed
-        if(controlGlobals::scrollYOffset != 0){
-            this->zoomMultiplier -= (controlGlobals::scrollYOffset / 40.0f) * this->zoomMultiplier*5;
-            this->zoomMultiplier = (this->zoomMultiplier < 0)? 0 : this->zoomMultiplier;
-            controlGlobals::scrollYOffset = 0;
-            this->zoomMultiplier_inShader = this->zoomMultiplier;
-            this->shader.setUniform1f("zoomMultiplier", this->zoomMultiplier_inShader);
-        }
-        if(controlGlobals::rmbClicked){
-            double xr = controlGlobals::prevMouseClickXPos / controlGlobals::mouseClickXPos;
-            double yr = controlGlobals::prevMouseClickYPos / controlGlobals::mouseClickYPos;
-            this->offsetX += (1-xr)*this->zoomMultiplier;
-            this->offsetY -= (1-yr)*this->zoomMultiplier;
-            controlGlobals::rmbClicked = false;
-            controlGlobals::prevMouseClickXPos = controlGlobals::mouseClickXPos;
-            controlGlobals::prevMouseClickYPos = controlGlobals::mouseClickYPos;
-            this->offsetX_inShader = this->offsetX;
-            this->shader.setUniform1f("offsetX", this->offsetX_inShader);
-            this->offsetY_inShader = this->offsetY;
-            this->shader.setUniform1f("offsetY", this->offsetY_inShader);
+        if(controlGlobals::consumeViewInput(this->offsetX, this->offsetY, this->zoomMultiplier)){
+            this->setView(this->offsetX, this->offsetY, this->zoomMultiplier, this->textureRatio);
         }
 
         // Check if window size has changed, and if so, update the texture ratio to ensure it doesnt get distorted
         if(winGlobals::currentHeight != winGlobals::newHeight || winGlobals::currentWidth != winGlobals::newWidth){
             winGlobals::currentHeight = winGlobals::newHeight;
             winGlobals::currentWidth = winGlobals::newWidth;
-            this->textureRatio = (float)winGlobals::currentWidth/winGlobals::currentHeight;
-            this->shader.setUniform1f("textureRatio", this->textureRatio);
+            this->setView(this->offsetX, this->offsetY, this->zoomMultiplier, (float)winGlobals::currentWidth/winGlobals::currentHeight);
         }
 
-        if(this->renderFrames && this->renderedFrameCount % this->frameInterval == 0){
-            float* pixels = this->simTexture.getTexImage();
-            cv::Mat img(this->widthHeightResolution_current, this->widthHeightResolution_current, CV_32FC4, pixels);
-            img *= 255;
-            cv::cvtColor(img, img, cv::COLOR_RGBA2BGRA);
-            cv::imwrite("animFrame_" + std::to_string(this->animFrameCount) + ".png", img);
-            this->animFrameCount++;
-            free(pixels);
-        }
-        this->renderedFrameCount++;        
+        this->captureAnimationFrame();
     }
     
 };
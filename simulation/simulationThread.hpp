@@ -0,0 +1,514 @@
+#pragma once
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/gl.h>
+#include <imgui.h>
+
+#include "simulation.hpp"
+#include "control.hpp"
+#include "OpenGLComponents/frameHandoff.hpp"
+#include "../misc/spscQueue.hpp"
+#include "../misc/headlessContext.hpp"
+#include "../misc/controlSocket.hpp"
+
+namespace simulation{
+
+/*
+    Runs simulation::main on its own thread with its own (shared) OpenGL context, so stepping is never held back by vsync
+    or the UI, and the UI stays responsive however long a step takes
+
+    The two threads only share:
+        - messages, through a lock free queue each way (settings, restarts and exports to the simulation, current values and notices back)
+        - frames, the simulation copies its texture into a frameHandoff whenever the renderer has taken the last one
+        - the step counter and step rate, as atomics
+    The render thread keeps the window, ImGui and the pan/zoom, and draws the newest frame with its own quad and shader
+    (VAOs arent shared between contexts). The control socket is polled on the simulation thread
+
+    The UI is generated from the simulation's parameter list, so the advanced panels (maps, statistics, recording, tracing)
+    are only available over the control socket in this mode
+*/
+class simulationThread{
+public:
+    struct message{
+        enum kind{ SET = 0, RESTART = 1, FRAME = 2, VIEW = 3, PAUSE = 4, REPEAT = 5, NOTICE = 6 };
+        int type = SET;
+        char text[256] = {}; // Parameter name, export path or notice
+        double values[4] = {};
+        int count = 0; // How many of values are used
+    };
+
+private:
+    /*
+        Shared between the threads
+    */
+    GLFWwindow* window;
+    GLFWwindow* context = nullptr; // Hidden window whose context the simulation thread uses
+    int agentCount;
+    int resolution;
+    std::string controlPath;
+    std::string journalPath; // Where the settings journal is saved when the thread stops, empty = not saved
+    int debugLevel;
+    std::thread thread;
+    std::promise<void> ready; // Set once the simulation is set up, or with whatever exception stopped it
+    std::exception_ptr error; // Written by the simulation thread before it sets finished
+    std::atomic<bool> stopRequested{false};
+    std::atomic<bool> finished{false};
+    std::atomic<bool> quitRequested{false}; // By the control socket
+    std::atomic<long long> steps{0};
+    std::atomic<float> stepsPerSecond{0};
+    threading::spscQueue<message, 256> toSimulation;
+    threading::spscQueue<message, 256> fromSimulation;
+    openGLComponents::frameHandoff handoff;
+
+
+    /*
+        Render thread only
+    */
+    struct setting{
+        std::string name;
+        bool isFloat = false;
+        bool isInt = false;
+        int components = 1;
+        bool restart = false;
+        float min = 0;
+        float max = 1;
+        float f[3] = {0, 0, 0};
+        int i = 0;
+        bool b = false;
+        bool dirty = false; // Changed in the UI but not sent yet, the queue was full
+    };
+    std::vector<setting> settings; // Filled by the simulation thread before ready is set
+    float offsetX = 0;
+    float offsetY = 0;
+    float zoomMultiplier = 1;
+    float textureRatio = (float)winGlobals::windowStartWidth/winGlobals::windowStartHeight;
+    bool viewDirty = true;
+    bool paused = false;
+    bool pausedDirty = false;
+    bool repeat = true;
+    bool repeatDirty = false;
+    bool restartPending = false;
+    char exportPath[256] = "frame.png";
+    std::deque<std::string> notices;
+    openGLComponents::VAO vao;
+    openGLComponents::VBO vbo;
+    openGLComponents::VBOLayout layout;
+    openGLComponents::shader quadShader;
+    unsigned int sampler = 0; // Wrapping is set here, the handoff textures are shared with the simulation thread
+    std::vector<float> quadVertices = {
+        -1.0f, -1.0f, 0.0f,    0.0f, 0.0f,
+         1.0f, -1.0f, 0.0f,    1.0f, 0.0f,
+         1.0f,  1.0f, 0.0f,    1.0f, 1.0f,
+         1.0f,  1.0f, 0.0f,    1.0f, 1.0f,
+        -1.0f,  1.0f, 0.0f,    0.0f, 1.0f,
+        -1.0f, -1.0f, 0.0f,    0.0f, 0.0f
+    };
+
+
+    static void copyText(char* to, const std::string& from){
+        std::strncpy(to, from.c_str(), 255);
+        to[255] = '\0';
+    }
+
+    static message makeMessage(int type, const std::string& text, std::vector<double> values={}){
+        message m;
+        m.type = type;
+        copyText(m.text, text);
+        m.count = (int)std::min(values.size(), (size_t)4);
+        for(int c = 0; c < m.count; c++){
+            m.values[c] = values[c];
+        }
+        return m;
+    }
+
+
+    /*
+        ===== Simulation thread
+    */
+    void notify(const std::string& text){
+        this->fromSimulation.push(makeMessage(message::NOTICE, text)); // Dropped if the renderer is that far behind
+    }
+
+    // Current values of every parameter, so the UI follows changes made over the control socket or by a downscaled restart
+    void sendParameters(simulation::main& sim){
+        for(const simulation::main::parameter& p : sim.getParameters()){
+            this->fromSimulation.push(makeMessage(message::SET, p.name, sim.getParameter(p)));
+        }
+    }
+
+    void handle(simulation::main& sim, const message& m, bool& simPaused){
+        switch(m.type){
+            case message::SET:
+                sim.setParameter(m.text, std::vector<double>(m.values, m.values + m.count));
+                break;
+            case message::RESTART:
+                if(!sim.restart()){
+                    this->notify("Restart refused: " + sim.getPreflightMessage());
+                }
+                this->sendParameters(sim);
+                break;
+            case message::FRAME:
+                try{
+                    sim.exportFrame(m.text);
+                    this->notify(std::string("Exported ") + m.text);
+                }catch(const std::runtime_error& e){ // Format that cant be written, nothing was queued
+                    this->notify(e.what());
+                }
+                break;
+            case message::VIEW:
+                sim.setView(m.values[0], m.values[1], m.values[2], m.values[3]);
+                break;
+            case message::PAUSE:
+                simPaused = m.values[0] != 0;
+                break;
+            case message::REPEAT:
+                sim.setRepeat(m.values[0] != 0);
+                break;
+        }
+    }
+
+    void run(){
+        glfwMakeContextCurrent(this->context);
+        bool setUp = false;
+        try{
+            simulation::main sim(this->agentCount, this->resolution);
+            sim.setup();
+            simulation::controlCommands commands(sim);
+            control::controlSocket socket;
+            if(!this->controlPath.empty()){
+                socket.open(this->controlPath);
+            }
+            for(const simulation::main::parameter& p : sim.getParameters()){
+                setting s;
+                s.name = p.name;
+                s.isFloat = p.f != nullptr;
+                s.isInt = p.i != nullptr;
+                s.components = p.components;
+                s.restart = p.restart;
+                s.min = p.min;
+                s.max = p.max;
+                std::vector<double> values = sim.getParameter(p);
+                for(int c = 0; c < p.components; c++){
+                    s.f[c] = values[c];
+                }
+                s.i = (int)values[0];
+                s.b = values[0] != 0;
+                this->settings.push_back(s);
+            }
+            this->repeat = sim.getRepeat();
+            setUp = true;
+            this->ready.set_value();
+
+            bool simPaused = false;
+            long long publishedStep = -1;
+            unsigned int publishedTexture = 0;
+            auto rateStart = std::chrono::steady_clock::now();
+            long long rateSteps = sim.getStepCount();
+            while(!this->stopRequested.load(std::memory_order_relaxed)){
+                message m;
+                while(this->toSimulation.pop(m)){
+                    this->handle(sim, m, simPaused);
+                }
+                bool handled = false;
+                socket.poll([&](const std::string& line){ handled = true; return commands.handle(line); }, simPaused ? 5 : 0);
+                if(handled){
+                    this->sendParameters(sim);
+                }
+                if(commands.shouldQuit()){
+                    this->quitRequested.store(true);
+                }
+                sim.applySettings();
+                if(!simPaused){
+                    sim.step();
+                    sim.captureAnimationFrame();
+                }else if(!socket.isOpen()){
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5)); // Nothing to do but wait for the UI
+                }
+
+                // Only copy out a frame when the renderer has taken the last one and there is actually something new
+                if(this->handoff.wanted() && (sim.getStepCount() != publishedStep || sim.getTextureID() != publishedTexture)){
+                    this->handoff.publish(sim.getTextureID(), sim.getResolution(), sim.getStepCount());
+                    publishedStep = sim.getStepCount();
+                    publishedTexture = sim.getTextureID();
+                }
+
+                this->steps.store(sim.getStepCount(), std::memory_order_relaxed);
+                auto now = std::chrono::steady_clock::now();
+                double seconds = std::chrono::duration<double>(now - rateStart).count();
+                if(seconds >= 0.5){
+                    this->stepsPerSecond.store((sim.getStepCount() - rateSteps) / seconds, std::memory_order_relaxed);
+                    rateStart = now;
+                    rateSteps = sim.getStepCount();
+                }
+            }
+            if(!this->journalPath.empty() && !sim.saveJournal(this->journalPath)){
+                std::cout << sim.getJournal().getMessage() << std::endl;
+            }
+            this->handoff.destroy(); // Its framebuffers belong to this context
+        }catch(...){
+            this->error = std::current_exception();
+            try{
+                this->handoff.destroy();
+            }catch(...){} // Already failing, the first error is the useful one
+            if(!setUp){
+                this->ready.set_exception(this->error);
+            }
+            this->quitRequested.store(true);
+        }
+        glfwMakeContextCurrent(nullptr);
+        this->finished.store(true, std::memory_order_release);
+    }
+
+
+    /*
+        ===== Render thread
+    */
+    setting* findSetting(const std::string& name){
+        for(setting& s : this->settings){
+            if(s.name == name){
+                return &s;
+            }
+        }
+        return nullptr;
+    }
+
+    void receive(){
+        message m;
+        while(this->fromSimulation.pop(m)){
+            if(m.type == message::NOTICE){
+                this->notices.push_back(m.text);
+                if(this->notices.size() > 5){
+                    this->notices.pop_front();
+                }
+            }else if(setting* s = this->findSetting(m.text)){
+                if(!s->dirty){ // Dont overwrite something the user just changed
+                    for(int c = 0; c < m.count; c++){
+                        s->f[c] = m.values[c];
+                    }
+                    s->i = (int)m.values[0];
+                    s->b = m.values[0] != 0;
+                }
+            }
+        }
+    }
+
+    // Anything that didnt fit in the queue last frame gets another go next frame
+    void send(){
+        for(setting& s : this->settings){
+            if(!s.dirty){
+                continue;
+            }
+            std::vector<double> values;
+            for(int c = 0; c < s.components; c++){
+                values.push_back(s.isFloat ? s.f[c] : s.isInt ? s.i : s.b);
+            }
+            s.dirty = !this->toSimulation.push(makeMessage(message::SET, s.name, values));
+        }
+        if(this->viewDirty){
+            this->viewDirty = !this->toSimulation.push(makeMessage(message::VIEW, "", {this->offsetX, this->offsetY, this->zoomMultiplier, this->textureRatio}));
+        }
+        if(this->pausedDirty){
+            this->pausedDirty = !this->toSimulation.push(makeMessage(message::PAUSE, "", {(double)this->paused}));
+        }
+        if(this->repeatDirty){
+            this->repeatDirty = !this->toSimulation.push(makeMessage(message::REPEAT, "", {(double)this->repeat}));
+        }
+        if(this->restartPending){ // After the settings, so the restart sees them
+            this->restartPending = !this->toSimulation.push(makeMessage(message::RESTART, ""));
+        }
+    }
+
+    void drawSetting(setting& s){
+        bool changed = false;
+        if(s.components == 3){
+            changed = ImGui::ColorEdit3(s.name.c_str(), s.f);
+        }else if(s.isFloat){
+            changed = ImGui::SliderFloat(s.name.c_str(), &s.f[0], s.min, s.max);
+        }else if(s.isInt && s.restart){
+            changed = ImGui::InputInt(s.name.c_str(), &s.i);
+        }else if(s.isInt){
+            changed = ImGui::SliderInt(s.name.c_str(), &s.i, (int)s.min, (int)s.max);
+        }else{
+            changed = ImGui::Checkbox(s.name.c_str(), &s.b);
+        }
+        s.dirty = s.dirty || changed;
+    }
+
+    void join(){
+        if(!this->thread.joinable()){
+            return;
+        }
+        this->stopRequested.store(true);
+        this->thread.join();
+        glfwDestroyWindow(this->context);
+        this->context = nullptr;
+    }
+
+public:
+    simulationThread(GLFWwindow* window, int agentCount, int resolution, const std::string& controlPath, int debugLevel, const std::string& journalPath="")
+        : window(window), agentCount(agentCount), resolution(resolution), controlPath(controlPath), journalPath(journalPath), debugLevel(debugLevel){}
+
+    ~simulationThread(){
+        this->join();
+        if(this->sampler != 0){
+            GLCall(glDeleteSamplers(1, &this->sampler));
+        }
+    }
+
+    /*
+        Starts the simulation thread, the window's context must be current on the calling (main) thread and stays current
+        Rethrows anything that went wrong setting up the simulation
+    */
+    void start(){
+        this->context = headless::createContext(this->debugLevel, this->window); // GLFW only lets the main thread create windows
+        glfwMakeContextCurrent(this->window);
+        std::future<void> setUp = this->ready.get_future();
+        this->thread = std::thread([this](){ this->run(); });
+        try{
+            setUp.get();
+        }catch(...){
+            this->thread.join();
+            glfwDestroyWindow(this->context);
+            this->context = nullptr;
+            throw;
+        }
+
+        this->vbo.generate(this->quadVertices, this->quadVertices.size() * sizeof(float));
+        this->layout.pushFloat(3);
+        this->layout.pushFloat(2);
+        this->vao.addBuffer(this->vbo, this->layout);
+        this->quadShader.createShaderFromDisk("GLSL/quadShader.vert.glsl", "GLSL/quadShader.frag.glsl");
+        this->quadShader.use();
+        this->quadShader.setUniform1i("displayLevel", 0); // The handoff textures have their own mipmaps, so the display pyramid isnt needed
+        GLObjectLabel(GL_VERTEX_ARRAY, this->vao.getID(), "Threaded quad VAO");
+        GLCall(glCreateSamplers(1, &this->sampler));
+        GLCall(glSamplerParameteri(this->sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR)); // Same as the handoff textures
+        GLCall(glSamplerParameteri(this->sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    }
+
+    /*
+        Stops and joins the simulation thread, rethrowing whatever stopped it early (if anything)
+    */
+    void stop(){
+        this->join();
+        if(this->error){
+            std::exception_ptr e = this->error;
+            this->error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    // False once the simulation has stopped by itself (error or a quit command)
+    bool running() const{
+        return !this->quitRequested.load() && !this->finished.load(std::memory_order_acquire);
+    }
+
+
+    /*
+        ImGui and input, render thread only
+    */
+    void update(){
+        this->receive();
+
+        ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(600, 520), ImGuiCond_Always);
+        ImGui::Begin("Simulation");
+        for(setting& s : this->settings){
+            if(!s.restart){
+                this->drawSetting(s);
+            }
+        }
+        if(ImGui::Checkbox("Repeat texture", &this->repeat)){
+            this->repeatDirty = true;
+        }
+        ImGui::SameLine();
+        if(ImGui::Checkbox("Pause", &this->paused)){
+            this->pausedDirty = true;
+        }
+        ImGui::InputText("Export path", this->exportPath, sizeof(this->exportPath));
+        ImGui::SameLine();
+        if(ImGui::Button("Export frame")){
+            this->toSimulation.push(makeMessage(message::FRAME, this->exportPath));
+        }
+        ImGui::Dummy(ImVec2(0, 10));
+        ImGui::Text("Restart required for the following settings:");
+        for(setting& s : this->settings){
+            if(s.restart){
+                this->drawSetting(s);
+            }
+        }
+        if(ImGui::Button("Restart")){
+            this->restartPending = true;
+        }
+        for(const std::string& notice : this->notices){
+            ImGui::TextWrapped("%s", notice.c_str());
+        }
+        ImGui::End();
+
+        long long simSteps = this->steps.load(std::memory_order_relaxed);
+        ImGui::SetNextWindowPos(ImVec2(0, 520), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(600, 200), ImGuiCond_Always);
+        ImGui::Begin("Info");
+        ImGui::Text("FPS: %f", ImGui::GetIO().Framerate);
+        ImGui::Text("Steps: %lld (%.1f per second)", simSteps, this->stepsPerSecond.load(std::memory_order_relaxed));
+        ImGui::Text("Shown frame: step %lld, %lld steps behind", this->handoff.frontStep(), simSteps - this->handoff.frontStep());
+        ImGui::Text("OffsetX: %f, OffsetY: %f, ZoomMultiplier: %f", this->offsetX, this->offsetY, this->zoomMultiplier);
+        ImGui::End();
+
+        if(controlGlobals::consumeViewInput(this->offsetX, this->offsetY, this->zoomMultiplier)){
+            this->viewDirty = true;
+        }
+        if(winGlobals::currentHeight != winGlobals::newHeight || winGlobals::currentWidth != winGlobals::newWidth){
+            winGlobals::currentHeight = winGlobals::newHeight;
+            winGlobals::currentWidth = winGlobals::newWidth;
+            this->textureRatio = (float)winGlobals::currentWidth/winGlobals::currentHeight;
+            this->viewDirty = true;
+        }
+        if(this->viewDirty){
+            this->quadShader.setUniform1f("offsetX", this->offsetX);
+            this->quadShader.setUniform1f("offsetY", this->offsetY);
+            this->quadShader.setUniform1f("zoomMultiplier", this->zoomMultiplier);
+            this->quadShader.setUniform1f("textureRatio", this->textureRatio);
+        }
+        this->send(); // Also tells the simulation about the view, for exports of the current view
+    }
+
+    /*
+        Draws the newest frame the simulation has handed over, render thread only
+    */
+    void render(){
+        unsigned int texture = this->handoff.acquire();
+        if(texture == 0){
+            return; // Nothing finished yet
+        }
+        GLDebugGroup("Render handed off frame");
+        GLenum wrap = this->repeat ? GL_REPEAT : GL_CLAMP_TO_BORDER;
+        GLCall(glSamplerParameteri(this->sampler, GL_TEXTURE_WRAP_S, wrap));
+        GLCall(glSamplerParameteri(this->sampler, GL_TEXTURE_WRAP_T, wrap));
+        GLCall(glBindTextureUnit(0, texture));
+        GLCall(glBindSampler(0, this->sampler));
+        this->quadShader.use();
+        this->vao.bind();
+        glDrawArrays(GL_TRIANGLES, 0, this->quadVertices.size() / 5);
+        GLCall(glBindSampler(0, 0)); // ImGui draws from unit 0 too
+    }
+
+    long long getSteps() const{
+        return this->steps.load(std::memory_order_relaxed);
+    }
+};
+
+}
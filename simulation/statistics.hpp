@@ -0,0 +1,282 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include <imgui.h>
+
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/SSBO.hpp"
+#include "OpenGLComponents/asyncReadback.hpp"
+
+// ! Important, these must be the same as in statistics.compute.glsl
+#define ST_GROUPSIZE 256
+#define ST_GROUPTEXELS 64 // Width/height of the block of texels one work group reduces
+#define ST_HISTOGRAMBINS 16
+
+namespace simulation{
+
+/*
+    Reduces the trail texture and agents to a few numbers on the GPU every N steps, and reads the results back
+    a few frames later through an asyncReadback so that nothing ever waits for the GPU
+*/
+class statistics{
+public:
+    // Matches statisticsResult in statistics.compute.glsl (std430)
+    struct result{
+        unsigned int texelCount = 0;
+        unsigned int coveredTexels = 0;
+        unsigned int agentCount = 0;
+        unsigned int agentsOnTrail = 0;
+        float totalDeposit = 0;
+        float headingX = 0;
+        float headingY = 0;
+        float depositUnderAgents = 0;
+        unsigned int histogram[ST_HISTOGRAMBINS] = {};
+    };
+
+private:
+    /*
+        Settings
+    */
+    bool enabled = true;
+    bool trailStatistics = true; // Total deposit, coverage, histogram
+    bool agentStatistics = true; // Heading, deposit under agents
+    int interval = 30; // Steps between measurements
+    float coverageThreshold = 0.05;
+    float histogramMax = 1.0;
+    bool writeCSV = false;
+    char csvPath[256] = "statistics.csv";
+
+
+    /*
+        Latest results
+    */
+    result latest;
+    long long latestStep = -1;
+    long long requestedStep = -1;
+    int skippedRequests = 0; // Measurements skipped because every readback buffer was still in flight
+    std::ofstream csvFile;
+
+
+    /*
+        OpenGL components
+    */
+    openGLComponents::computeShader shader;
+    openGLComponents::SSBO resultSSBO;
+    openGLComponents::SSBO partialSSBO;
+    openGLComponents::asyncReadback readback;
+    unsigned int trailGroups = 0;
+    unsigned int agentGroups = 0;
+
+    void writeRow(long long step, const result& r){
+        if(!this->csvFile.is_open()){
+            this->csvFile.open(this->csvPath);
+            this->csvFile << "step,totalDeposit,coverage,meanHeadingX,meanHeadingY,headingCoherence,meanDepositUnderAgents,agentsOnTrail";
+            for(int i = 0; i < ST_HISTOGRAMBINS; i++){
+                this->csvFile << ",histogram" << i;
+            }
+            this->csvFile << "\n";
+        }
+        float agents = (r.agentCount > 0)? r.agentCount : 1;
+        float texels = (r.texelCount > 0)? r.texelCount : 1;
+        this->csvFile << step << "," << r.totalDeposit << "," << r.coveredTexels / texels << ","
+                      << r.headingX / agents << "," << r.headingY / agents << "," << std::sqrt(r.headingX*r.headingX + r.headingY*r.headingY) / agents << ","
+                      << r.depositUnderAgents / agents << "," << r.agentsOnTrail / agents;
+        for(int i = 0; i < ST_HISTOGRAMBINS; i++){
+            this->csvFile << "," << r.histogram[i];
+        }
+        this->csvFile << "\n";
+    }
+
+public:
+    ~statistics(){
+        this->closeCSV();
+    }
+
+    /*
+        Creates the shader and buffers, and sizes them for the given texture resolution and agent count
+        Call again after a restart
+    */
+    void setup(int res, int agentCount){
+        if(this->shader.getID() == 0){
+            this->shader.createShaderFromDisk("GLSL/statistics.compute.glsl");
+            GLObjectLabel(GL_PROGRAM, this->shader.getID(), "Statistics compute shader");
+        }
+        unsigned int groupsX = (res + ST_GROUPTEXELS - 1) / ST_GROUPTEXELS;
+        this->trailGroups = groupsX * groupsX;
+        this->agentGroups = (agentCount + ST_GROUPSIZE - 1) / ST_GROUPSIZE;
+        this->shader.setUniform1i("size", res);
+        this->shader.setUniform1ui("agentPartialOffset", this->trailGroups);
+        this->shader.setUniform1ui("trailGroups", this->trailGroups);
+        this->shader.setUniform1ui("agentGroups", this->agentGroups);
+
+        this->resultSSBO.generateZeroed(sizeof(result));
+        this->resultSSBO.bind(this->shader.getID(), "statisticsResult", 6);
+        this->partialSSBO.generateZeroed((this->trailGroups + this->agentGroups + 1) * 4 * sizeof(float));
+        this->partialSSBO.bind(this->shader.getID(), "statisticsPartials", 7);
+        GLObjectLabel(GL_BUFFER, this->resultSSBO.getID(), "Statistics result SSBO");
+        GLObjectLabel(GL_BUFFER, this->partialSSBO.getID(), "Statistics partials SSBO");
+
+        this->readback.init(sizeof(result), 4);
+        this->latestStep = -1;
+        this->requestedStep = -1;
+    }
+
+    /*
+        GPU and readback memory needed for a given texture resolution and agent count
+    */
+    static long long bytesFor(int res, int agentCount){
+        long long groupsX = (res + ST_GROUPTEXELS - 1) / ST_GROUPTEXELS;
+        long long groups = groupsX * groupsX + (agentCount + ST_GROUPSIZE - 1) / ST_GROUPSIZE + 1;
+        return groups * 16 + sizeof(result) * 5; // Partials, the result and 4 readback slots
+    }
+
+    /*
+        Binds the agent buffer for the agent pass, it has to be the same binding point the agent shader uses
+    */
+    void bindAgents(openGLComponents::SSBO& agents, unsigned int bindingPoint){
+        agents.bind(this->shader.getID(), "agentData", bindingPoint);
+    }
+
+    /*
+        Called after every step, only does anything every interval steps (unless force is set)
+        Assumes the simulation texture is bound to image unit 0
+    */
+    void measure(long long step, bool force=false){
+        if(this->shader.getID() == 0 || (!force && (!this->enabled || step % this->interval != 0))){
+            return;
+        }
+        if(force && this->readback.full()){
+            this->flush(); // Make room rather than skipping, the caller is going to wait for the result anyway
+        }
+        if(this->readback.full()){
+            this->skippedRequests++;
+            return;
+        }
+        GLDebugGroup("Statistics");
+        GLCall(glClearNamedBufferData(this->resultSSBO.getID(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+        this->shader.setUniform1f("coverageThreshold", this->coverageThreshold);
+        this->shader.setUniform1f("histogramMax", this->histogramMax);
+        GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        if(this->trailStatistics){
+            this->shader.setUniform1i("pass", 0);
+            this->shader.execute(this->trailGroups, 1, 1);
+        }
+        if(this->agentStatistics){
+            this->shader.setUniform1i("pass", 1);
+            this->shader.execute(this->agentGroups, 1, 1);
+        }
+        GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        this->shader.setUniform1ui("trailGroups", this->trailStatistics ? this->trailGroups : 0);
+        this->shader.setUniform1ui("agentGroups", this->agentStatistics ? this->agentGroups : 0);
+        this->shader.setUniform1i("pass", 2);
+        this->shader.execute(1, 1, 1);
+        this->readback.requestBuffer(this->resultSSBO.getID(), 0, sizeof(result), step);
+        this->requestedStep = step;
+    }
+
+    /*
+        Picks up any results the GPU has finished with, never blocks
+    */
+    void poll(){
+        long long step;
+        while(const void* data = this->readback.poll(&step)){
+            this->latest = *static_cast<const result*>(data);
+            this->latestStep = step;
+            this->readback.release();
+            if(this->writeCSV){
+                this->writeRow(step, this->latest);
+            }
+        }
+    }
+
+    /*
+        Blocks until every outstanding measurement has been picked up (for the end of headless runs)
+    */
+    void flush(){
+        long long step;
+        while(const void* data = this->readback.wait(&step)){
+            this->latest = *static_cast<const result*>(data);
+            this->latestStep = step;
+            this->readback.release();
+            if(this->writeCSV){
+                this->writeRow(step, this->latest);
+            }
+        }
+        if(this->csvFile.is_open()){
+            this->csvFile.flush();
+        }
+    }
+
+    void closeCSV(){
+        if(this->csvFile.is_open()){
+            this->csvFile.close();
+        }
+    }
+
+    void setCSV(bool write, const std::string& path){
+        this->writeCSV = write;
+        if(path != this->csvPath){
+            this->closeCSV();
+            path.copy(this->csvPath, sizeof(this->csvPath) - 1);
+            this->csvPath[std::min(path.size(), sizeof(this->csvPath) - 1)] = '\0';
+        }
+    }
+
+    void setInterval(int interval){
+        this->interval = (interval < 1)? 1 : interval;
+    }
+
+    const result& getLatest() const{
+        return this->latest;
+    }
+
+    long long getLatestStep() const{
+        return this->latestStep;
+    }
+
+    void drawSettings(){
+        ImGui::Checkbox("Statistics", &this->enabled);
+        ImGui::SameLine();
+        ImGui::Checkbox("Trail", &this->trailStatistics);
+        ImGui::SameLine();
+        ImGui::Checkbox("Agents", &this->agentStatistics);
+        ImGui::SliderInt("Statistics interval", &this->interval, 1, 600);
+        ImGui::SliderFloat("Coverage threshold", &this->coverageThreshold, 0, 1);
+        ImGui::SliderFloat("Histogram max", &this->histogramMax, 0.01, 4);
+        if(ImGui::Checkbox("Write statistics csv", &this->writeCSV) && !this->writeCSV){
+            this->closeCSV();
+        }
+        ImGui::SameLine();
+        ImGui::InputText("##csvPath", this->csvPath, sizeof(this->csvPath));
+    }
+
+    void drawInfo(){
+        if(this->latestStep < 0){
+            ImGui::Text("Statistics: waiting for first result");
+            return;
+        }
+        const result& r = this->latest;
+        float agents = (r.agentCount > 0)? r.agentCount : 1;
+        float texels = (r.texelCount > 0)? r.texelCount : 1;
+        ImGui::Text("Statistics (step %lld, %lld steps behind, %d skipped):", this->latestStep, this->requestedStep - this->latestStep, this->skippedRequests);
+        if(this->trailStatistics){
+            ImGui::Text("  Total deposit: %f, coverage: %.2f%%", r.totalDeposit, 100.0f * r.coveredTexels / texels);
+            float bins[ST_HISTOGRAMBINS];
+            for(int i = 0; i < ST_HISTOGRAMBINS; i++){
+                bins[i] = r.histogram[i] / texels;
+            }
+            ImGui::PlotHistogram("Deposit histogram", bins, ST_HISTOGRAMBINS, 0, nullptr, 0, FLT_MAX, ImVec2(0, 40));
+        }
+        if(this->agentStatistics){
+            ImGui::Text("  Mean heading: (%f, %f), coherence: %f", r.headingX / agents, r.headingY / agents, std::sqrt(r.headingX*r.headingX + r.headingY*r.headingY) / agents);
+            ImGui::Text("  Mean deposit under agents: %f, agents on trail: %.2f%%", r.depositUnderAgents / agents, 100.0f * r.agentsOnTrail / agents);
+        }
+    }
+};
+
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+
+#include "OpenGLComponents/textureArray.hpp"
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/SSBO.hpp"
+#include "encoding/frameWriter.hpp"
+
+// ! Important, these must be the same as the compute shader group sizes
+#define DF_GROUPSIZE 32
+#define AG_GROUPSIZE 1024
+
+namespace simulation{
+
+/*
+    Steps many small, independent simulations at once for parameter studies
+    Every instance gets a layer of one texture array and a segment of one agent buffer (agent.w = layer),
+    so a whole step of every instance is a single agent dispatch and a single diffuse dispatch
+*/
+class sweep{
+public:
+    // Matches instanceParameters in sweepAgent.compute.glsl/sweepDiffuseFade.compute.glsl (std430)
+    struct instanceParameters{
+        float sensorDistance = 60;
+        float sensorAngle = 1.5;
+        float turnSpeed = 2;
+        float speed = 1;
+        float diffuse = 0.7;
+        float fade = 0.1;
+        float padding[2] = {0, 0};
+    };
+
+private:
+    struct computeShaderStruct{
+        float xPos = 0;
+        float yPos = 0;
+        float angle = 0;
+        float layer = 0;
+    };
+
+    int agentsPerInstance;
+    int res;
+    unsigned int seed;
+    int stepCount = 0;
+    float coverageThreshold = 0.05;
+
+    std::vector<instanceParameters> instances;
+    std::vector<computeShaderStruct> agentData;
+    std::vector<float> partials; // Two floats (deposit, coverage) per work group per instance
+    std::vector<float> pixels; // Reused for exporting one layer at a time
+    encoding::frameWriter frameWriter;
+    std::ofstream metricsFile;
+
+    openGLComponents::textureArray textures;
+    openGLComponents::computeShader agentComputeShader;
+    openGLComponents::computeShader diffuseFadeShader;
+    openGLComponents::computeShader metricsShader;
+    openGLComponents::SSBO agentSSBO;
+    openGLComponents::SSBO parameterSSBO;
+    openGLComponents::SSBO metricSSBO;
+
+    int groupsPerLayer() const{
+        int groups = (this->res + DF_GROUPSIZE - 1) / DF_GROUPSIZE;
+        return groups * groups;
+    }
+
+    void generateAgents(){
+        this->agentData.clear();
+        this->agentData.reserve((size_t)this->agentsPerInstance * this->instances.size());
+        std::mt19937 gen(this->seed == 0 ? std::random_device()() : this->seed);
+        std::uniform_real_distribution<> dis(0, 1);
+        for(size_t layer = 0; layer < this->instances.size(); layer++){
+            for(int i = 0; i < this->agentsPerInstance; i++){
+                computeShaderStruct temp;
+                temp.xPos = dis(gen) * this->res;
+                temp.yPos = dis(gen) * this->res;
+                temp.angle = dis(gen) * 2 * 3.14159265359;
+                temp.layer = layer;
+                this->agentData.push_back(temp);
+            }
+        }
+    }
+
+public:
+    sweep(std::vector<instanceParameters> instances, int agentsPerInstance=20000, int res=512, unsigned int seed=0){
+        if(instances.empty()){
+            throw std::runtime_error("Parameter sweep needs at least one instance");
+        }
+        this->instances = instances;
+        this->agentsPerInstance = agentsPerInstance;
+        this->res = res;
+        this->seed = seed;
+    }
+
+    /*
+        Reads instances from a csv file with a header line naming the columns, e.g.
+            sensorDistance,sensorAngle,speed
+            30,1.0,1
+            60,1.5,2
+        Columns which arent given keep the same defaults as simulation::main
+    */
+    static std::vector<instanceParameters> loadCSV(const std::string& path){
+        std::ifstream file(path);
+        if(!file){
+            throw std::runtime_error("Could not open parameter file " + path);
+        }
+        std::string line;
+        std::vector<std::string> columns;
+        std::getline(file, line);
+        std::stringstream header(line);
+        for(std::string name; std::getline(header, name, ',');){
+            name.erase(0, name.find_first_not_of(" \t\r"));
+            name.erase(name.find_last_not_of(" \t\r") + 1);
+            columns.push_back(name);
+        }
+        std::vector<instanceParameters> instances;
+        while(std::getline(file, line)){
+            if(line.find_first_not_of(" \t\r") == std::string::npos){
+                continue;
+            }
+            instanceParameters p;
+            std::stringstream row(line);
+            std::string value;
+            for(size_t i = 0; i < columns.size() && std::getline(row, value, ','); i++){
+                float v = std::stof(value);
+                if(columns[i] == "sensorDistance"){ p.sensorDistance = v; }
+                else if(columns[i] == "sensorAngle"){ p.sensorAngle = v; }
+                else if(columns[i] == "turnSpeed"){ p.turnSpeed = v; }
+                else if(columns[i] == "speed"){ p.speed = v; }
+                else if(columns[i] == "diffuse"){ p.diffuse = v; }
+                else if(columns[i] == "fade"){ p.fade = v; }
+                else{ throw std::runtime_error("Unknown parameter column " + columns[i]); }
+            }
+            instances.push_back(p);
+        }
+        return instances;
+    }
+
+    /*
+        Creates all the opengl objects, assumes a context is current
+    */
+    void setup(){
+        GLint maxLayers = 0;
+        GLCall(glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers));
+        if((int)this->instances.size() > maxLayers){
+            throw std::runtime_error("Too many sweep instances for one texture array (max " + std::to_string(maxLayers) + ")");
+        }
+        this->textures.init(this->res, this->instances.size());
+        this->textures.clear();
+        this->textures.bind();
+
+        this->agentComputeShader.createShaderFromDisk("GLSL/sweepAgent.compute.glsl");
+        this->agentComputeShader.setUniform1i("size", this->res);
+        this->agentComputeShader.setUniform3f("mainAgentColour", 0.0f, 0.1f, 0.9f);
+        this->agentComputeShader.setUniform3f("agentXDirectionColour", 0.0f, 0.7f, 0.2f);
+        this->agentComputeShader.setUniform3f("agentYDirectionColour", 0.0f, 0.1f, 0.8f);
+        this->diffuseFadeShader.createShaderFromDisk("GLSL/sweepDiffuseFade.compute.glsl");
+        this->metricsShader.createShaderFromDisk("GLSL/sweepMetrics.compute.glsl");
+        this->metricsShader.setUniform1f("coverageThreshold", this->coverageThreshold);
+
+        this->generateAgents();
+        this->agentSSBO.generate(this->agentData);
+        this->agentSSBO.bind(this->agentComputeShader.getID(), "agentData", 2);
+        this->parameterSSBO.generate(this->instances);
+        this->parameterSSBO.bind(this->agentComputeShader.getID(), "parameterData", 4);
+        this->partials.assign((size_t)this->groupsPerLayer() * this->instances.size() * 2, 0.0f);
+        this->metricSSBO.generate(this->partials);
+        this->metricSSBO.bind(this->metricsShader.getID(), "metricData", 5);
+
+        GLObjectLabel(GL_TEXTURE, this->textures.getID(), "Sweep texture array");
+        GLObjectLabel(GL_BUFFER, this->agentSSBO.getID(), "Sweep agent SSBO");
+        GLObjectLabel(GL_BUFFER, this->parameterSSBO.getID(), "Sweep parameter SSBO");
+    }
+
+    /*
+        One step of every instance
+    */
+    void step(){
+        GLDebugGroup("Sweep step");
+        this->textures.bind();
+        this->diffuseFadeShader.execute((this->res+DF_GROUPSIZE-1)/DF_GROUPSIZE, (this->res+DF_GROUPSIZE-1)/DF_GROUPSIZE, this->instances.size());
+        this->agentComputeShader.execute((this->agentData.size()+AG_GROUPSIZE-1)/AG_GROUPSIZE, 1, 1);
+        this->stepCount++;
+    }
+
+    /*
+        Writes every layer to sweep_<instance>_<frame>.png (or .qoi when built without opencv)
+    */
+    void writeFrames(int frameIndex){
+        GLDebugGroup("Sweep export frames");
+        this->pixels.resize((size_t)this->res * this->res * 4);
+        for(size_t layer = 0; layer < this->instances.size(); layer++){
+            this->textures.getLayerImage(layer, this->pixels.data());
+            this->frameWriter.writeFloat("sweep_" + std::to_string(layer) + "_" + std::to_string(frameIndex) + "." + this->frameWriter.extension(), this->pixels.data(), this->res, this->res);
+        }
+    }
+
+    /*
+        Appends total deposit and coverage (fraction of texels with deposit above the threshold) of every instance to a csv file
+    */
+    void writeMetrics(const std::string& path="sweep_metrics.csv"){
+        GLDebugGroup("Sweep metrics");
+        if(!this->metricsFile.is_open()){
+            this->metricsFile.open(path);
+            this->metricsFile << "step,instance,sensorDistance,sensorAngle,turnSpeed,speed,diffuse,fade,totalDeposit,coverage\n";
+        }
+        this->metricsShader.execute((this->res+DF_GROUPSIZE-1)/DF_GROUPSIZE, (this->res+DF_GROUPSIZE-1)/DF_GROUPSIZE, this->instances.size());
+        GLCall(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+        GLCall(glGetNamedBufferSubData(this->metricSSBO.getID(), 0, sizeof(float) * this->partials.size(), this->partials.data()));
+        int groups = this->groupsPerLayer();
+        for(size_t layer = 0; layer < this->instances.size(); layer++){
+            double deposit = 0;
+            double covered = 0;
+            for(int g = 0; g < groups; g++){
+                deposit += this->partials[(layer*groups + g)*2 + 0];
+                covered += this->partials[(layer*groups + g)*2 + 1];
+            }
+            const instanceParameters& p = this->instances[layer];
+            this->metricsFile << this->stepCount << "," << layer << "," << p.sensorDistance << "," << p.sensorAngle << "," << p.turnSpeed << ","
+                              << p.speed << "," << p.diffuse << "," << p.fade << "," << deposit << "," << covered / ((double)this->res * this->res) << "\n";
+        }
+        this->metricsFile.flush();
+    }
+
+    int getStepCount() const{
+        return this->stepCount;
+    }
+
+    size_t getInstanceCount() const{
+        return this->instances.size();
+    }
+};
+
+}
@@ -0,0 +1,538 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <imgui.h>
+
+#include "OpenGLComponents/VAO.hpp"
+#include "OpenGLComponents/VBO.hpp"
+#include "OpenGLComponents/shader.hpp"
+#include "OpenGLComponents/simulationTexture.hpp"
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/SSBO.hpp"
+#include "OpenGLComponents/asyncReadback.hpp"
+#include "OpenGLComponents/memoryTracker.hpp"
+#include "encoding/frameWriter.hpp"
+
+// ! Important, these must be the same as in the volume*.compute.glsl shaders
+#define VL_BRICK 8
+#define VL_BRICKVOXELS 512
+#define VL_AGENTGROUPSIZE 256
+#define VL_BRICKGROUPSIZE 256
+#define VL_SLICEGROUPSIZE 16
+
+namespace simulation{
+
+/*
+    3D version of the simulation, agents move through a cube of voxels instead of over a texture
+    The trail volume is stored as 8x8x8 bricks which are only allocated where there is trail (or an agent about to
+    leave some), so memory and diffuse work follow the occupied part of the volume rather than its whole size.
+    The brick pool starts small and is doubled whenever the GPU reports that it ran out of free bricks
+
+    The GPU does all of the brick bookkeeping itself each step, see volumeBricks.compute.glsl, and the host only
+    looks at a small readback of the counters a few frames later
+*/
+class volume{
+public:
+    enum viewMode{ VIEW_SLICE = 0, VIEW_MAXIMUM = 1 };
+
+    // Matches brickState in volumeBricks.compute.glsl (std430)
+    struct brickState{
+        uint32_t dispatchX = 0;
+        uint32_t dispatchY = 1;
+        uint32_t dispatchZ = 1;
+        int32_t freeCount = 0;
+        uint32_t overflow = 0;
+        uint32_t padding[3] = {0, 0, 0};
+    };
+
+private:
+    struct agent{
+        float position[4];
+        float direction[4];
+    };
+
+    /*
+        Settings
+    */
+    int agentCount; // What the UI sets, only used by restart(), like widthHeightResolution in simulation.hpp
+    int size;
+    int agentCount_current; // What the buffers were made for
+    int size_current; // Voxels along each axis, always a multiple of VL_BRICK
+    int seed; // -1 = random
+    float sensorDistance = 9;
+    float sensorAngle = 0.6;
+    float turnSpeed = 0.5;
+    float speed = 1;
+    float diffuse = 0.4;
+    float fade = 0.03;
+    float releaseThreshold = 0.002; // Bricks that nothing is in and that have faded below this are freed
+    float spreadThreshold = 0.01; // Trail above this on the face of a brick allocates the brick next to it
+    bool settingsChanged = true;
+
+
+    /*
+        Preview/export view
+    */
+    int viewAxis = 2;
+    int viewSlice = 0;
+    int viewMode = VIEW_MAXIMUM;
+    float viewBrightness = 1;
+    float viewColour[3] = {0.3f, 0.9f, 0.6f};
+    bool viewDirty = true;
+    std::vector<float> pixels; // Reused for exporting
+    encoding::frameWriter frameWriter;
+
+
+    /*
+        Bricks
+    */
+    int bricksPerAxis = 0;
+    uint32_t brickCount = 0;
+    uint32_t capacity = 0; // Slots in the brick pool
+    int currentPool = 0; // Which of poolSSBO holds the latest trail
+    brickState latestState;
+    long long stepCount = 0;
+    int growCount = 0;
+    long long grownAtStep = 0; // Brick counters read back from before this step are against the old pool size
+
+
+    /*
+        OpenGL components
+    */
+    openGLComponents::computeShader agentShader;
+    openGLComponents::computeShader diffuseShader;
+    openGLComponents::computeShader brickShader;
+    openGLComponents::computeShader sliceShader;
+    openGLComponents::SSBO agentSSBO;
+    openGLComponents::SSBO tableSSBO;
+    openGLComponents::SSBO poolSSBO[2];
+    openGLComponents::SSBO stateSSBO;
+    openGLComponents::SSBO freeSSBO;
+    openGLComponents::SSBO activeSSBO;
+    openGLComponents::SSBO infoSSBO;
+    openGLComponents::asyncReadback stateReadback;
+    openGLComponents::simulationTexture viewTexture;
+    bool viewTextureCreated = false;
+    openGLComponents::VAO vao;
+    openGLComponents::VBO vbo;
+    openGLComponents::VBOLayout layout;
+    openGLComponents::shader quadShader;
+    std::vector<float> quadVertices = {
+        -1.0f, -1.0f, 0.0f,    0.0f, 0.0f,
+         1.0f, -1.0f, 0.0f,    1.0f, 0.0f,
+         1.0f,  1.0f, 0.0f,    1.0f, 1.0f,
+         1.0f,  1.0f, 0.0f,    1.0f, 1.0f,
+        -1.0f,  1.0f, 0.0f,    0.0f, 1.0f,
+        -1.0f, -1.0f, 0.0f,    0.0f, 0.0f
+    };
+
+    // Agents start in a ball in the middle of the volume heading in random directions, so the trail starts out sparse
+    std::vector<agent> generateAgents(){
+        std::vector<agent> agents(this->agentCount_current);
+        std::random_device rd;
+        std::mt19937 gen((this->seed >= 0)? (unsigned int)this->seed : rd());
+        std::normal_distribution<float> normal(0, 1);
+        std::uniform_real_distribution<float> uniform(0, 1);
+        float radius = this->size_current / 4.0f;
+        for(agent& a : agents){
+            float d[3] = {normal(gen), normal(gen), normal(gen)};
+            float length = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]) + 1e-6f;
+            float r = radius * std::cbrt(uniform(gen));
+            float p[3] = {normal(gen), normal(gen), normal(gen)};
+            float pLength = std::sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]) + 1e-6f;
+            for(int i = 0; i < 3; i++){
+                a.position[i] = this->size_current / 2.0f + p[i] / pLength * r;
+                a.direction[i] = d[i] / length;
+            }
+            a.position[3] = 0;
+            a.direction[3] = 0;
+        }
+        return agents;
+    }
+
+    // Binding points are fixed in the shaders, the two pools swap between 2 (current) and 3 (next) every step
+    void bindBuffers(){
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->agentSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->tableSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->poolSSBO[this->currentPool].getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, this->poolSSBO[1 - this->currentPool].getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, this->stateSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, this->freeSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, this->activeSSBO.getID()));
+        GLCall(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, this->infoSSBO.getID()));
+    }
+
+    void createBuffers(){
+        this->bricksPerAxis = this->size_current / VL_BRICK;
+        this->brickCount = (uint32_t)this->bricksPerAxis * this->bricksPerAxis * this->bricksPerAxis;
+        this->capacity = std::min<uint32_t>(this->brickCount, std::max<uint32_t>(64, this->brickCount / 16));
+        this->currentPool = 0;
+        this->stepCount = 0;
+        this->growCount = 0;
+        this->grownAtStep = 0;
+
+        std::vector<agent> agents = this->generateAgents();
+        this->agentSSBO.generate(agents);
+        std::vector<uint32_t> table(this->brickCount, 0);
+        this->tableSSBO.generate(table);
+        std::vector<uint32_t> info(this->brickCount * 2, 0);
+        this->infoSSBO.generate(info);
+        std::vector<float> pool((size_t)this->capacity * VL_BRICKVOXELS, 0.0f);
+        this->poolSSBO[0].generate(pool);
+        this->poolSSBO[1].generate(pool);
+        std::vector<uint32_t> freeList(this->capacity);
+        for(uint32_t i = 0; i < this->capacity; i++){
+            freeList[i] = i;
+        }
+        this->freeSSBO.generate(freeList);
+        std::vector<uint32_t> active(this->capacity, 0);
+        this->activeSSBO.generate(active);
+        std::vector<brickState> state(1);
+        state[0].freeCount = this->capacity;
+        this->latestState = state[0];
+        this->stateSSBO.generate(state);
+        this->stateReadback.init(sizeof(brickState), 3);
+
+        GLObjectLabel(GL_BUFFER, this->agentSSBO.getID(), "Volume agents SSBO");
+        GLObjectLabel(GL_BUFFER, this->tableSSBO.getID(), "Volume brick table SSBO");
+        GLObjectLabel(GL_BUFFER, this->poolSSBO[0].getID(), "Volume brick pool A SSBO");
+        GLObjectLabel(GL_BUFFER, this->poolSSBO[1].getID(), "Volume brick pool B SSBO");
+        this->bindBuffers();
+    }
+
+    /*
+        Doubles the brick pool, the only place the host waits on the GPU
+        Both pools are copied into bigger buffers and the new slots are added to the free list
+    */
+    void grow(){
+        uint32_t newCapacity = std::min<uint32_t>(this->brickCount, this->capacity * 2);
+        if(newCapacity == this->capacity){
+            return;
+        }
+        GLDebugGroup("Grow brick pool");
+        GLCall(glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT));
+        brickState state;
+        GLCall(glGetNamedBufferSubData(this->stateSSBO.getID(), 0, sizeof(state), &state));
+
+        for(int p = 0; p < 2; p++){
+            std::vector<float> pool((size_t)newCapacity * VL_BRICKVOXELS, 0.0f);
+            GLCall(glGetNamedBufferSubData(this->poolSSBO[p].getID(), 0, (size_t)this->capacity * VL_BRICKVOXELS * sizeof(float), pool.data()));
+            this->poolSSBO[p].generate(pool);
+        }
+        std::vector<uint32_t> freeList(newCapacity);
+        int freeCount = std::max(0, state.freeCount);
+        if(freeCount > 0){
+            GLCall(glGetNamedBufferSubData(this->freeSSBO.getID(), 0, freeCount * sizeof(uint32_t), freeList.data()));
+        }
+        for(uint32_t slot = this->capacity; slot < newCapacity; slot++){
+            freeList[freeCount++] = slot;
+        }
+        this->freeSSBO.generate(freeList);
+        std::vector<uint32_t> active(newCapacity, 0);
+        GLCall(glGetNamedBufferSubData(this->activeSSBO.getID(), 0, this->capacity * sizeof(uint32_t), active.data())); // Still needed by the next diffuse
+        this->activeSSBO.generate(active);
+
+        state.freeCount = freeCount;
+        state.overflow = 0;
+        GLCall(glNamedBufferSubData(this->stateSSBO.getID(), 0, sizeof(state), &state));
+        this->capacity = newCapacity;
+        this->growCount++;
+        this->grownAtStep = this->stepCount;
+        this->bindBuffers();
+    }
+
+    void applySettings(){
+        if(!this->settingsChanged){
+            return;
+        }
+        this->agentShader.use();
+        this->agentShader.setUniform1i("size", this->size_current);
+        this->agentShader.setUniform1f("sensorDistance", this->sensorDistance);
+        this->agentShader.setUniform1f("sensorAngle", this->sensorAngle);
+        this->agentShader.setUniform1f("turnSpeed", this->turnSpeed);
+        this->agentShader.setUniform1f("speed", this->speed);
+        this->diffuseShader.use();
+        this->diffuseShader.setUniform1i("size", this->size_current);
+        this->diffuseShader.setUniform1f("diffuse", this->diffuse);
+        this->diffuseShader.setUniform1f("fade", this->fade);
+        this->diffuseShader.setUniform1f("spreadThreshold", this->spreadThreshold);
+        this->brickShader.use();
+        this->brickShader.setUniform1ui("brickCount", this->brickCount);
+        this->brickShader.setUniform1f("releaseThreshold", this->releaseThreshold);
+        this->settingsChanged = false;
+    }
+
+public:
+    volume(int agentCount=200000, int size=256, int seed=-1){
+        this->agentCount = this->agentCount_current = agentCount;
+        this->size = this->size_current = std::max(VL_BRICK, (size + VL_BRICK - 1) / VL_BRICK * VL_BRICK);
+        this->seed = seed;
+        this->viewSlice = this->size_current / 2;
+    }
+
+    ~volume(){
+        if(this->viewTextureCreated){
+            this->viewTexture.destroy();
+        }
+    }
+
+    /*
+        Creates the shaders and buffers, renderView()/render() also need a texture which is created on first use
+    */
+    void setup(){
+        this->agentShader.createShaderFromDisk("GLSL/volumeAgent.compute.glsl");
+        this->diffuseShader.createShaderFromDisk("GLSL/volumeDiffuse.compute.glsl");
+        this->brickShader.createShaderFromDisk("GLSL/volumeBricks.compute.glsl");
+        this->sliceShader.createShaderFromDisk("GLSL/volumeSlice.compute.glsl");
+        GLObjectLabel(GL_PROGRAM, this->agentShader.getID(), "Volume agent compute shader");
+        GLObjectLabel(GL_PROGRAM, this->diffuseShader.getID(), "Volume diffuse compute shader");
+        GLObjectLabel(GL_PROGRAM, this->brickShader.getID(), "Volume brick compute shader");
+        GLObjectLabel(GL_PROGRAM, this->sliceShader.getID(), "Volume slice compute shader");
+        this->vbo.generate(this->quadVertices, this->quadVertices.size() * sizeof(float));
+        this->layout.pushFloat(3);
+        this->layout.pushFloat(2);
+        this->vao.addBuffer(this->vbo, this->layout);
+        this->quadShader.createShaderFromDisk("GLSL/quadShader.vert.glsl", "GLSL/quadShader.frag.glsl");
+        this->quadShader.use();
+        this->quadShader.setUniform1f("offsetX", 0);
+        this->quadShader.setUniform1f("offsetY", 0);
+        this->quadShader.setUniform1f("zoomMultiplier", 1);
+        this->quadShader.setUniform1i("displayLevel", 0);
+        this->quadShader.setUniform1i("pyramidSampler", 1);
+        GLObjectLabel(GL_VERTEX_ARRAY, this->vao.getID(), "Volume quad VAO");
+        this->createBuffers();
+        this->settingsChanged = true;
+    }
+
+    void restart(int agentCount, int size, int seed){
+        this->agentCount = this->agentCount_current = agentCount;
+        this->size = this->size_current = std::max(VL_BRICK, (size + VL_BRICK - 1) / VL_BRICK * VL_BRICK);
+        this->seed = seed;
+        this->viewSlice = std::min(this->viewSlice, this->size_current - 1);
+        if(this->viewTextureCreated){
+            this->viewTexture.destroy();
+            this->viewTextureCreated = false;
+        }
+        this->createBuffers();
+        this->settingsChanged = true;
+        this->viewDirty = true;
+    }
+
+    /*
+        One step: agents, then diffusion over the allocated bricks, then freeing and allocating bricks for the next step
+    */
+    void step(){
+        GLDebugGroup("Volume step");
+        this->applySettings();
+        this->bindBuffers();
+        {
+            GLDebugGroup("Agents");
+            this->agentShader.use();
+            this->agentShader.setUniform1ui("frame", (unsigned int)this->stepCount);
+            this->agentShader.execute((this->agentCount_current + VL_AGENTGROUPSIZE - 1) / VL_AGENTGROUPSIZE, 1, 1);
+            GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        }
+        {
+            GLDebugGroup("Diffuse");
+            this->diffuseShader.use();
+            GLCall(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, this->stateSSBO.getID()));
+            GLCall(glMemoryBarrier(GL_COMMAND_BARRIER_BIT));
+            GLCall(glDispatchComputeIndirect(0)); // One work group per allocated brick
+            GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        }
+        this->currentPool = 1 - this->currentPool;
+        this->bindBuffers();
+        {
+            GLDebugGroup("Bricks");
+            GLCall(glClearNamedBufferSubData(this->stateSSBO.getID(), GL_R32UI, 0, sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr)); // Active count
+            unsigned int groups = (this->brickCount + VL_BRICKGROUPSIZE - 1) / VL_BRICKGROUPSIZE;
+            this->brickShader.use();
+            this->brickShader.setUniform1i("pass", 0);
+            this->brickShader.execute(groups, 1, 1);
+            GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+            this->brickShader.setUniform1i("pass", 1);
+            this->brickShader.execute(groups, 1, 1);
+            GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT));
+        }
+        if(!this->stateReadback.full()){
+            this->stateReadback.requestBuffer(this->stateSSBO.getID(), 0, sizeof(brickState), this->stepCount);
+        }
+        this->stepCount++;
+        this->viewDirty = true;
+        this->poll();
+    }
+
+    /*
+        Picks up the brick counters, and grows the pool if it ran out (or is about to)
+    */
+    void poll(){
+        bool needsRoom = false;
+        long long step;
+        while(const void* data = this->stateReadback.poll(&step)){
+            if(step < this->grownAtStep){ // Still says the old pool was full, acting on it would grow again for the same overflow
+                this->stateReadback.release();
+                continue;
+            }
+            this->latestState = *static_cast<const brickState*>(data);
+            this->stateReadback.release();
+            needsRoom |= this->latestState.overflow != 0 || this->latestState.freeCount < (int)this->capacity / 8;
+        }
+        if(needsRoom){
+            this->grow();
+        }
+    }
+
+    /*
+        Draws the current view (slice or maximum projection) into the view texture
+    */
+    void renderView(){
+        if(!this->viewTextureCreated){
+            this->viewTexture.init(this->size_current);
+            this->viewTextureCreated = true;
+            this->viewDirty = true;
+        }
+        if(!this->viewDirty){
+            return;
+        }
+        GLDebugGroup("Volume view");
+        this->bindBuffers();
+        this->viewTexture.bind();
+        this->sliceShader.use();
+        this->sliceShader.setUniform1i("size", this->size_current);
+        this->sliceShader.setUniform1i("axis", this->viewAxis);
+        this->sliceShader.setUniform1i("slice", this->viewSlice);
+        this->sliceShader.setUniform1i("mode", this->viewMode);
+        this->sliceShader.setUniform1f("brightness", this->viewBrightness);
+        this->sliceShader.setUniform3f("colour", this->viewColour[0], this->viewColour[1], this->viewColour[2]);
+        GLCall(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        unsigned int groups = (this->size_current + VL_SLICEGROUPSIZE - 1) / VL_SLICEGROUPSIZE;
+        this->sliceShader.execute(groups, groups, 1);
+        this->viewDirty = false;
+    }
+
+    /*
+        Writes the current view to an image file
+    */
+    void writeView(const std::string& path){
+        this->renderView();
+        GLDebugGroup("Export volume view");
+        this->pixels.resize((size_t)this->size_current * this->size_current * 4);
+        GLCall(glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT));
+        GLCall(glGetTextureImage(this->viewTexture.getID(), 0, GL_RGBA, GL_FLOAT, this->pixels.size() * sizeof(float), this->pixels.data()));
+        this->frameWriter.writeFloat(path, this->pixels.data(), this->size_current, this->size_current);
+    }
+
+    /*
+        Writes every slice along the axis as <prefix><slice>.<extension>
+    */
+    void writeSlices(const std::string& prefix){
+        int mode = this->viewMode, slice = this->viewSlice;
+        this->viewMode = VIEW_SLICE;
+        for(int s = 0; s < this->size_current; s++){
+            this->viewSlice = s;
+            this->viewDirty = true;
+            this->writeView(prefix + std::to_string(s) + "." + this->frameWriter.extension());
+        }
+        this->viewMode = mode;
+        this->viewSlice = slice;
+        this->viewDirty = true;
+    }
+
+    void setView(int axis, int mode, int slice){
+        this->viewAxis = std::min(std::max(axis, 0), 2);
+        this->viewMode = mode;
+        this->viewSlice = std::min(std::max(slice, 0), this->size_current - 1);
+        this->viewDirty = true;
+    }
+
+    /*
+        Draws the view texture over the window, aspectRatio is width/height of the window
+    */
+    void render(float aspectRatio){
+        this->renderView();
+        GLDebugGroup("Render volume view");
+        this->viewTexture.bind();
+        this->quadShader.use();
+        this->quadShader.setUniform1f("textureRatio", aspectRatio);
+        this->vao.bind();
+        glDrawArrays(GL_TRIANGLES, 0, this->quadVertices.size() / 5);
+    }
+
+    int getSize() const{
+        return this->size_current;
+    }
+
+    long long getStepCount() const{
+        return this->stepCount;
+    }
+
+    uint32_t getAllocatedBricks() const{
+        return this->capacity - std::max(0, this->latestState.freeCount);
+    }
+
+    uint32_t getCapacity() const{
+        return this->capacity;
+    }
+
+    const char* extension() const{
+        return this->frameWriter.extension();
+    }
+
+    void update(){
+        ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(520, 560), ImGuiCond_Always);
+        ImGui::Begin("Volume");
+        this->settingsChanged |= ImGui::SliderFloat("Sensor Distance", &this->sensorDistance, 0, 64);
+        this->settingsChanged |= ImGui::SliderFloat("Sensor Angle", &this->sensorAngle, 0, 1.57);
+        this->settingsChanged |= ImGui::SliderFloat("Turn Speed", &this->turnSpeed, 0, 2);
+        this->settingsChanged |= ImGui::SliderFloat("Speed", &this->speed, 0.01, 4);
+        this->settingsChanged |= ImGui::SliderFloat("Diffuse", &this->diffuse, 0, 1);
+        this->settingsChanged |= ImGui::SliderFloat("Fade", &this->fade, 0, 0.2);
+        this->settingsChanged |= ImGui::SliderFloat("Brick release threshold", &this->releaseThreshold, 0, 0.05, "%.4f");
+        this->settingsChanged |= ImGui::SliderFloat("Brick spread threshold", &this->spreadThreshold, 0, 0.1, "%.4f");
+        ImGui::Dummy(ImVec2(0, 10));
+        this->viewDirty |= ImGui::Combo("View", &this->viewMode, "Slice\0Maximum along axis\0");
+        this->viewDirty |= ImGui::Combo("Axis", &this->viewAxis, "X\0Y\0Z\0");
+        if(this->viewMode == VIEW_SLICE){
+            this->viewDirty |= ImGui::SliderInt("Slice", &this->viewSlice, 0, this->size_current - 1);
+        }
+        this->viewDirty |= ImGui::SliderFloat("Brightness", &this->viewBrightness, 0.1, 20);
+        this->viewDirty |= ImGui::ColorEdit3("Colour", this->viewColour);
+        if(ImGui::Button("Export view")){
+            this->writeView("volume_" + std::to_string(this->stepCount) + "." + this->frameWriter.extension());
+        }
+        ImGui::SameLine();
+        if(ImGui::Button("Export all slices")){
+            this->writeSlices("volume_" + std::to_string(this->stepCount) + "_" + "xyz"[this->viewAxis] + "_");
+        }
+        ImGui::Dummy(ImVec2(0, 10));
+        ImGui::Text("Restart required for the following settings:");
+        ImGui::SliderInt("Agent Count", &this->agentCount, 0, 5000000);
+        ImGui::SliderInt("Volume Size", &this->size, VL_BRICK, 1024);
+        ImGui::InputInt("Seed (-1 = random)", &this->seed);
+        if(ImGui::Button("Restart")){
+            this->restart(this->agentCount, this->size, this->seed);
+        }
+        ImGui::End();
+
+        ImGui::SetNextWindowPos(ImVec2(0, 560), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(520, 160), ImGuiCond_Always);
+        ImGui::Begin("Info");
+        ImGui::Text("FPS: %f", ImGui::GetIO().Framerate);
+        ImGui::Text("Steps: %lld", this->stepCount);
+        uint32_t allocated = this->getAllocatedBricks();
+        ImGui::Text("Bricks: %u allocated of %u in the pool, %u in the volume (%.1f%%)", allocated, this->capacity, this->brickCount, 100.0f * allocated / this->brickCount);
+        ImGui::Text("Trail memory: %.1f MB (a dense volume would be %.1f MB), pool grown %d times",
+                    openGLComponents::memory::toMB(2LL * VL_BRICKVOXELS * sizeof(float) * this->capacity),
+                    openGLComponents::memory::toMB(2LL * sizeof(float) * this->size_current * this->size_current * this->size_current), this->growCount);
+        ImGui::Text("GPU buffers: %.1f MB", openGLComponents::memory::toMB(openGLComponents::memory::get(openGLComponents::memory::BUFFER)));
+        ImGui::End();
+    }
+};
+
+}
@@ -0,0 +1,300 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <algorithm>
+
+#include <imgui.h>
+#if GLSLSLIME_HAVE_OPENCV
+    #include <opencv2/opencv.hpp>
+#endif
+
+#include "OpenGLComponents/computeShader.hpp"
+#include "OpenGLComponents/debugging.hpp"
+#include "OpenGLComponents/memoryTracker.hpp"
+
+// ! Important, these must be the same as the sampler bindings in agent.compute.glsl and diffuseFade.compute.glsl
+#define WM_OBSTACLEUNIT 2
+#define WM_FOODUNIT 3
+
+namespace simulation{
+
+/*
+    Static obstacle and food maps loaded from images and resampled to the simulation resolution
+    On the GPU obstacles are a 1 bit mask (32 texels packed along x into every R32UI texel) and food is a single R8 channel,
+    so both maps together are 1.125 bytes per texel compared to the 16 bytes per texel of the simulation texture
+
+    Binary PGM/PPM files are streamed a row at a time, so maps far bigger than the simulation never get fully decoded in memory
+    Anything else goes through cv::imread, which does decode the whole image first (and isnt available without opencv)
+*/
+class worldMaps{
+private:
+    /*
+        Settings
+    */
+    bool enabled = true;
+    float foodAttraction = 1.0; // Added to what the sensors see, per unit of food
+    float foodDeposit = 0.05; // Added to the trail every step, per unit of food
+    float obstacleAvoidance = 1.0; // What a sensor sees when it is over an obstacle (negated)
+    int obstacleThreshold = 128; // Pixels darker than this are obstacles
+    char obstaclePath[256] = "";
+    char foodPath[256] = "";
+    std::string loadError;
+
+
+    /*
+        GPU data
+    */
+    unsigned int obstacleTexture = 0;
+    unsigned int foodTexture = 0;
+    int res = 0;
+    bool haveObstacles = false;
+    bool haveFood = false;
+    long long bytes = 0;
+
+    // Whatever is currently set in the shaders, so uniforms are only touched when something changes
+    int useMaps_inShader = -1;
+    float foodAttraction_inShader = -1;
+    float foodDeposit_inShader = -1;
+    float obstacleAvoidance_inShader = -1;
+
+
+    /*
+        Calls rowCallback(y, row) for every row of the image resampled (nearest neighbour) to res*res, row holds res luminance values
+    */
+    static void forEachRow(const std::string& path, int res, const std::function<void(int, const uint8_t*)>& rowCallback){
+        std::vector<uint8_t> row(res);
+        std::ifstream file(path, std::ios::binary);
+        if(!file.is_open()){
+            throw std::runtime_error("Could not open map " + path);
+        }
+        char magic[2] = {};
+        file.read(magic, 2);
+        if(magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6')){
+            int channels = (magic[1] == '6')? 3 : 1;
+            long long header[3]; // Width, height, maxval
+            for(int i = 0; i < 3; i++){
+                file >> std::ws;
+                while(file.peek() == '#'){ // Skip comments
+                    file.ignore(1 << 20, '\n');
+                    file >> std::ws;
+                }
+                file >> header[i];
+            }
+            file.get(); // Single whitespace character before the pixel data
+            if(!file || header[0] <= 0 || header[1] <= 0 || header[2] <= 0 || header[2] > 65535){
+                throw std::runtime_error("Invalid PGM/PPM header in " + path);
+            }
+            long long width = header[0], height = header[1];
+            int sampleBytes = (header[2] > 255)? 2 : 1;
+            long long rowBytes = width * channels * sampleBytes;
+            std::streamoff dataStart = file.tellg();
+            std::vector<uint8_t> sourceRow(rowBytes);
+            long long loadedRow = -1;
+            for(int y = 0; y < res; y++){
+                long long sy = (long long)y * height / res;
+                if(sy != loadedRow){ // Rows which get skipped by the resampling are never read
+                    file.seekg(dataStart + sy * rowBytes);
+                    file.read(reinterpret_cast<char*>(sourceRow.data()), rowBytes);
+                    if(!file){
+                        throw std::runtime_error("Unexpected end of file in " + path);
+                    }
+                    loadedRow = sy;
+                }
+                for(int x = 0; x < res; x++){
+                    const uint8_t* p = &sourceRow[((long long)x * width / res) * channels * sampleBytes]; // Most significant byte comes first for 16 bit samples
+                    row[x] = (channels == 1)? p[0] : (p[0]*77 + p[sampleBytes]*150 + p[2*sampleBytes]*29) >> 8;
+                }
+                rowCallback(y, row.data());
+            }
+            return;
+        }
+        file.close();
+
+    #if GLSLSLIME_HAVE_OPENCV
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if(image.empty()){
+            throw std::runtime_error("Could not decode map " + path);
+        }
+        for(int y = 0; y < res; y++){
+            const uint8_t* sourceRow = image.ptr<uint8_t>((long long)y * image.rows / res);
+            for(int x = 0; x < res; x++){
+                row[x] = sourceRow[(long long)x * image.cols / res];
+            }
+            rowCallback(y, row.data());
+        }
+    #else
+        throw std::runtime_error("Built without opencv, so maps have to be binary PGM/PPM files: " + path);
+    #endif
+    }
+
+    void destroy(){
+        if(this->obstacleTexture != 0){
+            GLCall(glDeleteTextures(1, &this->obstacleTexture));
+            this->obstacleTexture = 0;
+        }
+        if(this->foodTexture != 0){
+            GLCall(glDeleteTextures(1, &this->foodTexture));
+            this->foodTexture = 0;
+        }
+        openGLComponents::memory::release(openGLComponents::memory::TEXTURE, this->bytes);
+        this->bytes = 0;
+        this->haveObstacles = false;
+        this->haveFood = false;
+    }
+
+    /*
+        The shaders still need something bound to the samplers when a map is missing, so an empty 1x1 texture is used
+    */
+    unsigned int createTexture(GLenum format, int width, int height, GLenum dataFormat, GLenum type, const void* data){
+        unsigned int ID;
+        GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &ID));
+        GLCall(glTextureStorage2D(ID, 1, format, width, height));
+        GLCall(glTextureParameteri(ID, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        GLCall(glTextureParameteri(ID, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        GLCall(glTextureSubImage2D(ID, 0, 0, 0, width, height, dataFormat, type, data));
+        GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        return ID;
+    }
+
+public:
+    ~worldMaps(){
+        this->destroy();
+    }
+
+    /*
+        Loads the maps at the given paths (either can be empty) resampled to res*res
+        Throws std::runtime_error if a map cant be read, in which case no maps are loaded
+    */
+    void load(const std::string& obstacles, const std::string& food, int res){
+        this->destroy();
+        this->res = res;
+        if(res <= 0 || (obstacles.empty() && food.empty())){
+            return;
+        }
+        GLDebugGroup("Load world maps");
+
+        int maskWidth = (res + 31) / 32;
+        std::vector<uint32_t> mask(obstacles.empty()? 1 : (size_t)maskWidth * res, 0);
+        if(!obstacles.empty()){
+            forEachRow(obstacles, res, [&](int y, const uint8_t* row){
+                uint32_t* maskRow = &mask[(size_t)y * maskWidth];
+                for(int x = 0; x < res; x++){
+                    if(row[x] < this->obstacleThreshold){
+                        maskRow[x >> 5] |= 1u << (x & 31);
+                    }
+                }
+            });
+        }
+        std::vector<uint8_t> foodLevels(food.empty()? 1 : (size_t)res * res, 0);
+        if(!food.empty()){
+            forEachRow(food, res, [&](int y, const uint8_t* row){
+                std::copy(row, row + res, &foodLevels[(size_t)y * res]);
+            });
+        }
+
+        this->obstacleTexture = obstacles.empty()? this->createTexture(GL_R32UI, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, mask.data())
+                                                 : this->createTexture(GL_R32UI, maskWidth, res, GL_RED_INTEGER, GL_UNSIGNED_INT, mask.data());
+        this->foodTexture = food.empty()? this->createTexture(GL_R8, 1, 1, GL_RED, GL_UNSIGNED_BYTE, foodLevels.data())
+                                        : this->createTexture(GL_R8, res, res, GL_RED, GL_UNSIGNED_BYTE, foodLevels.data());
+        this->bytes = (long long)mask.size() * 4 + foodLevels.size();
+        openGLComponents::memory::allocate(openGLComponents::memory::TEXTURE, this->bytes);
+        this->haveObstacles = !obstacles.empty();
+        this->haveFood = !food.empty();
+        GLObjectLabel(GL_TEXTURE, this->obstacleTexture, "Obstacle mask");
+        GLObjectLabel(GL_TEXTURE, this->foodTexture, "Food map");
+    }
+
+    /*
+        Loads whatever paths are set in the UI again at a new resolution, used after a restart
+        Errors are kept for the UI instead of being thrown
+    */
+    void reload(int res){
+        if(this->obstaclePath[0] == '\0' && this->foodPath[0] == '\0'){
+            this->destroy();
+            return;
+        }
+        try{
+            this->load(this->obstaclePath, this->foodPath, res);
+            this->loadError.clear();
+        }catch(const std::runtime_error& e){
+            this->destroy();
+            this->loadError = e.what();
+        }
+    }
+
+    /*
+        How much GPU memory the currently set maps would take at a different resolution
+    */
+    long long bytesFor(int res) const{
+        long long total = 0;
+        total += (this->obstaclePath[0] != '\0')? 4LL * ((res + 31) / 32) * res : 4;
+        total += (this->foodPath[0] != '\0')? (long long)res * res : 1;
+        return (this->obstaclePath[0] == '\0' && this->foodPath[0] == '\0')? 0 : total;
+    }
+
+    bool loaded() const{
+        return this->haveObstacles || this->haveFood;
+    }
+
+    /*
+        Binds the maps and updates the map uniforms of the agent and diffuse shaders, called before every step
+        The maps cost nothing when none are loaded (or they are turned off) since the shaders skip the lookups entirely
+    */
+    void apply(openGLComponents::computeShader& agentShader, openGLComponents::computeShader& diffuseShader){
+        int useMaps = (this->enabled && this->loaded())? 1 : 0;
+        if(useMaps){
+            GLCall(glBindTextureUnit(WM_OBSTACLEUNIT, this->obstacleTexture));
+            GLCall(glBindTextureUnit(WM_FOODUNIT, this->foodTexture));
+        }
+        if(useMaps != this->useMaps_inShader){
+            agentShader.setUniform1i("useMaps", useMaps);
+            diffuseShader.setUniform1i("useMaps", useMaps);
+            this->useMaps_inShader = useMaps;
+        }
+        if(this->foodAttraction != this->foodAttraction_inShader){
+            agentShader.setUniform1f("foodAttraction", this->foodAttraction);
+            this->foodAttraction_inShader = this->foodAttraction;
+        }
+        if(this->obstacleAvoidance != this->obstacleAvoidance_inShader){
+            agentShader.setUniform1f("obstacleAvoidance", this->obstacleAvoidance);
+            this->obstacleAvoidance_inShader = this->obstacleAvoidance;
+        }
+        if(this->foodDeposit != this->foodDeposit_inShader){
+            diffuseShader.setUniform1f("foodDeposit", this->foodDeposit);
+            this->foodDeposit_inShader = this->foodDeposit;
+        }
+    }
+
+    void setPaths(const std::string& obstacles, const std::string& food){
+        obstacles.copy(this->obstaclePath, sizeof(this->obstaclePath) - 1);
+        this->obstaclePath[std::min(obstacles.size(), sizeof(this->obstaclePath) - 1)] = '\0';
+        food.copy(this->foodPath, sizeof(this->foodPath) - 1);
+        this->foodPath[std::min(food.size(), sizeof(this->foodPath) - 1)] = '\0';
+    }
+
+    void drawSettings(int res){
+        ImGui::InputText("Obstacle map", this->obstaclePath, sizeof(this->obstaclePath));
+        ImGui::InputText("Food map", this->foodPath, sizeof(this->foodPath));
+        ImGui::SliderInt("Obstacle threshold", &this->obstacleThreshold, 1, 255);
+        if(ImGui::Button("Load maps")){
+            this->reload(res);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Use maps", &this->enabled);
+        if(!this->loadError.empty()){
+            ImGui::TextColored(ImVec4(1, 0.3, 0.3, 1), "%s", this->loadError.c_str());
+        }else if(this->loaded()){
+            ImGui::Text("Loaded at %dx%d (obstacles: %s, food: %s)", this->res, this->res, this->haveObstacles ? "yes" : "no", this->haveFood ? "yes" : "no");
+        }
+        ImGui::SliderFloat("Food attraction", &this->foodAttraction, 0, 5);
+        ImGui::SliderFloat("Food deposit", &this->foodDeposit, 0, 0.5);
+        ImGui::SliderFloat("Obstacle avoidance", &this->obstacleAvoidance, 0, 5);
+    }
+};
+
+}
@@ -0,0 +1,55 @@
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "misc/headlessContext.hpp"
+#include "simulation/sweep.hpp"
+
+/*
+    Headless parameter sweep, every row of the csv file is simulated as its own instance, all stepped together
+
+    Usage: GLSLSlimeSweep <parameters.csv> <agentsPerInstance> <resolution> <steps> [frameInterval] [metricsInterval] [seed]
+    Interval of 0 disables frame/metrics output
+*/
+int main(int argc, char** argv){
+    if(argc < 5){
+        std::cout << "Usage: " << argv[0] << " <parameters.csv> <agentsPerInstance> <resolution> <steps> [frameInterval] [metricsInterval] [seed]" << std::endl;
+        return 1;
+    }
+    int agentsPerInstance = std::atoi(argv[2]);
+    int res = std::atoi(argv[3]);
+    int steps = std::atoi(argv[4]);
+    int frameInterval = (argc > 5)? std::atoi(argv[5]) : 0;
+    int metricsInterval = (argc > 6)? std::atoi(argv[6]) : 100;
+    unsigned int seed = (argc > 7)? std::strtoul(argv[7], nullptr, 10) : 0;
+
+    glfwInit();
+    auto window = headless::createContext();
+    {
+        simulation::sweep sweep(simulation::sweep::loadCSV(argv[1]), agentsPerInstance, res, seed);
+        sweep.setup();
+        std::cout << sweep.getInstanceCount() << " instances, " << agentsPerInstance << " agents each at " << res << "x" << res << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        int frame = 0;
+        for(int step = 0; step < steps; step++){
+            sweep.step();
+            if(frameInterval > 0 && step % frameInterval == 0){
+                sweep.writeFrames(frame++);
+            }
+            if(metricsInterval > 0 && (step+1) % metricsInterval == 0){
+                sweep.writeMetrics();
+            }
+        }
+        glFinish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << steps << " steps in " << seconds << "s (" << steps * sweep.getInstanceCount() / seconds << " instance steps/s)" << std::endl;
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
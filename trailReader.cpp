@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "simulation/recording/trailReader.hpp"
+
+/*
+    Reads trail recordings (.slrec) written by the "Trail recording" section of the simulation window
+
+    Usage: GLSLSlimeTrailReader <recording> info
+           GLSLSlimeTrailReader <recording> export <first> <last> <out.npy> [raw]
+
+    export writes frames first to last (inclusive) as one numpy array of shape (frames, height, width), as float32
+    deposit values or with "raw" as the uint16 values that were stored. The steps of the frames go to <out.npy>.steps.csv
+*/
+
+// Writes the .npy header (format version 1.0), the data follows straight after in C order
+static void writeNpyHeader(FILE* file, const char* descr, size_t frames, size_t height, size_t width){
+    std::string dict = std::string("{'descr': '") + descr + "', 'fortran_order': False, 'shape': (" +
+                       std::to_string(frames) + ", " + std::to_string(height) + ", " + std::to_string(width) + "), }";
+    size_t total = 10 + dict.size() + 1;
+    dict.append((64 - total % 64) % 64, ' '); // Header is padded so the data starts 64 byte aligned
+    dict += '\n';
+    uint16_t length = dict.size();
+    std::fwrite("\x93NUMPY\x01\x00", 1, 8, file);
+    std::fwrite(&length, sizeof(length), 1, file);
+    std::fwrite(dict.data(), 1, dict.size(), file);
+}
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        std::cout << "Usage: " << argv[0] << " <recording> info" << std::endl;
+        std::cout << "       " << argv[0] << " <recording> export <first> <last> <out.npy> [raw]" << std::endl;
+        return 1;
+    }
+    try{
+        recording::trailReader reader(argv[1]);
+        std::string command = argv[2];
+        if(command == "info"){
+            size_t keyframes = 0;
+            for(size_t i = 0; i < reader.frameCount(); i++){
+                keyframes += reader.isKeyframe(i);
+            }
+            std::cout << reader.width() << "x" << reader.height() << ", " << reader.frameCount() << " frames (" << keyframes << " keyframes)";
+            if(reader.frameCount() > 0){
+                std::cout << ", steps " << reader.step(0) << " to " << reader.step(reader.frameCount() - 1);
+            }
+            std::cout << ", deposit = value * " << reader.scale() << std::endl;
+            if(reader.wasRecovered()){
+                std::cout << "Recording wasnt closed properly, the index was rebuilt from the frames that are complete" << std::endl;
+            }
+            return 0;
+        }
+        if(command == "export" && argc >= 6){
+            size_t first = std::strtoull(argv[3], nullptr, 10);
+            size_t last = std::strtoull(argv[4], nullptr, 10);
+            std::string out = argv[5];
+            bool raw = (argc > 6 && std::strcmp(argv[6], "raw") == 0);
+            if(last >= reader.frameCount() || first > last){
+                std::cout << "Frame range must be within 0 to " << (long long)reader.frameCount() - 1 << std::endl;
+                return 1;
+            }
+            FILE* file = std::fopen(out.c_str(), "wb");
+            FILE* steps = std::fopen((out + ".steps.csv").c_str(), "w");
+            if(file == nullptr || steps == nullptr){
+                std::cout << "Couldnt open " << out << " for writing" << std::endl;
+                return 1;
+            }
+            writeNpyHeader(file, raw ? "<u2" : "<f4", last - first + 1, reader.height(), reader.width());
+            std::fprintf(steps, "frame,step\n");
+            std::vector<float> values(reader.texelCount());
+            for(size_t i = first; i <= last; i++){
+                if(raw){
+                    const std::vector<uint16_t>& frame = reader.frame(i);
+                    std::fwrite(frame.data(), sizeof(uint16_t), frame.size(), file);
+                }else{
+                    reader.frameAsFloat(i, values.data());
+                    std::fwrite(values.data(), sizeof(float), values.size(), file);
+                }
+                std::fprintf(steps, "%zu,%lld\n", i, reader.step(i));
+            }
+            std::fclose(file);
+            std::fclose(steps);
+            std::cout << "Wrote " << last - first + 1 << " frames to " << out << std::endl;
+            return 0;
+        }
+        std::cout << "Unknown command: " << command << std::endl;
+        return 1;
+    }catch(const std::exception& e){
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+}
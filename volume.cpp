@@ -0,0 +1,78 @@
+#define GLFW_INCLUDE_NONE
+
+#include <GLFW/glfw3.h>
+#include <glad/gl.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "misc/headlessContext.hpp"
+#include "simulation/volume.hpp"
+
+/*
+    Headless 3D simulation, exports slices or maximum projections of the trail volume every exportInterval steps
+
+    Usage: GLSLSlimeVolume <agents> <size> <steps> [exportInterval] [axis] [view] [seed]
+        axis: x, y or z (default z)
+        view: a slice number, "all" for every slice along the axis, or "max" for the maximum along it (default max)
+    Interval of 0 only exports after the last step
+*/
+int main(int argc, char** argv){
+    if(argc < 4){
+        std::cout << "Usage: " << argv[0] << " <agents> <size> <steps> [exportInterval] [x|y|z] [slice|all|max] [seed]" << std::endl;
+        return 1;
+    }
+    int agents = std::atoi(argv[1]);
+    int size = std::atoi(argv[2]);
+    int steps = std::atoi(argv[3]);
+    int exportInterval = (argc > 4)? std::atoi(argv[4]) : 0;
+    std::string axisName = (argc > 5)? argv[5] : "z";
+    std::string view = (argc > 6)? argv[6] : "max";
+    int seed = (argc > 7)? std::atoi(argv[7]) : 0;
+    int axis = (axisName == "x")? 0 : (axisName == "y")? 1 : 2;
+
+    glfwInit();
+    auto window = headless::createContext();
+    {
+        simulation::volume volume(agents, size, seed);
+        volume.setup();
+        bool allSlices = view == "all";
+        if(view == "max"){
+            volume.setView(axis, simulation::volume::VIEW_MAXIMUM, 0);
+        }else if(!allSlices){
+            volume.setView(axis, simulation::volume::VIEW_SLICE, std::atoi(view.c_str()));
+        }else{
+            volume.setView(axis, simulation::volume::VIEW_SLICE, 0);
+        }
+        std::cout << agents << " agents in a " << volume.getSize() << "^3 volume" << std::endl;
+
+        auto exportStep = [&](long long step){
+            std::string prefix = "volume_" + std::to_string(step) + "_" + axisName;
+            if(allSlices){
+                volume.writeSlices(prefix + "_");
+            }else{
+                volume.writeView(prefix + "_" + view + "." + volume.extension());
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        for(int step = 0; step < steps; step++){
+            volume.step();
+            if(exportInterval > 0 && (step+1) % exportInterval == 0){
+                exportStep(step+1);
+                std::cout << "Step " << step+1 << ": " << volume.getAllocatedBricks() << " bricks allocated, pool of " << volume.getCapacity() << std::endl;
+            }
+        }
+        glFinish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if(exportInterval <= 0){
+            exportStep(steps);
+        }
+        std::cout << steps << " steps in " << seconds << "s (" << steps / seconds << " steps/s), "
+                  << volume.getAllocatedBricks() << " bricks allocated, pool of " << volume.getCapacity() << std::endl;
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}